@@ -1331,6 +1331,178 @@ heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 		values[attnum] = getmissingattr(tupleDesc, attnum + 1, &isnull[attnum]);
 }
 
+/*
+ * heap_fixed_prefix_natts
+ *		Return the number of leading attributes of tupleDesc that have a
+ *		fixed width, and hence the same offset in every tuple without nulls.
+ *
+ * The result is computed on first use and cached in the descriptor, along
+ * with the attcacheoff of those attributes and the length of the run of
+ * leading by-value attributes whose stored form is exactly a Datum, which
+ * can be copied into a values array wholesale.
+ */
+int
+heap_fixed_prefix_natts(TupleDesc tupleDesc)
+{
+	int			off = 0;
+	int			nwords = 0;
+	int			attnum;
+
+	if (tupleDesc->tdfixedprefix >= 0)
+		return tupleDesc->tdfixedprefix;
+
+	for (attnum = 0; attnum < tupleDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupleDesc, attnum);
+
+		if (att->attlen <= 0)
+			break;
+
+		off = att_align_nominal(off, att->attalign);
+		att->attcacheoff = off;
+
+		if (nwords == attnum && att->attbyval &&
+			att->attlen == sizeof(Datum) && off == attnum * sizeof(Datum))
+			nwords++;
+
+		off += att->attlen;
+	}
+
+	tupleDesc->tdfixedwords = nwords;
+	tupleDesc->tdfixedprefix = attnum;
+
+	return attnum;
+}
+
+/*
+ * heap_deform_fixed_prefix
+ *		Extract the first natts attributes of a tuple without nulls, all of
+ *		which must lie within heap_fixed_prefix_natts(tupleDesc).
+ *
+ * tp points to the start of the tuple's data area.
+ */
+void
+heap_deform_fixed_prefix(TupleDesc tupleDesc, char *tp, int natts,
+						 Datum *values, bool *isnull)
+{
+	int			nwords = Min(tupleDesc->tdfixedwords, natts);
+	int			attnum;
+
+	Assert(natts <= tupleDesc->tdfixedprefix);
+
+	/* aligned by-value words are their own Datum representation */
+	if (nwords > 0)
+		memcpy(values, tp, nwords * sizeof(Datum));
+
+	for (attnum = nwords; attnum < natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupleDesc, attnum);
+
+		values[attnum] = fetchatt(att, tp + att->attcacheoff);
+	}
+
+	memset(isnull, false, natts * sizeof(bool));
+}
+
+/*
+ * heap_deform_column_batch
+ *		Extract attribute attnum of several tuples into a columnar array.
+ *
+ * For each of the first nselected entries i of selection[], the attribute
+ * of tuples[i] is stored into values[i] and isnull[i].  If the attribute is
+ * within the fixed-width prefix, tuples without nulls are read at the cached
+ * offset directly; the others go through heap_getattr.
+ */
+void
+heap_deform_column_batch(TupleDesc tupleDesc, HeapTupleData *tuples,
+						 const uint16 *selection, int nselected,
+						 int attnum, Datum *values, bool *isnull)
+{
+	Form_pg_attribute att = TupleDescAttr(tupleDesc, attnum - 1);
+	int			j;
+
+	if (attnum > heap_fixed_prefix_natts(tupleDesc))
+	{
+		for (j = 0; j < nselected; j++)
+		{
+			int			i = selection[j];
+
+			values[i] = heap_getattr(&tuples[i], attnum, tupleDesc,
+									 &isnull[i]);
+		}
+		return;
+	}
+
+	for (j = 0; j < nselected; j++)
+	{
+		int			i = selection[j];
+		HeapTupleHeader tup = tuples[i].t_data;
+
+		if (!HeapTupleHasNulls(&tuples[i]) &&
+			HeapTupleHeaderGetNatts(tup) >= attnum)
+		{
+			values[i] = fetchatt(att,
+								 (char *) tup + tup->t_hoff + att->attcacheoff);
+			isnull[i] = false;
+		}
+		else
+			values[i] = heap_getattr(&tuples[i], attnum, tupleDesc,
+									 &isnull[i]);
+	}
+}
+
+/*
+ * heap_deform_prefix_batch
+ *		Extract several attributes of a page of tuples in one pass.
+ *
+ * Like heap_deform_column_batch, but for the ncolumns attributes listed in
+ * attnums[], whose values and nulls go to values[c] and isnull[c].  All of
+ * them must lie within heap_fixed_prefix_natts(tupleDesc).  Each tuple's
+ * header is examined only once, and its attributes are fetched while it is
+ * in cache, rather than walking the page once per column.
+ */
+void
+heap_deform_prefix_batch(TupleDesc tupleDesc, HeapTupleData *tuples,
+						 const uint16 *selection, int nselected,
+						 int ncolumns, const AttrNumber *attnums,
+						 Datum **values, bool **isnull)
+{
+	AttrNumber	maxattnum = 0;
+	int			c;
+	int			j;
+
+	for (c = 0; c < ncolumns; c++)
+		maxattnum = Max(maxattnum, attnums[c]);
+	Assert(maxattnum <= tupleDesc->tdfixedprefix);
+
+	for (j = 0; j < nselected; j++)
+	{
+		int			i = selection[j];
+		HeapTupleHeader tup = tuples[i].t_data;
+
+		if (!HeapTupleHasNulls(&tuples[i]) &&
+			HeapTupleHeaderGetNatts(tup) >= maxattnum)
+		{
+			char	   *tp = (char *) tup + tup->t_hoff;
+
+			for (c = 0; c < ncolumns; c++)
+			{
+				Form_pg_attribute att = TupleDescAttr(tupleDesc,
+													  attnums[c] - 1);
+
+				values[c][i] = fetchatt(att, tp + att->attcacheoff);
+				isnull[c][i] = false;
+			}
+		}
+		else
+		{
+			for (c = 0; c < ncolumns; c++)
+				values[c][i] = heap_getattr(&tuples[i], attnums[c], tupleDesc,
+											&isnull[c][i]);
+		}
+	}
+}
+
 /*
  * heap_freetuple
  */
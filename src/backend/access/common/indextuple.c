@@ -554,6 +554,8 @@ index_truncate_tuple(TupleDesc sourceDescriptor, IndexTuple source,
 	truncdesc = palloc(TupleDescSize(sourceDescriptor));
 	TupleDescCopy(truncdesc, sourceDescriptor);
 	truncdesc->natts = leavenatts;
+	/* the cached fixed-width prefix may extend past the remaining columns */
+	truncdesc->tdfixedprefix = -1;
 
 	/* Deform, form copy of tuple with fewer attributes */
 	index_deform_tuple(source, truncdesc, values, isnull);
@@ -73,6 +73,8 @@ CreateTemplateTupleDesc(int natts)
 	desc->tdtypeid = RECORDOID;
 	desc->tdtypmod = -1;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tdfixedprefix = -1;
+	desc->tdfixedwords = 0;
 
 	return desc;
 }
@@ -297,6 +299,7 @@ TupleDescCopyEntry(TupleDesc dst, AttrNumber dstAttno,
 	 */
 	dstAtt->attnum = dstAttno;
 	dstAtt->attcacheoff = -1;
+	dst->tdfixedprefix = -1;
 
 	/* since we're not copying constraints or defaults, clear these */
 	dstAtt->attnotnull = false;
@@ -637,6 +640,7 @@ TupleDescInitEntry(TupleDesc desc,
 
 	att->attstattarget = -1;
 	att->attcacheoff = -1;
+	desc->tdfixedprefix = -1;
 	att->atttypmod = typmod;
 
 	att->attnum = attributeNumber;
@@ -697,6 +701,7 @@ TupleDescInitBuiltinEntry(TupleDesc desc,
 
 	att->attstattarget = -1;
 	att->attcacheoff = -1;
+	desc->tdfixedprefix = -1;
 	att->atttypmod = typmod;
 
 	att->attnum = attributeNumber;
@@ -70,6 +70,8 @@
 #include "utils/spccache.h"
 
 
+static Buffer heapreadpage(HeapScanDesc scan, BlockNumber page);
+static void heap_release_readahead(HeapScanDesc scan);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -341,6 +343,75 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heapreadpage - read a page for heapgetpage()
+ *
+ * A serial sequential scan reading forward reads the following blocks along
+ * with the one asked for, so that ReadBufferRange can read runs of them that
+ * are not in shared buffers yet with a single system call.  The extra blocks
+ * stay pinned in rs_rabufs until the scan gets to them.
+ */
+static Buffer
+heapreadpage(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber nblocks;
+
+	if (scan->rs_nrabufs > 0)
+	{
+		if (page == scan->rs_rablock)
+		{
+			Buffer		buffer = scan->rs_rabufs[scan->rs_ranext++];
+
+			scan->rs_rablock++;
+			if (scan->rs_ranext == scan->rs_nrabufs)
+				scan->rs_nrabufs = 0;
+			return buffer;
+		}
+
+		/* the scan went elsewhere */
+		heap_release_readahead(scan);
+	}
+
+	/*
+	 * Read ahead only for forward serial scans of the whole relation, at the
+	 * start of the scan or when continuing with the next block.
+	 */
+	if (!(scan->rs_base.rs_flags & SO_TYPE_SEQSCAN) ||
+		scan->rs_base.rs_parallel != NULL ||
+		scan->rs_numblocks != InvalidBlockNumber ||
+		io_combine_limit <= 1 ||
+		!(scan->rs_cblock == InvalidBlockNumber ||
+		  page == scan->rs_cblock + 1 ||
+		  (page == 0 && scan->rs_cblock == scan->rs_nblocks - 1)))
+		return ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+								  RBM_NORMAL, scan->rs_strategy);
+
+	/* don't read past the end of the relation, or where the scan started */
+	nblocks = Min(io_combine_limit, scan->rs_nblocks - page);
+	if (page < scan->rs_startblock)
+		nblocks = Min(nblocks, scan->rs_startblock - page);
+
+	scan->rs_nrabufs = ReadBufferRange(scan->rs_base.rs_rd, MAIN_FORKNUM,
+									   page, nblocks, scan->rs_strategy,
+									   scan->rs_rabufs);
+	scan->rs_ranext = 1;
+	scan->rs_rablock = page + 1;
+	if (scan->rs_nrabufs == 1)
+		scan->rs_nrabufs = 0;
+	return scan->rs_rabufs[0];
+}
+
+/*
+ * heap_release_readahead - unpin the blocks read ahead of the scan, if any
+ */
+static void
+heap_release_readahead(HeapScanDesc scan)
+{
+	while (scan->rs_ranext < scan->rs_nrabufs)
+		ReleaseBuffer(scan->rs_rabufs[scan->rs_ranext++]);
+	scan->rs_nrabufs = 0;
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -378,8 +449,7 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	CHECK_FOR_INTERRUPTS();
 
 	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	scan->rs_cbuf = heapreadpage(scan, page);
 	scan->rs_cblock = page;
 
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
@@ -1156,6 +1226,7 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	scan->rs_base.rs_flags = flags;
 	scan->rs_base.rs_parallel = parallel_scan;
 	scan->rs_strategy = NULL;	/* set in initscan */
+	scan->rs_nrabufs = 0;
 
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
@@ -1234,6 +1305,7 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * reinitialize scan descriptor
@@ -1253,6 +1325,7 @@ heap_endscan(TableScanDesc sscan)
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * decrement relation reference count and free scan descriptor storage
@@ -1340,6 +1413,72 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 	return true;
 }
 
+/*
+ * heap_getnextbatch - fetch the next batch of tuples of a forward scan
+ *
+ * Returns the next visible tuple and, in page-at-a-time mode, the visible
+ * tuples following it on the same page, up to maxtuples of them; 0 means the
+ * scan is done.  The returned headers point into the scan's current buffer
+ * (scan->rs_cbuf), so they are only valid until the next call.  The scan must
+ * not have scan keys.
+ */
+int
+heap_getnextbatch(TableScanDesc sscan, HeapTupleData *tuples, int maxtuples)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	Page		dp;
+	int			ntuples;
+
+	Assert(sscan->rs_nkeys == 0);
+	Assert(maxtuples > 0);
+
+	if (unlikely(sscan->rs_rd->rd_tableam != GetHeapamTableAmRoutine()))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg_internal("only heap AM is supported")));
+
+	if (!(sscan->rs_flags & SO_ALLOW_PAGEMODE))
+	{
+		/* the buffer lock is only held per tuple; hand them out singly */
+		heapgettup(scan, ForwardScanDirection, 0, NULL);
+		if (scan->rs_ctup.t_data == NULL)
+			return 0;
+		pgstat_count_heap_getnext(sscan->rs_rd);
+		tuples[0] = scan->rs_ctup;
+		return 1;
+	}
+
+	heapgettup_pagemode(scan, ForwardScanDirection, 0, NULL);
+	if (scan->rs_ctup.t_data == NULL)
+		return 0;
+
+	pgstat_count_heap_getnext(sscan->rs_rd);
+	tuples[0] = scan->rs_ctup;
+	ntuples = 1;
+
+	dp = BufferGetPage(scan->rs_cbuf);
+	while (ntuples < maxtuples && scan->rs_cindex + 1 < scan->rs_ntuples)
+	{
+		HeapTuple	tuple = &tuples[ntuples++];
+		OffsetNumber lineoff = scan->rs_vistuples[++scan->rs_cindex];
+		ItemId		lpp = PageGetItemId(dp, lineoff);
+
+		Assert(ItemIdIsNormal(lpp));
+
+		tuple->t_data = (HeapTupleHeader) PageGetItem(dp, lpp);
+		tuple->t_len = ItemIdGetLength(lpp);
+		ItemPointerSet(&(tuple->t_self), scan->rs_cblock, lineoff);
+		tuple->t_tableOid = scan->rs_ctup.t_tableOid;
+
+		pgstat_count_heap_getnext(sscan->rs_rd);
+	}
+
+	/* keep rs_ctup in sync with rs_cindex, as heapgettup_pagemode would */
+	scan->rs_ctup = tuples[ntuples - 1];
+
+	return ntuples;
+}
+
 /*
  *	heap_fetch		- retrieve tuple with given tid
  *
@@ -0,0 +1,943 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallelredo.c
+ *		Replay of WAL records by background workers during recovery
+ *
+ * The startup process replays WAL one record at a time, and mostly spends
+ * that time waiting for the data pages the records apply to to be read in.
+ * With parallel_redo_workers > 0, it hands suitable records over to worker
+ * processes instead, so that several of those reads are under way at once.
+ *
+ * Records are partitioned by the relation they modify: all records for one
+ * relation go to the same worker, through a queue in shared memory, and are
+ * replayed there in WAL order.  Only record types that touch blocks of a
+ * single relation and no other state are handed out, see
+ * ParallelRedoCanDispatch().  Any other record acts as a barrier: the
+ * startup process waits for the workers to finish everything queued so far,
+ * and then replays the record itself.  That includes transaction commits,
+ * so a transaction's changes have all been replayed by the time it becomes
+ * visible.
+ *
+ * Between barriers, one relation can get ahead of another.  After a crash
+ * nobody can tell, but read-only queries on a hot standby could, say, find
+ * an index entry pointing to a heap page that hasn't been replayed yet.  So
+ * while hot standby queries are allowed, only full-page images are handed
+ * out; those are written by index builds and hint bit updates and don't
+ * have that problem.
+ *
+ * Workers never have to read a block that doesn't exist yet: a record that
+ * refers to a block beyond the end of its relation, and doesn't initialize
+ * it, is replayed by the startup process after a barrier, so that the
+ * invalid-page checks of xlogutils.c keep working as before.  To tell, the
+ * startup process remembers the relation sizes it has looked up since the
+ * last barrier, and extends them by the blocks that queued records
+ * initialize.
+ *
+ * Processes other than the startup process normally learn about relation
+ * size changes and dropped files through shared invalidation messages, but
+ * neither the startup process nor the workers process those.  Instead, the
+ * workers forget their cached fork sizes whenever the startup process has
+ * replayed a record itself, and close all their files when that record may
+ * have removed some.  The startup process does the same after waiting for
+ * the workers.
+ *
+ * lastReplayedEndRecPtr only moves past records replayed by workers once
+ * the startup process has waited for them, so everything that looks at it
+ * sees a conservative value.  The startup process also waits for them before
+ * it declares recovery consistent or allows hot standby queries.  Pages the
+ * workers write out advance minRecoveryPoint, as in the startup process.
+ *
+ * The workers are dynamic background workers registered by the startup
+ * process when redo starts, and they exit when it ends.  A worker that
+ * exits with records still queued makes recovery fail.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/transam/parallelredo.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam_xlog.h"
+#include "access/nbtxlog.h"
+#include "access/parallelredo.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "catalog/pg_control.h"
+#include "common/hashfn.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+/* GUC variable */
+int			parallel_redo_workers = 0;
+
+/* size of the queue of each worker, in bytes */
+#define PARALLEL_REDO_QUEUE_SIZE (1024 * 1024)
+
+/* Header of a record in a queue; the XLogRecord itself follows */
+typedef struct ParallelRedoEntry
+{
+	uint32		len;			/* length of the XLogRecord */
+	XLogRecPtr	ReadRecPtr;		/* start of the record */
+	XLogRecPtr	EndRecPtr;		/* end+1 of the record */
+} ParallelRedoEntry;
+
+#define PARALLEL_REDO_ENTRY_SIZE(len) \
+	MAXALIGN(sizeof(ParallelRedoEntry) + (len))
+
+/*
+ * State of one worker.  The positions count bytes ever queued and replayed;
+ * the queue holds the bytes between them.  Only the startup process advances
+ * insertPos and only the worker advances replayPos.
+ */
+typedef struct ParallelRedoWorker
+{
+	pid_t		pid;			/* 0 if not running */
+	Latch	   *latch;
+	bool		sleeping;		/* waiting for records to be queued? */
+	pg_atomic_uint64 insertPos;
+	pg_atomic_uint64 replayPos;
+} ParallelRedoWorker;
+
+/* Shared memory state */
+typedef struct ParallelRedoControl
+{
+	slock_t		mutex;			/* protects pid and latch of the workers */
+	Latch	   *startupLatch;
+	bool		startupWaiting; /* startup process waiting for a worker? */
+	bool		shutdown;		/* workers should exit */
+	pg_atomic_uint32 nchanges;	/* bumped when a worker starts or exits */
+	pg_atomic_uint32 localCount;	/* bumped for records replayed locally */
+	pg_atomic_uint32 removeCount;	/* ... that may have removed files */
+	pg_atomic_uint32 minRecoveryCount;	/* bumped when minRecoveryPoint
+										 * starts being tracked */
+	ParallelRedoWorker workers[MAX_PARALLEL_REDO_WORKERS];
+} ParallelRedoControl;
+
+static ParallelRedoControl *ParallelRedoCtl = NULL;
+static char *ParallelRedoQueues = NULL;
+
+#define ParallelRedoQueue(id) \
+	(ParallelRedoQueues + (Size) (id) * PARALLEL_REDO_QUEUE_SIZE)
+
+/* Key and entry of the relation sizes known to the startup process */
+typedef struct RelSizeKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} RelSizeKey;
+
+typedef struct RelSizeEntry
+{
+	RelSizeKey	key;			/* hash key --- MUST BE FIRST */
+	BlockNumber nblocks;
+} RelSizeEntry;
+
+/* State of the startup process */
+static bool parallelRedoActive = false;
+static uint32 knownChanges = 0;
+static int	nactive = 0;		/* workers records are dispatched to */
+static int	activeWorkers[MAX_PARALLEL_REDO_WORKERS];
+static bool queuedSinceBarrier = false;
+static XLogRecPtr lastQueuedEndPtr = InvalidXLogRecPtr;
+static HTAB *relSizes = NULL;
+
+static void ParallelRedoStartupExit(int code, Datum arg);
+static void ParallelRedoUpdateWorkers(void);
+static bool ParallelRedoCanDispatch(XLogReaderState *record,
+									RelFileNode *rnode);
+static RelSizeEntry *ParallelRedoRelSize(RelFileNode rnode,
+										 ForkNumber forknum);
+static bool ParallelRedoMayRemoveFiles(XLogReaderState *record);
+static void ParallelRedoEnqueue(int id, XLogReaderState *record);
+static void ParallelRedoWaitFor(int id, uint64 upto);
+static void ParallelRedoWorkerExit(int code, Datum arg);
+static void ParallelRedoReplay(int id, XLogReaderState *reader,
+							   MemoryContext redo_context);
+static void parallel_redo_error_callback(void *arg);
+static void queue_write(char *queue, uint64 pos, const void *data, Size len);
+static void queue_read(char *queue, uint64 pos, void *data, Size len);
+
+
+/*
+ * ParallelRedoShmemSize
+ *		Compute space needed for parallel redo shared memory
+ */
+Size
+ParallelRedoShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(ParallelRedoControl));
+	size = add_size(size, mul_size(parallel_redo_workers,
+								   PARALLEL_REDO_QUEUE_SIZE));
+	return size;
+}
+
+/*
+ * ParallelRedoShmemInit
+ *		Allocate and initialize parallel redo shared memory
+ */
+void
+ParallelRedoShmemInit(void)
+{
+	bool		found;
+
+	ParallelRedoCtl = (ParallelRedoControl *)
+		ShmemInitStruct("Parallel Redo Data", ParallelRedoShmemSize(), &found);
+	ParallelRedoQueues = (char *) ParallelRedoCtl +
+		MAXALIGN(sizeof(ParallelRedoControl));
+
+	if (!found)
+	{
+		SpinLockInit(&ParallelRedoCtl->mutex);
+		ParallelRedoCtl->startupLatch = NULL;
+		ParallelRedoCtl->startupWaiting = false;
+		ParallelRedoCtl->shutdown = false;
+		pg_atomic_init_u32(&ParallelRedoCtl->nchanges, 0);
+		pg_atomic_init_u32(&ParallelRedoCtl->localCount, 0);
+		pg_atomic_init_u32(&ParallelRedoCtl->removeCount, 0);
+		pg_atomic_init_u32(&ParallelRedoCtl->minRecoveryCount, 0);
+		for (int i = 0; i < MAX_PARALLEL_REDO_WORKERS; i++)
+		{
+			ParallelRedoWorker *worker = &ParallelRedoCtl->workers[i];
+
+			worker->pid = 0;
+			worker->latch = NULL;
+			worker->sleeping = false;
+			pg_atomic_init_u64(&worker->insertPos, 0);
+			pg_atomic_init_u64(&worker->replayPos, 0);
+		}
+	}
+}
+
+/*
+ * ParallelRedoStart
+ *		Launch the workers, when the startup process begins redo.
+ */
+void
+ParallelRedoStart(void)
+{
+	BackgroundWorker bgw;
+	int			nlaunched;
+
+	Assert(AmStartupProcess());
+
+	if (parallel_redo_workers == 0 || !IsUnderPostmaster)
+		return;
+
+	SpinLockAcquire(&ParallelRedoCtl->mutex);
+	ParallelRedoCtl->startupLatch = MyLatch;
+	ParallelRedoCtl->shutdown = false;
+	SpinLockRelease(&ParallelRedoCtl->mutex);
+
+	before_shmem_exit(ParallelRedoStartupExit, (Datum) 0);
+
+	for (nlaunched = 0; nlaunched < parallel_redo_workers; nlaunched++)
+	{
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+		snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelRedoWorkerMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "parallel redo worker %d",
+				 nlaunched);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "parallel redo worker");
+		bgw.bgw_restart_time = BGW_NEVER_RESTART;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(nlaunched);
+
+		if (!RegisterDynamicBackgroundWorker(&bgw, NULL))
+			break;
+	}
+
+	if (nlaunched < parallel_redo_workers)
+		ereport(LOG,
+				(errmsg("could only launch %d of %d parallel redo workers",
+						nlaunched, parallel_redo_workers),
+				 errhint("You might need to increase max_worker_processes.")));
+
+	parallelRedoActive = true;
+}
+
+/*
+ * ParallelRedoDispatch
+ *		Hand a record over to a worker, if possible.
+ *
+ * Returns false if the caller has to replay the record itself.  In that
+ * case, the workers have replayed everything queued before it.
+ */
+bool
+ParallelRedoDispatch(XLogReaderState *record)
+{
+	RelFileNode rnode;
+	uint32		hash;
+
+	if (!parallelRedoActive)
+		return false;
+
+	/* notice workers that have started or exited */
+	if (pg_atomic_read_u32(&ParallelRedoCtl->nchanges) != knownChanges)
+		ParallelRedoUpdateWorkers();
+
+	if (nactive == 0 || !ParallelRedoCanDispatch(record, &rnode))
+	{
+		(void) ParallelRedoWaitForWorkers();
+
+		/* make the workers notice before they replay anything else */
+		if (nactive > 0)
+		{
+			pg_atomic_fetch_add_u32(&ParallelRedoCtl->localCount, 1);
+			if (ParallelRedoMayRemoveFiles(record))
+				pg_atomic_fetch_add_u32(&ParallelRedoCtl->removeCount, 1);
+		}
+		return false;
+	}
+
+	hash = hash_bytes((const unsigned char *) &rnode, sizeof(RelFileNode));
+	ParallelRedoEnqueue(activeWorkers[hash % nactive], record);
+
+	return true;
+}
+
+/*
+ * ParallelRedoWaitForWorkers
+ *		Wait for the workers to replay all records queued for them.
+ *
+ * Returns the end of the last record they replayed, or InvalidXLogRecPtr if
+ * nothing had been queued since the last wait.
+ */
+XLogRecPtr
+ParallelRedoWaitForWorkers(void)
+{
+	/* the caller may be about to change relation sizes itself */
+	if (relSizes != NULL)
+	{
+		hash_destroy(relSizes);
+		relSizes = NULL;
+	}
+
+	if (!queuedSinceBarrier)
+		return InvalidXLogRecPtr;
+
+	for (int i = 0; i < nactive; i++)
+	{
+		int			id = activeWorkers[i];
+
+		ParallelRedoWaitFor(id, pg_atomic_read_u64(&ParallelRedoCtl->workers[id].insertPos));
+	}
+
+	/* the workers may have extended relations */
+	smgrforgetsizes();
+
+	queuedSinceBarrier = false;
+	return lastQueuedEndPtr;
+}
+
+/*
+ * ParallelRedoMinRecoveryPointChanged
+ *		Make the workers reload minRecoveryPoint from the control file.
+ *
+ * Called by the startup process when it switches from crash recovery to
+ * archive recovery, before it dispatches any further records.  From then on,
+ * pages written by the workers must advance minRecoveryPoint, as pages
+ * written by the startup process do.
+ */
+void
+ParallelRedoMinRecoveryPointChanged(void)
+{
+	if (!parallelRedoActive)
+		return;
+
+	pg_atomic_fetch_add_u32(&ParallelRedoCtl->minRecoveryCount, 1);
+}
+
+/*
+ * ParallelRedoEnd
+ *		Let the workers exit, at the end of redo.
+ *
+ * The caller must have waited for them to replay everything.
+ */
+void
+ParallelRedoEnd(void)
+{
+	if (!parallelRedoActive)
+		return;
+
+	Assert(!queuedSinceBarrier);
+
+	ParallelRedoStartupExit(0, (Datum) 0);
+	cancel_before_shmem_exit(ParallelRedoStartupExit, (Datum) 0);
+	parallelRedoActive = false;
+}
+
+/*
+ * Tell the workers to exit, also when the startup process exits early.
+ */
+static void
+ParallelRedoStartupExit(int code, Datum arg)
+{
+	Latch	   *latches[MAX_PARALLEL_REDO_WORKERS];
+	int			nlatches = 0;
+
+	SpinLockAcquire(&ParallelRedoCtl->mutex);
+	ParallelRedoCtl->shutdown = true;
+	ParallelRedoCtl->startupLatch = NULL;
+	for (int i = 0; i < MAX_PARALLEL_REDO_WORKERS; i++)
+	{
+		if (ParallelRedoCtl->workers[i].latch != NULL)
+			latches[nlatches++] = ParallelRedoCtl->workers[i].latch;
+	}
+	SpinLockRelease(&ParallelRedoCtl->mutex);
+
+	for (int i = 0; i < nlatches; i++)
+		SetLatch(latches[i]);
+}
+
+/*
+ * Rebuild the list of workers to dispatch records to.  Since that changes
+ * which worker a relation maps to, wait for the current ones first.
+ */
+static void
+ParallelRedoUpdateWorkers(void)
+{
+	(void) ParallelRedoWaitForWorkers();
+
+	knownChanges = pg_atomic_read_u32(&ParallelRedoCtl->nchanges);
+
+	nactive = 0;
+	SpinLockAcquire(&ParallelRedoCtl->mutex);
+	for (int i = 0; i < MAX_PARALLEL_REDO_WORKERS; i++)
+	{
+		if (ParallelRedoCtl->workers[i].pid != 0)
+			activeWorkers[nactive++] = i;
+	}
+	SpinLockRelease(&ParallelRedoCtl->mutex);
+}
+
+/*
+ * Can this record be replayed by a worker?  If so, return the relation it
+ * modifies.
+ */
+static bool
+ParallelRedoCanDispatch(XLogReaderState *record, RelFileNode *rnode)
+{
+	uint8		rmid = XLogRecGetRmid(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	bool		fpi_only = HotStandbyActiveInReplay();
+	bool		found = false;
+	int			block_id;
+
+	if ((XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) != 0 ||
+		!XLogRecHasAnyBlockRefs(record) ||
+		XLogRecGetTotalLen(record) > PARALLEL_REDO_QUEUE_SIZE / 4)
+		return false;
+
+	/*
+	 * Record types whose redo routines touch nothing but the blocks they
+	 * reference and the free space and visibility maps of the same relation,
+	 * and don't need to resolve recovery conflicts.
+	 */
+	switch (rmid)
+	{
+		case RM_XLOG_ID:
+			if (info != XLOG_FPI && info != XLOG_FPI_FOR_HINT)
+				return false;
+			break;
+		case RM_HEAP_ID:
+			if (fpi_only)
+				return false;
+			switch (info & XLOG_HEAP_OPMASK)
+			{
+				case XLOG_HEAP_INSERT:
+				case XLOG_HEAP_DELETE:
+				case XLOG_HEAP_UPDATE:
+				case XLOG_HEAP_HOT_UPDATE:
+				case XLOG_HEAP_CONFIRM:
+				case XLOG_HEAP_LOCK:
+				case XLOG_HEAP_INPLACE:
+					break;
+				default:
+					return false;
+			}
+			break;
+		case RM_HEAP2_ID:
+			if (fpi_only)
+				return false;
+			if ((info & XLOG_HEAP_OPMASK) != XLOG_HEAP2_MULTI_INSERT &&
+				(info & XLOG_HEAP_OPMASK) != XLOG_HEAP2_LOCK_UPDATED)
+				return false;
+			break;
+		case RM_BTREE_ID:
+			if (fpi_only)
+				return false;
+			if (info != XLOG_BTREE_INSERT_LEAF &&
+				info != XLOG_BTREE_INSERT_POST)
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	/* all blocks must belong to the same relation */
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		RelFileNode node;
+
+		if (!XLogRecGetBlockTag(record, block_id, &node, NULL, NULL))
+			continue;
+		if (!found)
+			*rnode = node;
+		else if (!RelFileNodeEquals(node, *rnode))
+			return false;
+		found = true;
+	}
+
+	/* ... and exist already, unless the record initializes them */
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		ForkNumber	forknum;
+		BlockNumber blkno;
+
+		if (!XLogRecGetBlockTag(record, block_id, NULL, &forknum, &blkno))
+			continue;
+		if ((record->blocks[block_id].flags & BKPBLOCK_WILL_INIT) == 0 &&
+			!XLogRecBlockImageApply(record, block_id) &&
+			blkno >= ParallelRedoRelSize(*rnode, forknum)->nblocks)
+			return false;
+	}
+
+	/* the worker will extend the relation as needed */
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		ForkNumber	forknum;
+		BlockNumber blkno;
+		RelSizeEntry *entry;
+
+		if (!XLogRecGetBlockTag(record, block_id, NULL, &forknum, &blkno))
+			continue;
+		entry = ParallelRedoRelSize(*rnode, forknum);
+		if (blkno >= entry->nblocks)
+			entry->nblocks = blkno + 1;
+	}
+
+	return true;
+}
+
+/*
+ * Return the entry for the size of a relation fork, looking up the size
+ * if we haven't since the last barrier.
+ */
+static RelSizeEntry *
+ParallelRedoRelSize(RelFileNode rnode, ForkNumber forknum)
+{
+	RelSizeKey	key;
+	RelSizeEntry *entry;
+	bool		found;
+
+	if (relSizes == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(RelSizeKey);
+		ctl.entrysize = sizeof(RelSizeEntry);
+		relSizes = hash_create("Parallel redo relation sizes", 64, &ctl,
+							   HASH_ELEM | HASH_BLOBS);
+	}
+
+	MemSet(&key, 0, sizeof(key));
+	key.rnode = rnode;
+	key.forknum = forknum;
+	entry = (RelSizeEntry *) hash_search(relSizes, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		SMgrRelation smgr = smgropen(rnode, InvalidBackendId);
+
+		if (smgrexists(smgr, forknum))
+			entry->nblocks = smgrnblocks(smgr, forknum);
+		else
+			entry->nblocks = 0;
+	}
+
+	return entry;
+}
+
+/*
+ * Might replaying this record unlink relation files?  The workers must not
+ * keep them open, in case the relfilenode is reused.
+ */
+static bool
+ParallelRedoMayRemoveFiles(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record);
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+		case RM_XACT_ID:
+			switch (info & XLOG_XACT_OPMASK)
+			{
+				case XLOG_XACT_COMMIT:
+				case XLOG_XACT_COMMIT_PREPARED:
+					{
+						xl_xact_parsed_commit parsed;
+
+						ParseCommitRecord(info,
+										  (xl_xact_commit *) XLogRecGetData(record),
+										  &parsed);
+						return parsed.nrels > 0;
+					}
+				case XLOG_XACT_ABORT:
+				case XLOG_XACT_ABORT_PREPARED:
+					{
+						xl_xact_parsed_abort parsed;
+
+						ParseAbortRecord(info,
+										 (xl_xact_abort *) XLogRecGetData(record),
+										 &parsed);
+						return parsed.nrels > 0;
+					}
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Append a record to the queue of a worker, waiting for space if needed.
+ */
+static void
+ParallelRedoEnqueue(int id, XLogReaderState *record)
+{
+	ParallelRedoWorker *worker = &ParallelRedoCtl->workers[id];
+	char	   *queue = ParallelRedoQueue(id);
+	ParallelRedoEntry entry;
+	uint64		pos = pg_atomic_read_u64(&worker->insertPos);
+	uint64		size;
+	Latch	   *latch;
+
+	entry.len = XLogRecGetTotalLen(record);
+	entry.ReadRecPtr = record->ReadRecPtr;
+	entry.EndRecPtr = record->EndRecPtr;
+	size = PARALLEL_REDO_ENTRY_SIZE(entry.len);
+
+	if (pos + size - pg_atomic_read_u64(&worker->replayPos) >
+		PARALLEL_REDO_QUEUE_SIZE)
+		ParallelRedoWaitFor(id, pos + size - PARALLEL_REDO_QUEUE_SIZE);
+
+	/* don't overwrite anything before the worker is done reading it */
+	pg_memory_barrier();
+
+	queue_write(queue, pos, &entry, sizeof(entry));
+	queue_write(queue, pos + sizeof(entry), record->decoded_record, entry.len);
+
+	pg_write_barrier();
+	pg_atomic_write_u64(&worker->insertPos, pos + size);
+
+	/* wake up the worker, if it's waiting for records */
+	pg_memory_barrier();
+	latch = worker->latch;
+	if (worker->sleeping && latch != NULL)
+		SetLatch(latch);
+
+	queuedSinceBarrier = true;
+	lastQueuedEndPtr = record->EndRecPtr;
+}
+
+/*
+ * Wait for a worker to replay its queue up to the given position.
+ */
+static void
+ParallelRedoWaitFor(int id, uint64 upto)
+{
+	ParallelRedoWorker *worker = &ParallelRedoCtl->workers[id];
+
+	for (;;)
+	{
+		if (pg_atomic_read_u64(&worker->replayPos) >= upto)
+			break;
+
+		ParallelRedoCtl->startupWaiting = true;
+		pg_memory_barrier();
+
+		if (worker->pid == 0)
+		{
+			ParallelRedoCtl->startupWaiting = false;
+			if (pg_atomic_read_u64(&worker->replayPos) >= upto)
+				break;
+			ereport(FATAL,
+					(errmsg("parallel redo worker %d exited before replaying all WAL records queued for it",
+							id)));
+		}
+
+		if (pg_atomic_read_u64(&worker->replayPos) < upto)
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 1000L, WAIT_EVENT_PARALLEL_REDO_SYNC);
+
+		ParallelRedoCtl->startupWaiting = false;
+		ResetLatch(MyLatch);
+
+		HandleStartupProcInterrupts();
+	}
+}
+
+/*
+ * Main entry point for parallel redo worker processes
+ */
+void
+ParallelRedoWorkerMain(Datum main_arg)
+{
+	int			id = DatumGetInt32(main_arg);
+	ParallelRedoWorker *worker;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+
+	Assert(id >= 0 && id < MAX_PARALLEL_REDO_WORKERS);
+	worker = &ParallelRedoCtl->workers[id];
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	CreateAuxProcessResourceOwner();
+
+	SpinLockAcquire(&ParallelRedoCtl->mutex);
+	if (ParallelRedoCtl->shutdown)
+	{
+		/* redo is over already */
+		SpinLockRelease(&ParallelRedoCtl->mutex);
+		proc_exit(0);
+	}
+	worker->pid = MyProcPid;
+	worker->latch = MyLatch;
+	worker->sleeping = false;
+	SpinLockRelease(&ParallelRedoCtl->mutex);
+
+	before_shmem_exit(ParallelRedoWorkerExit, Int32GetDatum(id));
+	pg_atomic_fetch_add_u32(&ParallelRedoCtl->nchanges, 1);
+
+	/*
+	 * Act like the startup process for the redo routines.  That includes
+	 * advancing minRecoveryPoint when we write out pages, unless it's
+	 * invalid because we're in crash recovery.
+	 */
+	InRecovery = true;
+	LoadMinRecoveryPoint();
+	for (int rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		if (RmgrTable[rmid].rm_startup != NULL)
+			RmgrTable[rmid].rm_startup();
+	}
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL,
+								XL_ROUTINE(.page_read = NULL), NULL);
+	if (reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "Parallel Redo",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (ParallelRedoCtl->shutdown)
+			break;
+
+		if (pg_atomic_read_u64(&worker->insertPos) !=
+			pg_atomic_read_u64(&worker->replayPos))
+		{
+			pg_read_barrier();
+			ParallelRedoReplay(id, reader, redo_context);
+			continue;
+		}
+
+		worker->sleeping = true;
+		pg_memory_barrier();
+		if (pg_atomic_read_u64(&worker->insertPos) ==
+			pg_atomic_read_u64(&worker->replayPos) &&
+			!ParallelRedoCtl->shutdown)
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+							 WAIT_EVENT_PARALLEL_REDO_MAIN);
+		worker->sleeping = false;
+		ResetLatch(MyLatch);
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Replay the next record in the queue of a worker.
+ */
+static void
+ParallelRedoReplay(int id, XLogReaderState *reader, MemoryContext redo_context)
+{
+	static char *buf = NULL;
+	static Size bufsize = 0;
+	static uint32 seenLocalCount = 0;
+	static uint32 seenRemoveCount = 0;
+	static uint32 seenMinRecoveryCount = 0;
+	ParallelRedoWorker *worker = &ParallelRedoCtl->workers[id];
+	char	   *queue = ParallelRedoQueue(id);
+	uint64		pos = pg_atomic_read_u64(&worker->replayPos);
+	ParallelRedoEntry entry;
+	ErrorContextCallback errcallback;
+	MemoryContext oldcontext;
+	uint32		count;
+	char	   *errormsg;
+
+	queue_read(queue, pos, &entry, sizeof(entry));
+	if (entry.len > bufsize)
+	{
+		if (buf)
+			pfree(buf);
+		bufsize = Max(entry.len, BLCKSZ * 2);
+		buf = MemoryContextAlloc(TopMemoryContext, bufsize);
+	}
+	queue_read(queue, pos + sizeof(entry), buf, entry.len);
+
+	/* catch up with what the startup process replayed itself */
+	count = pg_atomic_read_u32(&ParallelRedoCtl->removeCount);
+	if (count != seenRemoveCount)
+	{
+		smgrcloseall();
+		seenRemoveCount = count;
+	}
+	count = pg_atomic_read_u32(&ParallelRedoCtl->localCount);
+	if (count != seenLocalCount)
+	{
+		smgrforgetsizes();
+		seenLocalCount = count;
+	}
+	count = pg_atomic_read_u32(&ParallelRedoCtl->minRecoveryCount);
+	if (count != seenMinRecoveryCount)
+	{
+		LoadMinRecoveryPoint();
+		seenMinRecoveryCount = count;
+	}
+
+	reader->ReadRecPtr = entry.ReadRecPtr;
+	reader->EndRecPtr = entry.EndRecPtr;
+	if (!DecodeXLogRecord(reader, (XLogRecord *) buf, &errormsg))
+		ereport(ERROR,
+				(errmsg_internal("could not decode WAL record at %X/%X: %s",
+								 (uint32) (entry.ReadRecPtr >> 32),
+								 (uint32) entry.ReadRecPtr, errormsg)));
+
+	errcallback.callback = parallel_redo_error_callback;
+	errcallback.arg = (void *) reader;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	oldcontext = MemoryContextSwitchTo(redo_context);
+	RmgrTable[XLogRecGetRmid(reader)].rm_redo(reader);
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(redo_context);
+
+	error_context_stack = errcallback.previous;
+
+	/* free the space, and wake up the startup process if it's waiting */
+	pg_memory_barrier();
+	pg_atomic_write_u64(&worker->replayPos,
+						pos + PARALLEL_REDO_ENTRY_SIZE(entry.len));
+	pg_memory_barrier();
+	if (ParallelRedoCtl->startupWaiting)
+	{
+		Latch	   *latch = ParallelRedoCtl->startupLatch;
+
+		if (latch != NULL)
+			SetLatch(latch);
+	}
+}
+
+/*
+ * Stop getting records, when the worker exits.
+ */
+static void
+ParallelRedoWorkerExit(int code, Datum arg)
+{
+	ParallelRedoWorker *worker = &ParallelRedoCtl->workers[DatumGetInt32(arg)];
+	Latch	   *latch;
+
+	SpinLockAcquire(&ParallelRedoCtl->mutex);
+	worker->pid = 0;
+	worker->latch = NULL;
+	worker->sleeping = false;
+	latch = ParallelRedoCtl->startupLatch;
+	SpinLockRelease(&ParallelRedoCtl->mutex);
+
+	pg_atomic_fetch_add_u32(&ParallelRedoCtl->nchanges, 1);
+
+	if (latch != NULL)
+		SetLatch(latch);
+}
+
+/*
+ * Error context callback for errors occurring during redo in a worker.
+ */
+static void
+parallel_redo_error_callback(void *arg)
+{
+	XLogReaderState *record = (XLogReaderState *) arg;
+	RmgrId		rmid = XLogRecGetRmid(record);
+	const char *id;
+
+	id = RmgrTable[rmid].rm_identify(XLogRecGetInfo(record));
+	errcontext("WAL redo at %X/%X for %s/%s",
+			   (uint32) (record->ReadRecPtr >> 32),
+			   (uint32) record->ReadRecPtr,
+			   RmgrTable[rmid].rm_name, id ? id : "UNKNOWN");
+}
+
+/*
+ * Copy data into or out of a queue, wrapping around at its end.
+ */
+static void
+queue_write(char *queue, uint64 pos, const void *data, Size len)
+{
+	Size		offset = pos % PARALLEL_REDO_QUEUE_SIZE;
+	Size		first = Min(len, PARALLEL_REDO_QUEUE_SIZE - offset);
+
+	memcpy(queue + offset, data, first);
+	if (first < len)
+		memcpy(queue, (const char *) data + first, len - first);
+}
+
+static void
+queue_read(char *queue, uint64 pos, void *data, Size len)
+{
+	Size		offset = pos % PARALLEL_REDO_QUEUE_SIZE;
+	Size		first = Min(len, PARALLEL_REDO_QUEUE_SIZE - offset);
+
+	memcpy(data, queue + offset, first);
+	if (first < len)
+		memcpy((char *) data + first, queue, len - first);
+}
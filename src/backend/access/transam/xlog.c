@@ -26,6 +26,7 @@
 #include "access/commit_ts.h"
 #include "access/heaptoast.h"
 #include "access/multixact.h"
+#include "access/parallelredo.h"
 #include "access/rewriteheap.h"
 #include "access/subtrans.h"
 #include "access/timeline.h"
@@ -35,6 +36,7 @@
 #include "access/xlog_internal.h"
 #include "access/xlogarchive.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -104,7 +106,7 @@ bool		wal_recycle = true;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
-int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitDelay = 0;	/* precommit delay in microseconds, or -1 */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 int			wal_retrieve_retry_interval = 5000;
 int			max_slot_wal_keep_size_mb = -1;
@@ -116,11 +118,18 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Shortest delay commit_delay = -1 chooses, in microseconds.  Shorter sleeps
+ * are dominated by timer slack and scheduling, and gain nothing.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+#define MIN_AUTO_COMMIT_DELAY	50
+
+/*
+ * Number of WAL insertion locks to use (GUC wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead to
+ * flushing the WAL, which needs to iterate all the locks.  -1 means the value
+ * is chosen from the number of CPUs, see XLOGChooseNumInsertLocks().
+ */
+int			wal_insert_locks = -1;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -617,6 +626,18 @@ typedef struct XLogCtlData
 	pg_time_t	lastSegSwitchTime;
 	XLogRecPtr	lastSegSwitchLSN;
 
+	/*
+	 * Flush timing used by commit_delay = -1.  flushRequests counts the calls
+	 * to XLogFlush that found their record not flushed yet, since the current
+	 * or last flush by XLogFlush began.  avgFlushTime is a moving average of
+	 * the time those flushes take, in microseconds, and is protected by
+	 * WALWriteLock.  autoCommitDelay is the delay chosen at the end of the
+	 * last flush, read without any lock.
+	 */
+	pg_atomic_uint32 flushRequests;
+	double		avgFlushTime;
+	pg_atomic_uint32 autoCommitDelay;
+
 	/*
 	 * Protected by info_lck and WALWriteLock (you must hold either lock to
 	 * read it, but both to update)
@@ -889,6 +910,7 @@ static void exitArchiveRecovery(TimeLineID endTLI, XLogRecPtr endOfLog);
 static bool recoveryStopsBefore(XLogReaderState *record);
 static bool recoveryStopsAfter(XLogReaderState *record);
 static void recoveryPausesHere(bool endOfRecovery);
+static bool WaitForParallelRedo(void);
 static bool recoveryApplyDelay(XLogReaderState *record);
 static void SetLatestXTime(TimestampTz xtime);
 static void SetCurrentChunkStartTime(TimestampTz xtime);
@@ -905,6 +927,7 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
+static void XLogSetAutoCommitDelay(instr_time duration, uint32 arrivals);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 								   bool find_free, XLogSegNo max_segno,
 								   bool use_lock);
@@ -1038,7 +1061,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1669,7 +1692,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % wal_insert_locks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1687,7 +1710,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % wal_insert_locks;
 	}
 }
 
@@ -1705,7 +1728,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < wal_insert_locks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1731,7 +1754,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < wal_insert_locks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1759,8 +1782,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[wal_insert_locks - 1].l.lock,
+						&WALInsertLocks[wal_insert_locks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1827,7 +1850,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -2836,6 +2859,25 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * Initialize the local copy of minRecoveryPoint in a parallel redo worker.
+ *
+ * The workers replay WAL with InRecovery set, so they follow the rules of the
+ * startup process above: while the control file's minRecoveryPoint is
+ * invalid, they never update it.  They call this again when the startup
+ * process switches to archive recovery.
+ */
+void
+LoadMinRecoveryPoint(void)
+{
+	LWLockAcquire(ControlFileLock, LW_SHARED);
+	minRecoveryPoint = ControlFile->minRecoveryPoint;
+	minRecoveryPointTLI = ControlFile->minRecoveryPointTLI;
+	LWLockRelease(ControlFileLock);
+
+	updateMinRecoveryPoint = true;
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
@@ -2847,6 +2889,8 @@ XLogFlush(XLogRecPtr record)
 {
 	XLogRecPtr	WriteRqstPtr;
 	XLogwrtRqst WriteRqst;
+	bool		counted = false;
+	bool		slept = false;
 
 	/*
 	 * During REDO, we are reading not writing WAL.  Therefore, instead of
@@ -2893,6 +2937,8 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		instr_time	start_time;
+		instr_time	duration;
 
 		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&XLogCtl->info_lck);
@@ -2905,6 +2951,33 @@ XLogFlush(XLogRecPtr record)
 		if (record <= LogwrtResult.Flush)
 			break;
 
+		/* count this request for XLogSetAutoCommitDelay(), once */
+		if (!counted)
+		{
+			pg_atomic_fetch_add_u32(&XLogCtl->flushRequests, 1);
+			counted = true;
+		}
+
+		/*
+		 * With commit_delay = -1, sleep before trying to get the write lock,
+		 * if flushes have been taking long enough for other backends to join
+		 * in meanwhile.  Unlike the fixed commit_delay below, this sleep
+		 * doesn't hold WALWriteLock, so it doesn't hold up the WAL writer or
+		 * backends that need to write out WAL buffers to insert.  Whoever
+		 * gets the lock first flushes for all the sleepers.
+		 */
+		if (CommitDelay < 0 && !slept && enableFsync)
+		{
+			uint32		delay = pg_atomic_read_u32(&XLogCtl->autoCommitDelay);
+
+			slept = true;
+			if (delay > 0 && MinimumActiveBackends(CommitSiblings))
+			{
+				pg_usleep(delay);
+				continue;
+			}
+		}
+
 		/*
 		 * Before actually performing the write, wait for all in-flight
 		 * insertions to the pages we're about to write to finish.
@@ -2967,8 +3040,26 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
+		/*
+		 * Time the flush, and count the requests that arrive while it's
+		 * going on, for commit_delay = -1.
+		 */
+		if (enableFsync)
+		{
+			pg_atomic_write_u32(&XLogCtl->flushRequests, 0);
+			INSTR_TIME_SET_CURRENT(start_time);
+		}
+
 		XLogWrite(WriteRqst, false);
 
+		if (enableFsync)
+		{
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start_time);
+			XLogSetAutoCommitDelay(duration,
+								   pg_atomic_read_u32(&XLogCtl->flushRequests));
+		}
+
 		LWLockRelease(WALWriteLock);
 		/* done */
 		break;
@@ -3007,6 +3098,33 @@ XLogFlush(XLogRecPtr record)
 			 (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
 }
 
+/*
+ * Choose the delay before a flush for commit_delay = -1, in microseconds,
+ * after a flush that took 'duration' and during which 'arrivals' other
+ * backends asked for a flush.
+ *
+ * Waiting only pays off if other backends become ready to flush meanwhile,
+ * so we don't wait unless more than one backend asked for a flush while the
+ * last one was going on.  Then we wait for half of the time a flush takes on
+ * average, which is the setting the documentation recommends for
+ * commit_delay, unless that is too short for a sleep to be worth it.  The
+ * caller must hold WALWriteLock.
+ */
+static void
+XLogSetAutoCommitDelay(instr_time duration, uint32 arrivals)
+{
+	double		delay;
+
+	XLogCtl->avgFlushTime = XLogCtl->avgFlushTime * 0.875 +
+		INSTR_TIME_GET_DOUBLE(duration) * 1000000.0 * 0.125;
+
+	delay = Min(XLogCtl->avgFlushTime / 2, 100000.0);
+	if (arrivals <= 1 || delay < MIN_AUTO_COMMIT_DELAY)
+		delay = 0;
+
+	pg_atomic_write_u32(&XLogCtl->autoCommitDelay, (uint32) delay);
+}
+
 /*
  * Write & flush xlog, but without specifying exactly where to.
  *
@@ -4449,6 +4567,9 @@ ReadRecord(XLogReaderState *xlogreader, int emode,
 
 				LWLockRelease(ControlFileLock);
 
+				/* ... and so can the parallel redo workers */
+				ParallelRedoMinRecoveryPointChanged();
+
 				CheckRecoveryConsistency();
 
 				/*
@@ -4981,6 +5102,54 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * Auto-tune the number of WAL insertion locks.
+ *
+ * Each concurrently inserting backend wants a lock of its own, so scale with
+ * the number of CPUs, but not beyond the point where iterating over the locks
+ * while flushing starts to cost more than the contention it saves.
+ */
+static int
+XLOGChooseNumInsertLocks(void)
+{
+	int			nlocks = 8;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpus > nlocks)
+		nlocks = (int) Min(ncpus, 64);
+#endif
+	return nlocks;
+}
+
+/*
+ * GUC check_hook for wal_insert_locks
+ */
+bool
+check_wal_insert_locks(int *newval, void **extra, GucSource source)
+{
+	/*
+	 * -1 indicates a request for auto-tune.  As with wal_buffers, the boot
+	 * value is left alone until XLOGShmemSize fixes it.
+	 */
+	if (*newval == -1)
+	{
+		if (wal_insert_locks == -1)
+			return true;
+
+		*newval = XLOGChooseNumInsertLocks();
+	}
+
+	if (*newval == 0)
+	{
+		GUC_check_errdetail("wal_insert_locks must be at least 1, or -1 to choose automatically.");
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -5059,11 +5228,22 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* Likewise for the number of WAL insertion locks */
+	if (wal_insert_locks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", XLOGChooseNumInsertLocks());
+		SetConfigOption("wal_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_OVERRIDE);
+	}
+	Assert(wal_insert_locks > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), wal_insert_locks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -5153,9 +5333,9 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * wal_insert_locks;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -5185,6 +5365,8 @@ XLOGShmemInit(void)
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
+	pg_atomic_init_u32(&XLogCtl->flushRequests, 0);
+	pg_atomic_init_u32(&XLogCtl->autoCommitDelay, 0);
 }
 
 /*
@@ -6015,6 +6197,9 @@ recoveryPausesHere(bool endOfRecovery)
 	if (LocalPromoteIsTriggered)
 		return;
 
+	/* Let the records queued so far be replayed before pausing */
+	WaitForParallelRedo();
+
 	if (endOfRecovery)
 		ereport(LOG,
 				(errmsg("pausing at the end of recovery"),
@@ -6055,6 +6240,31 @@ SetRecoveryPause(bool recoveryPause)
 	SpinLockRelease(&XLogCtl->info_lck);
 }
 
+/*
+ * Wait for the parallel redo workers to replay the records queued for them,
+ * and advance lastReplayedEndRecPtr past those.  Done before waiting for
+ * anything else, so that replay progress doesn't appear to lag meanwhile.
+ *
+ * Returns true if any records were queued, in which case we have also
+ * rechecked recovery consistency.
+ */
+static bool
+WaitForParallelRedo(void)
+{
+	XLogRecPtr	endPtr = ParallelRedoWaitForWorkers();
+
+	if (XLogRecPtrIsInvalid(endPtr))
+		return false;
+
+	SpinLockAcquire(&XLogCtl->info_lck);
+	XLogCtl->lastReplayedEndRecPtr = endPtr;
+	XLogCtl->lastReplayedTLI = ThisTimeLineID;
+	SpinLockRelease(&XLogCtl->info_lck);
+
+	CheckRecoveryConsistency();
+	return true;
+}
+
 /*
  * When recovery_min_apply_delay is set, we wait long enough to make sure
  * certain record types are applied at least that interval behind the master.
@@ -6119,6 +6329,8 @@ recoveryApplyDelay(XLogReaderState *record)
 	if (secs <= 0 && microsecs <= 0)
 		return false;
 
+	WaitForParallelRedo();
+
 	while (true)
 	{
 		ResetLatch(&XLogCtl->recoveryWakeupLatch);
@@ -6320,6 +6532,7 @@ StartupXLOG(void)
 	bool		backupFromStandby = false;
 	DBState		dbstate_at_startup;
 	XLogReaderState *xlogreader;
+	XLogPrefetcher *prefetcher;
 	XLogPageReadPrivate private;
 	bool		fast_promoted = false;
 	struct stat st;
@@ -7178,6 +7391,11 @@ StartupXLOG(void)
 					(errmsg("redo starts at %X/%X",
 							(uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
 
+			/* Launch the parallel redo workers, if any */
+			ParallelRedoStart();
+
+			prefetcher = XLogPrefetcherAllocate(ControlFile->system_identifier);
+
 			/*
 			 * main redo apply loop
 			 */
@@ -7249,6 +7467,16 @@ StartupXLOG(void)
 						recoveryPausesHere(false);
 				}
 
+				/*
+				 * Start reading the blocks that upcoming records will need.
+				 * Only read WAL that the walreceiver has already flushed,
+				 * if we're streaming.
+				 */
+				XLogPrefetcherReadAhead(prefetcher, ReadRecPtr,
+										currentSource == XLOG_FROM_STREAM ?
+										flushedUpto : InvalidXLogRecPtr,
+										ThisTimeLineID, expectedTLEs);
+
 				/* Setup error traceback support for ereport() */
 				errcallback.callback = rm_redo_error_callback;
 				errcallback.arg = (void *) xlogreader;
@@ -7321,30 +7549,38 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
-
 				/*
-				 * After redo, check whether the backup pages associated with
-				 * the WAL record are consistent with the existing pages. This
-				 * check is done only if consistency check is enabled for this
-				 * record.
+				 * Now apply the WAL record itself, or hand it over to a
+				 * parallel redo worker.  In the latter case,
+				 * lastReplayedEndRecPtr is advanced once we have waited for
+				 * the worker to replay it.
 				 */
-				if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
-					checkXLogConsistency(xlogreader);
+				if (!ParallelRedoDispatch(xlogreader))
+				{
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+
+					/*
+					 * After redo, check whether the backup pages associated
+					 * with the WAL record are consistent with the existing
+					 * pages. This check is done only if consistency check is
+					 * enabled for this record.
+					 */
+					if ((record->xl_info & XLR_CHECK_CONSISTENCY) != 0)
+						checkXLogConsistency(xlogreader);
+
+					/*
+					 * Update lastReplayedEndRecPtr after this record has been
+					 * successfully replayed.
+					 */
+					SpinLockAcquire(&XLogCtl->info_lck);
+					XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
+					XLogCtl->lastReplayedTLI = ThisTimeLineID;
+					SpinLockRelease(&XLogCtl->info_lck);
+				}
 
 				/* Pop the error context stack */
 				error_context_stack = errcallback.previous;
 
-				/*
-				 * Update lastReplayedEndRecPtr after this record has been
-				 * successfully replayed.
-				 */
-				SpinLockAcquire(&XLogCtl->info_lck);
-				XLogCtl->lastReplayedEndRecPtr = EndRecPtr;
-				XLogCtl->lastReplayedTLI = ThisTimeLineID;
-				SpinLockRelease(&XLogCtl->info_lck);
-
 				/*
 				 * If rm_redo called XLogRequestWalReceiverReply, then we wake
 				 * up the receiver so that it notices the updated
@@ -7395,6 +7631,11 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			/* Let the parallel redo workers finish and exit */
+			WaitForParallelRedo();
+			ParallelRedoEnd();
+			XLogPrefetcherFree(prefetcher);
+
 			if (reachedRecoveryTarget)
 			{
 				if (!reachedConsistency)
@@ -8025,6 +8266,14 @@ CheckRecoveryConsistency(void)
 		minRecoveryPoint <= lastReplayedEndRecPtr &&
 		XLogRecPtrIsInvalid(ControlFile->backupStartPoint))
 	{
+		/*
+		 * Let the parallel redo workers replay the records queued for them
+		 * first, so that they don't add invalid page references after the
+		 * check below.  If there were any, that brought us back here.
+		 */
+		if (WaitForParallelRedo())
+			return;
+
 		/*
 		 * Check to see if the XLOG sequence contained any unresolved
 		 * references to uninitialized pages.
@@ -8048,6 +8297,10 @@ CheckRecoveryConsistency(void)
 		reachedConsistency &&
 		IsUnderPostmaster)
 	{
+		/* queries must not see pages behind the replayed position, either */
+		if (WaitForParallelRedo())
+			return;
+
 		SpinLockAcquire(&XLogCtl->info_lck);
 		XLogCtl->SharedHotStandbyActive = true;
 		SpinLockRelease(&XLogCtl->info_lck);
@@ -8442,7 +8695,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -12227,6 +12480,7 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 						wait_time = wal_retrieve_retry_interval -
 							(secs * 1000 + usecs / 1000);
 
+						WaitForParallelRedo();
 						(void) WaitLatch(&XLogCtl->recoveryWakeupLatch,
 										 WL_LATCH_SET | WL_TIMEOUT |
 										 WL_EXIT_ON_PM_DEATH,
@@ -12470,8 +12724,10 @@ WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 					 * far and are about to start waiting for more WAL, let's
 					 * tell the upstream server our replay location now so
 					 * that pg_stat_replication doesn't show stale
-					 * information.
+					 * information.  Records queued for parallel redo
+					 * workers must be replayed first.
 					 */
+					WaitForParallelRedo();
 					if (!streaming_reply_sent)
 					{
 						WalRcvForceReply();
@@ -0,0 +1,350 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching of data blocks referenced by WAL during recovery.
+ *
+ * Redo routines read the blocks referenced by a WAL record synchronously,
+ * so on a server whose data isn't cached, recovery spends most of its time
+ * waiting for one random read after another.  The prefetcher decodes the
+ * WAL ahead of replay with a reader of its own, and for each referenced
+ * block that is not in shared buffers it asks the kernel to start reading
+ * it, using PrefetchSharedBuffer().  By the time replay gets to the record,
+ * the block is hopefully in the kernel's page cache.
+ *
+ * There is no way to know when a prefetch has completed, so we consider it
+ * done once replay has reached the record that referenced the block.  The
+ * number of prefetches in flight by that measure is limited to
+ * maintenance_io_concurrency, and we never decode further ahead of replay
+ * than XLOGPREFETCHER_MAX_DISTANCE bytes.
+ *
+ * The prefetcher only reads WAL that is already in pg_wal; it neither
+ * restores files from the archive nor waits for WAL to arrive.  When it
+ * can't read further, it stays put until replay has caught up with it and
+ * then starts over from where replay is.  Blocks that are restored from
+ * full-page images or initialized by the record are not prefetched, nor are
+ * blocks of forks other than the main fork.  Prefetching never affects the
+ * outcome of replay; at worst, it wastes some I/O.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/timeline.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+
+/* GUC variable */
+bool		recovery_prefetch = false;
+
+/* how far ahead of replay we decode WAL, in bytes */
+#define XLOGPREFETCHER_MAX_DISTANCE (512 * 1024)
+
+/* number of recently prefetched blocks we don't prefetch again */
+#define XLOGPREFETCHER_RECENT_BLOCKS 8
+
+struct XLogPrefetcher
+{
+	XLogReaderState *reader;
+
+	/*
+	 * End of the last record decoded, or InvalidXLogRecPtr if the reader has
+	 * not been positioned yet.  When reading failed, this may be moved to
+	 * the end of a segment that we couldn't open.
+	 */
+	XLogRecPtr	aheadPtr;
+	bool		stalled;		/* can't read further until replay catches up */
+
+	/* decoded record whose block references remain to be looked at */
+	bool		haveRecord;
+	int			nextBlockId;
+
+	/* arguments of the current XLogPrefetcherReadAhead call */
+	XLogRecPtr	readLimit;
+	TimeLineID	tli;
+	List	   *tles;
+	bool		atLimit;		/* reading stopped at readLimit */
+	XLogRecPtr	missingSegEnd;	/* end of a segment that doesn't exist */
+
+	/* currently open WAL segment */
+	int			file;
+	XLogSegNo	segno;
+	TimeLineID	segtli;
+
+	/* blocks prefetched recently */
+	RelFileNode recentRnode[XLOGPREFETCHER_RECENT_BLOCKS];
+	BlockNumber recentBlock[XLOGPREFETCHER_RECENT_BLOCKS];
+	int			recentNext;
+
+	/* LSNs of the records whose prefetches are in flight, oldest first */
+	int			inflightHead;
+	int			ninflight;
+	XLogRecPtr	inflight[MAX_IO_CONCURRENCY];
+};
+
+static int	XLogPrefetcherPageRead(XLogReaderState *xlogreader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static void XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherBlock(XLogPrefetcher *prefetcher, int block_id);
+
+
+/*
+ * Create a prefetcher.  system_identifier is used to validate the WAL, like
+ * in the startup process's own reader.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(uint64 system_identifier)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = (XLogPrefetcher *) palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader =
+		XLogReaderAllocate(wal_segment_size, NULL,
+						   XL_ROUTINE(.page_read = &XLogPrefetcherPageRead,
+									  .segment_open = NULL,
+									  .segment_close = NULL),
+						   prefetcher);
+	if (prefetcher->reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+	prefetcher->reader->system_identifier = system_identifier;
+	prefetcher->aheadPtr = InvalidXLogRecPtr;
+	prefetcher->file = -1;
+
+	return prefetcher;
+}
+
+/*
+ * Release a prefetcher's resources.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	XLogPrefetcherCloseFile(prefetcher);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+}
+
+/*
+ * Issue prefetches for the blocks referenced by the records following the
+ * one at replayPtr, which replay is about to apply.
+ *
+ * readLimit is the point up to which WAL may be read, or InvalidXLogRecPtr
+ * to read as far as the WAL in pg_wal is valid.  tli is the timeline being
+ * replayed, and tles the expected timeline history, if known.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogRecPtr replayPtr,
+						XLogRecPtr readLimit, TimeLineID tli, List *tles)
+{
+	if (!recovery_prefetch || maintenance_io_concurrency == 0)
+	{
+		/* start over if we are enabled again */
+		XLogPrefetcherCloseFile(prefetcher);
+		prefetcher->aheadPtr = InvalidXLogRecPtr;
+		prefetcher->ninflight = 0;
+		return;
+	}
+
+	/* the reads for records up to this one are considered done */
+	while (prefetcher->ninflight > 0 &&
+		   prefetcher->inflight[prefetcher->inflightHead] <= replayPtr)
+	{
+		prefetcher->inflightHead = (prefetcher->inflightHead + 1) % MAX_IO_CONCURRENCY;
+		prefetcher->ninflight--;
+	}
+
+	/* if replay has caught up with us, start over from where it is */
+	if (prefetcher->aheadPtr <= replayPtr)
+	{
+		XLogBeginRead(prefetcher->reader, replayPtr);
+		prefetcher->aheadPtr = replayPtr;
+		prefetcher->stalled = false;
+		prefetcher->haveRecord = false;
+	}
+	else if (prefetcher->stalled)
+		return;
+
+	prefetcher->readLimit = readLimit;
+	prefetcher->tli = tli;
+	prefetcher->tles = tles;
+
+	while (prefetcher->ninflight < maintenance_io_concurrency)
+	{
+		if (!prefetcher->haveRecord)
+		{
+			XLogRecord *record;
+			char	   *errormsg;
+
+			if (prefetcher->aheadPtr - replayPtr >= XLOGPREFETCHER_MAX_DISTANCE)
+				break;
+
+			prefetcher->atLimit = false;
+			prefetcher->missingSegEnd = InvalidXLogRecPtr;
+			record = XLogReadRecord(prefetcher->reader, &errormsg);
+			if (record == NULL)
+			{
+				/*
+				 * Unless we merely have to wait for more WAL to be streamed,
+				 * don't try again before replay has caught up with us.  If a
+				 * segment is missing, wait for replay to get past it, so
+				 * that we don't keep trying to open it.
+				 */
+				if (!prefetcher->atLimit)
+				{
+					prefetcher->stalled = true;
+					if (prefetcher->missingSegEnd > prefetcher->aheadPtr)
+						prefetcher->aheadPtr = prefetcher->missingSegEnd;
+				}
+				break;
+			}
+			prefetcher->aheadPtr = prefetcher->reader->EndRecPtr;
+
+			/* replay reads the blocks of the record it's at by itself */
+			if (prefetcher->reader->ReadRecPtr <= replayPtr)
+				continue;
+
+			prefetcher->haveRecord = true;
+			prefetcher->nextBlockId = 0;
+		}
+
+		if (prefetcher->nextBlockId > prefetcher->reader->max_block_id)
+		{
+			prefetcher->haveRecord = false;
+			continue;
+		}
+		XLogPrefetcherBlock(prefetcher, prefetcher->nextBlockId++);
+	}
+
+	prefetcher->tles = NIL;
+}
+
+/*
+ * Prefetch a block referenced by the current record, if it will be read.
+ */
+static void
+XLogPrefetcherBlock(XLogPrefetcher *prefetcher, int block_id)
+{
+	DecodedBkpBlock *blk = &prefetcher->reader->blocks[block_id];
+	SMgrRelation reln;
+	PrefetchBufferResult result;
+	int			i;
+
+	if (!blk->in_use)
+		return;
+
+	/* nothing to read if the page is restored from an image or initialized */
+	if (blk->apply_image || (blk->flags & BKPBLOCK_WILL_INIT) != 0)
+		return;
+	if (blk->forknum != MAIN_FORKNUM)
+		return;
+
+	/* consecutive records often modify the same page */
+	for (i = 0; i < XLOGPREFETCHER_RECENT_BLOCKS; i++)
+	{
+		if (prefetcher->recentBlock[i] == blk->blkno &&
+			RelFileNodeEquals(prefetcher->recentRnode[i], blk->rnode))
+			return;
+	}
+	prefetcher->recentRnode[prefetcher->recentNext] = blk->rnode;
+	prefetcher->recentBlock[prefetcher->recentNext] = blk->blkno;
+	prefetcher->recentNext = (prefetcher->recentNext + 1) % XLOGPREFETCHER_RECENT_BLOCKS;
+
+	/*
+	 * In recovery, this does nothing if the relation file doesn't exist
+	 * (yet), so records creating or dropping relations need no special
+	 * treatment.
+	 */
+	reln = smgropen(blk->rnode, InvalidBackendId);
+	result = PrefetchSharedBuffer(reln, blk->forknum, blk->blkno);
+	if (result.initiated_io)
+	{
+		i = (prefetcher->inflightHead + prefetcher->ninflight) % MAX_IO_CONCURRENCY;
+		prefetcher->inflight[i] = prefetcher->reader->ReadRecPtr;
+		prefetcher->ninflight++;
+	}
+}
+
+/*
+ * Page read callback of the prefetcher's reader.  Reads the page from the
+ * segment in pg_wal, and fails if the file doesn't exist or the page is
+ * beyond readLimit; we don't want to ereport() on anything here.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *xlogreader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) xlogreader->private_data;
+	XLogSegNo	segno;
+	TimeLineID	tli;
+	int			readLen = XLOG_BLCKSZ;
+	int			r;
+
+	if (!XLogRecPtrIsInvalid(prefetcher->readLimit))
+	{
+		if (targetPagePtr + reqLen > prefetcher->readLimit)
+		{
+			prefetcher->atLimit = true;
+			return -1;
+		}
+		readLen = Min(readLen, prefetcher->readLimit - targetPagePtr);
+	}
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	tli = prefetcher->tles != NIL ?
+		tliOfPointInHistory(targetPagePtr, prefetcher->tles) : prefetcher->tli;
+
+	if (prefetcher->file >= 0 &&
+		(prefetcher->segno != segno || prefetcher->segtli != tli))
+		XLogPrefetcherCloseFile(prefetcher);
+
+	if (prefetcher->file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, tli, segno, wal_segment_size);
+		prefetcher->file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->file < 0)
+		{
+			XLogSegNoOffsetToRecPtr(segno + 1, 0, wal_segment_size,
+									prefetcher->missingSegEnd);
+			return -1;
+		}
+		prefetcher->segno = segno;
+		prefetcher->segtli = tli;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	r = pg_pread(prefetcher->file, readBuf, XLOG_BLCKSZ,
+				 (off_t) XLogSegmentOffset(targetPagePtr, wal_segment_size));
+	pgstat_report_wait_end();
+	if (r != XLOG_BLCKSZ)
+		return -1;
+
+	return readLen;
+}
+
+static void
+XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->file >= 0)
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+}
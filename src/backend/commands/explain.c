@@ -109,6 +109,7 @@ static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
 static void show_hashagg_info(AggState *hashstate, ExplainState *es);
+static void show_nestloop_info(NestLoopState *nlstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -1748,7 +1749,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_WorkTableScan:
 		case T_SubqueryScan:
 			show_scan_qual(plan->qual, "Filter", planstate, ancestors, es);
-			if (plan->qual)
+			/* a hash join's Bloom filter also counts as the scan's filter */
+			if (plan->qual ||
+				(IsA(planstate, SeqScanState) &&
+				 ((SeqScanState *) planstate)->filter != NULL))
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
 			break;
@@ -1887,6 +1891,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			if (es->analyze)
+				show_nestloop_info((NestLoopState *) planstate, es);
 			break;
 		case T_MergeJoin:
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
@@ -3153,6 +3159,41 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show how often a NestLoop node switched to a hash
+ * table of its inner side, and how often that didn't fit in hash_mem
+ */
+static void
+show_nestloop_info(NestLoopState *nlstate, ExplainState *es)
+{
+	/* joins that can't switch have nothing to report */
+	if (nlstate->nl_Hash == NULL)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Inner Hash Builds", NULL,
+							   nlstate->nl_HashBuilds, es);
+		ExplainPropertyInteger("Inner Hash Overflows", NULL,
+							   nlstate->nl_HashOverflows, es);
+	}
+	else
+	{
+		if (nlstate->nl_HashBuilds > 0 || nlstate->nl_HashOverflows > 0)
+		{
+			ExplainIndentText(es);
+			appendStringInfoString(es->str, "Inner Hash:");
+			if (nlstate->nl_HashBuilds > 0)
+				appendStringInfo(es->str, " builds=%ld",
+								 nlstate->nl_HashBuilds);
+			if (nlstate->nl_HashOverflows > 0)
+				appendStringInfo(es->str, " overflows=%ld",
+								 nlstate->nl_HashOverflows);
+			appendStringInfoChar(es->str, '\n');
+		}
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -0,0 +1,355 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Batch-at-a-time qual evaluation for scan nodes.
+ *
+ * A scan node normally hands every tuple to ExecQual on its own, paying for
+ * the node dispatch, the slot store, the deforming and the interpretation of
+ * the expression steps once per tuple.  A scan running in batch mode instead
+ * fetches a batch of tuples at once (for a heap, all visible tuples of one
+ * page) and runs the simple part of its qual over the whole batch before it
+ * returns any tuple: each clause of the form "column op constant" becomes a
+ * tight loop over a columnar array of that column's values, narrowing down a
+ * selection vector of the tuples that still qualify.  Only the tuples that
+ * survive are stored into the scan slot, checked against the remaining
+ * clauses and projected one at a time as usual.
+ *
+ * The batch predicates run ahead of the other clauses, whatever their
+ * position in the qual, so only leakproof operators are taken: those do not
+ * throw errors depending on their input, so evaluating them early cannot
+ * make a query fail that would otherwise have succeeded.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/objectaccess.h"
+#include "catalog/pg_type.h"
+#include "executor/execBatch.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/acl.h"
+#include "utils/lsyscache.h"
+
+static bool batch_predicate_clause(Expr *clause, Var **var, Const **con,
+								   bool *constfirst);
+static int	batch_column(ScanBatch *batch, AttrNumber attnum);
+static void deform_batch_column(ScanBatch *batch, int column,
+								TupleDesc tupdesc, int nselected);
+static void deform_batch_prefix(ScanBatch *batch, TupleDesc tupdesc,
+								int nselected);
+
+
+/*
+ * ExecInitScanBatch
+ *		Set up batch mode for a scan with the given (implicitly ANDed) qual.
+ *
+ * The clauses that are not evaluated over whole batches are returned in
+ * *residual, in their original order; the caller compiles those with
+ * ExecInitQual and checks them per tuple.
+ */
+ScanBatch *
+ExecInitScanBatch(List *qual, int maxtuples, List **residual)
+{
+	ScanBatch  *batch;
+	ListCell   *lc;
+
+	Assert(maxtuples > 0 && maxtuples <= PG_UINT16_MAX);
+
+	batch = (ScanBatch *) palloc0(sizeof(ScanBatch));
+	batch->maxtuples = maxtuples;
+	batch->tuples = (HeapTupleData *) palloc(maxtuples * sizeof(HeapTupleData));
+	batch->selection = (uint16 *) palloc(maxtuples * sizeof(uint16));
+	batch->predicates = (BatchPredicate *)
+		palloc(Max(list_length(qual), 1) * sizeof(BatchPredicate));
+
+	*residual = NIL;
+	foreach(lc, qual)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+		OpExpr	   *opexpr = (OpExpr *) clause;
+		BatchPredicate *pred;
+		Var		   *var;
+		Const	   *con;
+		bool		constfirst;
+
+		if (!batch_predicate_clause(clause, &var, &con, &constfirst))
+		{
+			*residual = lappend(*residual, clause);
+			continue;
+		}
+
+		InvokeFunctionExecuteHook(opexpr->opfuncid);
+
+		pred = &batch->predicates[batch->npredicates++];
+		pred->column = batch_column(batch, var->varattno);
+		pred->constfirst = constfirst;
+		pred->constisnull = con->constisnull;
+		pred->constvalue = con->constvalue;
+		fmgr_info(opexpr->opfuncid, &pred->flinfo);
+		fmgr_info_set_expr((Node *) opexpr, &pred->flinfo);
+		pred->fcinfo = (FunctionCallInfo) palloc0(SizeForFunctionCallInfo(2));
+		InitFunctionCallInfoData(*pred->fcinfo, &pred->flinfo, 2,
+								 opexpr->inputcollid, NULL, NULL);
+		pred->fcinfo->args[constfirst ? 0 : 1].value = con->constvalue;
+		pred->fcinfo->args[constfirst ? 0 : 1].isnull = false;
+		pred->fcinfo->args[constfirst ? 1 : 0].isnull = false;
+	}
+
+	return batch;
+}
+
+/*
+ * ExecScanBatchQual
+ *		Run the batch predicates over the batch just fetched.
+ *
+ * On entry batch->ntuples and batch->tuples describe the batch; on exit
+ * batch->selection lists the tuples satisfying all predicates.  Any memory
+ * the operators allocate goes to the per-tuple context of econtext.
+ */
+void
+ExecScanBatchQual(ScanBatch *batch, TupleDesc tupdesc, ExprContext *econtext)
+{
+	MemoryContext oldcontext;
+	int			nselected = batch->ntuples;
+	uint16	   *selection = batch->selection;
+
+	for (int i = 0; i < batch->ntuples; i++)
+		selection[i] = i;
+	batch->next = 0;
+
+	if (batch->npredicates == 0)
+	{
+		batch->nselected = nselected;
+		return;
+	}
+
+	for (int c = 0; c < batch->ncolumns; c++)
+		batch->deformed[c] = false;
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	if (batch->ncolumns > 1)
+		deform_batch_prefix(batch, tupdesc, nselected);
+
+	for (int p = 0; p < batch->npredicates && nselected > 0; p++)
+	{
+		BatchPredicate *pred = &batch->predicates[p];
+		FunctionCallInfo fcinfo = pred->fcinfo;
+		NullableDatum *arg = &fcinfo->args[pred->constfirst ? 1 : 0];
+		Datum	   *values;
+		bool	   *isnull;
+		int			nkept = 0;
+
+		/* a strict operator never accepts a null constant */
+		if (pred->constisnull)
+		{
+			nselected = 0;
+			break;
+		}
+
+		if (!batch->deformed[pred->column])
+			deform_batch_column(batch, pred->column, tupdesc, nselected);
+		values = batch->values[pred->column];
+		isnull = batch->isnull[pred->column];
+
+		for (int j = 0; j < nselected; j++)
+		{
+			int			i = selection[j];
+			Datum		result;
+
+			if (isnull[i])
+				continue;
+
+			arg->value = values[i];
+			fcinfo->isnull = false;
+			result = FunctionCallInvoke(fcinfo);
+			if (!fcinfo->isnull && DatumGetBool(result))
+				selection[nkept++] = i;
+		}
+		nselected = nkept;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	batch->nselected = nselected;
+}
+
+/*
+ * ExecResetScanBatch
+ *		Forget the current batch, e.g. because the scan is restarted.
+ */
+void
+ExecResetScanBatch(ScanBatch *batch)
+{
+	batch->ntuples = 0;
+	batch->nselected = 0;
+	batch->next = 0;
+}
+
+/*
+ * Can this qual clause be evaluated as a batch predicate?  If so, return its
+ * column and constant, and whether the constant is the left input.
+ */
+static bool
+batch_predicate_clause(Expr *clause, Var **var, Const **con, bool *constfirst)
+{
+	OpExpr	   *opexpr;
+	Node	   *left;
+	Node	   *right;
+
+	if (!IsA(clause, OpExpr))
+		return false;
+	opexpr = (OpExpr *) clause;
+	if (list_length(opexpr->args) != 2 || opexpr->opretset ||
+		opexpr->opresulttype != BOOLOID)
+		return false;
+
+	left = (Node *) linitial(opexpr->args);
+	while (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+	right = (Node *) lsecond(opexpr->args);
+	while (IsA(right, RelabelType))
+		right = (Node *) ((RelabelType *) right)->arg;
+
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		*var = (Var *) left;
+		*con = (Const *) right;
+		*constfirst = false;
+	}
+	else if (IsA(left, Const) && IsA(right, Var))
+	{
+		*var = (Var *) right;
+		*con = (Const *) left;
+		*constfirst = true;
+	}
+	else
+		return false;
+
+	/* only plain user columns of the scanned relation */
+	if ((*var)->varattno <= 0 || (*var)->varlevelsup != 0)
+		return false;
+
+	set_opfuncid(opexpr);
+	if (!func_strict(opexpr->opfuncid) ||
+		!get_func_leakproof(opexpr->opfuncid))
+		return false;
+
+	/* leave permission failures to be reported by ExecInitQual */
+	if (pg_proc_aclcheck(opexpr->opfuncid, GetUserId(),
+						 ACL_EXECUTE) != ACLCHECK_OK)
+		return false;
+
+	return true;
+}
+
+/*
+ * Return the index of the column array for attnum, adding one if needed.
+ */
+static int
+batch_column(ScanBatch *batch, AttrNumber attnum)
+{
+	int			c;
+
+	for (c = 0; c < batch->ncolumns; c++)
+	{
+		if (batch->attnums[c] == attnum)
+			return c;
+	}
+
+	if (batch->ncolumns == 0)
+	{
+		batch->attnums = (AttrNumber *) palloc(sizeof(AttrNumber));
+		batch->deformed = (bool *) palloc(sizeof(bool));
+		batch->values = (Datum **) palloc(sizeof(Datum *));
+		batch->isnull = (bool **) palloc(sizeof(bool *));
+	}
+	else
+	{
+		batch->attnums = (AttrNumber *)
+			repalloc(batch->attnums, (c + 1) * sizeof(AttrNumber));
+		batch->deformed = (bool *)
+			repalloc(batch->deformed, (c + 1) * sizeof(bool));
+		batch->values = (Datum **)
+			repalloc(batch->values, (c + 1) * sizeof(Datum *));
+		batch->isnull = (bool **)
+			repalloc(batch->isnull, (c + 1) * sizeof(bool *));
+	}
+
+	batch->attnums[c] = attnum;
+	batch->deformed[c] = false;
+	batch->values[c] = (Datum *) palloc(batch->maxtuples * sizeof(Datum));
+	batch->isnull[c] = (bool *) palloc(batch->maxtuples * sizeof(bool));
+	batch->ncolumns++;
+
+	return c;
+}
+
+/*
+ * Extract one column of the first nselected tuples of the selection vector
+ * into its columnar array.
+ */
+static void
+deform_batch_column(ScanBatch *batch, int column, TupleDesc tupdesc,
+					int nselected)
+{
+	heap_deform_column_batch(tupdesc, batch->tuples, batch->selection,
+							 nselected, batch->attnums[column],
+							 batch->values[column], batch->isnull[column]);
+	batch->deformed[column] = true;
+}
+
+/*
+ * Extract all columns within the fixed-width prefix of the descriptor for
+ * the first nselected tuples, in a single pass over the page.  Those are
+ * cheap enough to fetch that doing so for tuples a predicate is about to
+ * reject costs less than visiting every tuple again for each column.  The
+ * other columns are left to deform_batch_column.
+ */
+static void
+deform_batch_prefix(ScanBatch *batch, TupleDesc tupdesc, int nselected)
+{
+	int			nfixed = heap_fixed_prefix_natts(tupdesc);
+	AttrNumber *attnums;
+	Datum	  **values;
+	bool	  **isnull;
+	int			ncolumns = 0;
+
+	attnums = (AttrNumber *) palloc(batch->ncolumns * sizeof(AttrNumber));
+	values = (Datum **) palloc(batch->ncolumns * sizeof(Datum *));
+	isnull = (bool **) palloc(batch->ncolumns * sizeof(bool *));
+
+	for (int c = 0; c < batch->ncolumns; c++)
+	{
+		if (batch->attnums[c] > nfixed)
+			continue;
+		attnums[ncolumns] = batch->attnums[c];
+		values[ncolumns] = batch->values[c];
+		isnull[ncolumns] = batch->isnull[c];
+		ncolumns++;
+	}
+
+	if (ncolumns > 1)
+	{
+		heap_deform_prefix_batch(tupdesc, batch->tuples, batch->selection,
+								 nselected, ncolumns, attnums, values, isnull);
+		for (int c = 0; c < batch->ncolumns; c++)
+		{
+			if (batch->attnums[c] <= nfixed)
+				batch->deformed[c] = true;
+		}
+	}
+
+	pfree(attnums);
+	pfree(values);
+	pfree(isnull);
+}
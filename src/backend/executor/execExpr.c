@@ -355,13 +355,38 @@ ExecBuildProjectionInfo(List *targetList,
 						TupleTableSlot *slot,
 						PlanState *parent,
 						TupleDesc inputDesc)
+{
+	return ExecBuildFilteredProjectionInfo(NIL, targetList, econtext, slot,
+										   parent, inputDesc);
+}
+
+/*
+ *		ExecBuildFilteredProjectionInfo
+ *
+ * As ExecBuildProjectionInfo, but the projection first checks the given qual
+ * (in implicit-AND format, as for ExecInitQual), and only projects if it is
+ * satisfied; evaluate it with ExecProjectIfQual.
+ *
+ * Checking the qual and projecting in one expression means the input tuple
+ * is deformed by one step, and a JIT compiled plan node makes one call into
+ * generated code per tuple rather than two.
+ */
+ProjectionInfo *
+ExecBuildFilteredProjectionInfo(List *qual,
+								List *targetList,
+								ExprContext *econtext,
+								TupleTableSlot *slot,
+								PlanState *parent,
+								TupleDesc inputDesc)
 {
 	ProjectionInfo *projInfo = makeNode(ProjectionInfo);
 	ExprState  *state;
 	ExprEvalStep scratch = {0};
+	List	   *adjust_jumps = NIL;
 	ListCell   *lc;
 
 	projInfo->pi_exprContext = econtext;
+	projInfo->pi_hasqual = (qual != NIL);
 	/* We embed ExprState into ProjectionInfo instead of doing extra palloc */
 	projInfo->pi_state.tag = T_ExprState;
 	state = &projInfo->pi_state;
@@ -372,7 +397,28 @@ ExecBuildProjectionInfo(List *targetList,
 	state->resultslot = slot;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
-	ExecInitExprSlots(state, (Node *) targetList);
+	if (qual != NIL)
+		ExecInitExprSlots(state, (Node *) list_make2(qual, targetList));
+	else
+		ExecInitExprSlots(state, (Node *) targetList);
+
+	/* Check the qual first, just like ExecInitQual does */
+	foreach(lc, qual)
+	{
+		Expr	   *node = (Expr *) lfirst(lc);
+
+		ExecInitExprRec(node, state, &state->resvalue, &state->resnull);
+
+		scratch.opcode = EEOP_QUAL;
+		scratch.resvalue = &state->resvalue;
+		scratch.resnull = &state->resnull;
+		scratch.d.qualexpr.jumpdone = -1;
+		ExprEvalPushStep(state, &scratch);
+		adjust_jumps = lappend_int(adjust_jumps,
+								   state->steps_len - 1);
+	}
+	scratch.resvalue = NULL;
+	scratch.resnull = NULL;
 
 	/* Now compile each tlist column */
 	foreach(lc, targetList)
@@ -469,6 +515,27 @@ ExecBuildProjectionInfo(List *targetList,
 		}
 	}
 
+	if (qual != NIL)
+	{
+		/* projected, so the qual was satisfied: return true */
+		scratch.opcode = EEOP_CONST;
+		scratch.resvalue = &state->resvalue;
+		scratch.resnull = &state->resnull;
+		scratch.d.constval.value = BoolGetDatum(true);
+		scratch.d.constval.isnull = false;
+		ExprEvalPushStep(state, &scratch);
+
+		/* a failed qual jumps past that, returning false */
+		foreach(lc, adjust_jumps)
+		{
+			ExprEvalStep *as = &state->steps[lfirst_int(lc)];
+
+			Assert(as->opcode == EEOP_QUAL);
+			Assert(as->d.qualexpr.jumpdone == -1);
+			as->d.qualexpr.jumpdone = state->steps_len;
+		}
+	}
+
 	scratch.opcode = EEOP_DONE;
 	ExprEvalPushStep(state, &scratch);
 
@@ -50,6 +50,7 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSubplan.h"
 #include "foreign/fdwapi.h"
+#include "lero/calibration.h"
 #include "jit/jit.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
@@ -177,6 +178,13 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
 		ExecCheckXactReadOnly(queryDesc->plannedstmt);
 
+	/*
+	 * Lero cost calibration needs timing and buffer usage of every node of
+	 * the queries it samples
+	 */
+	if (lero_cost_calibration && !(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		queryDesc->instrument_options |= lero_calibration_instrument_options();
+
 	/*
 	 * Build EState, switch into per-query memory context for startup.
 	 */
@@ -251,7 +259,17 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_crosscheck_snapshot = RegisterSnapshot(queryDesc->crosscheck_snapshot);
 	estate->es_top_eflags = eflags;
 	estate->es_instrument = queryDesc->instrument_options;
-	estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
+	if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+	{
+		bool		tracked;
+
+		estate->es_jit_flags = jit_plan_flags(queryDesc->plannedstmt,
+											  &tracked);
+		if (tracked)
+			INSTR_TIME_SET_CURRENT(estate->es_jit_starttime);
+	}
+	else
+		estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
 
 	/*
 	 * Set up an AFTER-trigger statement context, unless told not to, or
@@ -493,8 +511,23 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	 */
 	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
 
+	if (lero_cost_calibration)
+		lero_calibration_collect(queryDesc);
+
 	ExecEndPlan(queryDesc->planstate, estate);
 
+	/* let JIT know how this execution of a reused plan went */
+	if (!INSTR_TIME_IS_ZERO(estate->es_jit_starttime))
+	{
+		instr_time	elapsed;
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, estate->es_jit_starttime);
+		jit_report_plan(queryDesc->plannedstmt, estate->es_jit,
+						estate->es_jit_worker_instr,
+						INSTR_TIME_GET_MILLISEC(elapsed));
+	}
+
 	/* do away with our snapshots */
 	UnregisterSnapshot(estate->es_snapshot);
 	UnregisterSnapshot(estate->es_crosscheck_snapshot);
@@ -224,7 +224,17 @@ ExecScan(ScanState *node,
 		 * when the qual is null ... saves only a few cycles, but they add up
 		 * ...
 		 */
-		if (qual == NULL || ExecQual(qual, econtext))
+		if (projInfo && projInfo->pi_hasqual)
+		{
+			/*
+			 * The qual is checked by the projection itself; return the
+			 * projected tuple if it passed.
+			 */
+			if (ExecProjectIfQual(projInfo))
+				return projInfo->pi_state.resultslot;
+			InstrCountFiltered1(node, 1);
+		}
+		else if (qual == NULL || ExecQual(qual, econtext))
 		{
 			/*
 			 * Found a satisfactory scan tuple.
@@ -289,6 +299,23 @@ ExecAssignScanProjectionInfoWithVarno(ScanState *node, Index varno)
 	ExecConditionalAssignProjectionInfo(&node->ps, tupdesc, varno);
 }
 
+/*
+ * ExecAssignScanProjectionInfoQual
+ *		As ExecAssignScanProjectionInfo, and also set up the node's qual.
+ *
+ * When the qual gets built into the projection info, as it may with JIT
+ * compilation, ExecScan checks it while projecting.
+ */
+void
+ExecAssignScanProjectionInfoQual(ScanState *node, List *qual)
+{
+	Scan	   *scan = (Scan *) node->ps.plan;
+	TupleDesc	tupdesc = node->ss_ScanTupleSlot->tts_tupleDescriptor;
+
+	ExecConditionalAssignProjectionInfoQual(&node->ps, tupdesc,
+											scan->scanrelid, qual);
+}
+
 /*
  * ExecScanReScan
  *
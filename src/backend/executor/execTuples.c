@@ -929,6 +929,24 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 
 	tp = (char *) tup + tup->t_hoff;
 
+	/*
+	 * Without nulls, the leading fixed-width attributes are at the same
+	 * offsets in every tuple; extract them in one go.
+	 */
+	if (attnum == 0 && !hasnulls)
+	{
+		int			nfixed = Min(heap_fixed_prefix_natts(tupleDesc), natts);
+
+		if (nfixed > 0)
+		{
+			Form_pg_attribute lastatt = TupleDescAttr(tupleDesc, nfixed - 1);
+
+			heap_deform_fixed_prefix(tupleDesc, tp, nfixed, values, isnull);
+			attnum = nfixed;
+			off = lastatt->attcacheoff + lastatt->attlen;
+		}
+	}
+
 	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
@@ -583,6 +583,50 @@ ExecConditionalAssignProjectionInfo(PlanState *planstate, TupleDesc inputDesc,
 	}
 }
 
+/* ----------------
+ *		ExecConditionalAssignProjectionInfoQual
+ *
+ * as ExecConditionalAssignProjectionInfo, and also initialize the node's
+ * qual from the given list.  If a projection is required and expressions
+ * are JIT compiled, the qual is built into the projection info instead (see
+ * ExecBuildFilteredProjectionInfo), and planstate->qual is left NULL; the
+ * node must then evaluate the projection with ExecProjectIfQual.
+ * ----------------
+ */
+void
+ExecConditionalAssignProjectionInfoQual(PlanState *planstate,
+										TupleDesc inputDesc, Index varno,
+										List *qual)
+{
+	if (qual == NIL ||
+		!(planstate->state->es_jit_flags & PGJIT_EXPR) ||
+		tlist_matches_tupdesc(planstate,
+							  planstate->plan->targetlist,
+							  varno,
+							  inputDesc))
+	{
+		ExecConditionalAssignProjectionInfo(planstate, inputDesc, varno);
+		planstate->qual = ExecInitQual(qual, planstate);
+		return;
+	}
+
+	if (!planstate->ps_ResultTupleSlot)
+	{
+		ExecInitResultSlot(planstate, &TTSOpsVirtual);
+		planstate->resultops = &TTSOpsVirtual;
+		planstate->resultopsfixed = true;
+		planstate->resultopsset = true;
+	}
+	planstate->ps_ProjInfo =
+		ExecBuildFilteredProjectionInfo(qual,
+										planstate->plan->targetlist,
+										planstate->ps_ExprContext,
+										planstate->ps_ResultTupleSlot,
+										planstate,
+										inputDesc);
+	planstate->qual = NULL;
+}
+
 static bool
 tlist_matches_tupdesc(PlanState *ps, List *tlist, Index varno, TupleDesc tupdesc)
 {
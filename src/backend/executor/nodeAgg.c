@@ -256,6 +256,8 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -264,6 +266,7 @@
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
 
@@ -311,6 +314,60 @@
  */
 #define CHUNKHDRSZ 16
 
+/*
+ * Once the hash table of a single grouping set has outgrown the CPU caches,
+ * nearly every lookup misses on the bucket and again on the group's key
+ * tuple.  agg_fill_hash_table then reads HASHAGG_CHUNK_SIZE input tuples at
+ * a time, computes their hash values and prefetches their buckets, and
+ * while aggregating each tuple prefetches the key tuple of the group that
+ * HASHAGG_PREFETCH_DISTANCE tuples ahead hashes to, so that the misses of
+ * neighbouring tuples overlap.  The tuples are still aggregated in input
+ * order.
+ */
+#define HASHAGG_CHUNK_SIZE 64
+#define HASHAGG_PREFETCH_DISTANCE 8
+#define HASHAGG_CHUNK_MIN_BUCKETS (64 * 1024)
+
+/*
+ * A parallel-aware HashAgg, which is always a Finalize Agg below the Gather,
+ * lets the participants aggregate disjoint sets of groups.  Every participant
+ * first routes the partially aggregated groups it reads to one of a number
+ * of shared partitions, by the high bits of their hash values.  Once all
+ * have done so, each participant repeatedly claims a partition and
+ * aggregates it on its own, just like a batch of spilled tuples; a partition
+ * too large for memory spills again to the participant's private tapes.  All
+ * states of a group land in the same partition, so no group is emitted
+ * twice.
+ *
+ * We create a few partitions per participant, so that the work evens out
+ * when the partitions differ in size, but not so many that the write
+ * buffers of all partitions take much memory.
+ */
+#define HASHAGG_SHARED_PARTITIONS_PER_PARTICIPANT 4
+#define HASHAGG_SHARED_MAX_PARTITIONS 256
+
+/* the shared state lives under a key of its own, see ExecAggInitializeDSM */
+#define PARALLEL_KEY_HASHAGG_SHARED(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (uint64) (plan_node_id))
+
+/* phases of ParallelHashAggState's barrier */
+#define PHA_PARTITIONING			0
+#define PHA_AGGREGATING				1
+
+typedef struct ParallelHashAggState
+{
+	SharedFileSet fileset;		/* space for the partitions */
+	Barrier		barrier;		/* have all participants partitioned? */
+	pg_atomic_uint32 next_partition;	/* next partition to claim */
+	int			nparticipants;
+	int			npartitions;
+	Size		sts_size;		/* space taken by each SharedTuplestore */
+	char		partitions[FLEXIBLE_ARRAY_MEMBER];	/* npartitions of them */
+} ParallelHashAggState;
+
+#define HashAggSharedPartition(pstate, i) \
+	((SharedTuplestore *) ((pstate)->partitions + (i) * (pstate)->sts_size))
+
 /*
  * Track all tapes needed for a HashAgg that spills. We don't know the maximum
  * number of tapes needed at the start of the algorithm (because it can
@@ -367,6 +424,7 @@ typedef struct HashAggBatch
 	int			used_bits;		/* number of bits of hash already used */
 	LogicalTapeSet *tapeset;	/* borrowed reference to tape set */
 	int			input_tapenum;	/* input partition tape */
+	SharedTuplestoreAccessor *sts;	/* or shared partition, if not NULL */
 	int64		input_tuples;	/* number of tuples in this batch */
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
@@ -430,9 +488,11 @@ static int	hash_choose_num_partitions(double input_groups,
 static void initialize_hash_entry(AggState *aggstate,
 								  TupleHashTable hashtable,
 								  TupleHashEntry entry);
-static void lookup_hash_entries(AggState *aggstate);
+static void lookup_hash_entries(AggState *aggstate, uint32 *hashes);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static bool agg_fill_hash_table_chunk(AggState *aggstate);
+static void agg_fill_shared_partitions(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
@@ -442,6 +502,7 @@ static void hash_agg_update_metrics(AggState *aggstate, bool from_tape,
 									int npartitions);
 static void hashagg_finish_initial_spills(AggState *aggstate);
 static void hashagg_reset_spill_state(AggState *aggstate);
+static HashAggBatch *hashagg_claim_shared_batch(AggState *aggstate);
 static HashAggBatch *hashagg_batch_new(LogicalTapeSet *tapeset,
 									   int input_tapenum, int setno,
 									   int64 input_tuples, double input_card,
@@ -450,6 +511,8 @@ static MinimalTuple hashagg_batch_read(HashAggBatch *batch, uint32 *hashp);
 static void hashagg_spill_init(HashAggSpill *spill, HashTapeInfo *tapeinfo,
 							   int used_bits, double input_groups,
 							   double hashentrysize);
+static TupleTableSlot *hashagg_spill_slot(AggState *aggstate,
+										  TupleTableSlot *inputslot);
 static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *slot, uint32 hash);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
@@ -458,6 +521,10 @@ static void hashagg_tapeinfo_init(AggState *aggstate);
 static void hashagg_tapeinfo_assign(HashTapeInfo *tapeinfo, int *dest,
 									int ndest);
 static void hashagg_tapeinfo_release(HashTapeInfo *tapeinfo, int tapenum);
+static int	hashagg_shared_num_partitions(int nparticipants);
+static Size hashagg_shared_size(int nparticipants);
+static void hashagg_shared_init_partitions(AggState *aggstate,
+										   ParallelHashAggState *pstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 									  AggState *aggstate, EState *estate,
@@ -1888,6 +1955,13 @@ hash_agg_enter_spill_mode(AggState *aggstate)
 
 		hashagg_tapeinfo_init(aggstate);
 
+		/*
+		 * While aggregating a shared partition, agg_refill_hash_table sets up
+		 * its own spill.
+		 */
+		if (aggstate->table_filled)
+			return;
+
 		aggstate->hash_spills = palloc(sizeof(HashAggSpill) * aggstate->num_hashes);
 
 		for (int setno = 0; setno < aggstate->num_hashes; setno++)
@@ -2068,6 +2142,8 @@ initialize_hash_entry(AggState *aggstate, TupleHashTable hashtable,
 /*
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
+ * If hashes isn't NULL, it holds the tuple's hash value for each set,
+ * computed in advance by the caller.
  *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  *
@@ -2084,7 +2160,7 @@ initialize_hash_entry(AggState *aggstate, TupleHashTable hashtable,
  * efficient.
  */
 static void
-lookup_hash_entries(AggState *aggstate)
+lookup_hash_entries(AggState *aggstate, uint32 *hashes)
 {
 	AggStatePerGroup *pergroup = aggstate->hash_pergroup;
 	TupleTableSlot *outerslot = aggstate->tmpcontext->ecxt_outertuple;
@@ -2108,8 +2184,15 @@ lookup_hash_entries(AggState *aggstate)
 						  outerslot,
 						  hashslot);
 
-		entry = LookupTupleHashEntry(hashtable, hashslot,
-									 p_isnew, &hash);
+		if (hashes != NULL)
+		{
+			hash = hashes[setno];
+			entry = LookupTupleHashEntryHash(hashtable, hashslot,
+											 p_isnew, hash);
+		}
+		else
+			entry = LookupTupleHashEntry(hashtable, hashslot,
+										 p_isnew, &hash);
 
 		if (entry != NULL)
 		{
@@ -2439,7 +2522,7 @@ agg_retrieve_direct(AggState *aggstate)
 					if (aggstate->aggstrategy == AGG_MIXED &&
 						aggstate->current_phase == 1)
 					{
-						lookup_hash_entries(aggstate);
+						lookup_hash_entries(aggstate, NULL);
 					}
 
 					/* Advance the aggregates (or combine functions) */
@@ -2534,12 +2617,29 @@ agg_fill_hash_table(AggState *aggstate)
 	TupleTableSlot *outerslot;
 	ExprContext *tmpcontext = aggstate->tmpcontext;
 
+	/* parallel-aware?  then only partition the input */
+	if (aggstate->hash_shared != NULL)
+	{
+		agg_fill_shared_partitions(aggstate);
+		return;
+	}
+
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
 	 * exhaust the outer plan.
 	 */
 	for (;;)
 	{
+		/* large hash table?  then process a chunk of tuples at once */
+		if (aggstate->num_hashes == 1 &&
+			aggstate->perhash[0].hashtable->hashtab->size >=
+			HASHAGG_CHUNK_MIN_BUCKETS)
+		{
+			if (!agg_fill_hash_table_chunk(aggstate))
+				break;
+			continue;
+		}
+
 		outerslot = fetch_input_tuple(aggstate);
 		if (TupIsNull(outerslot))
 			break;
@@ -2548,7 +2648,7 @@ agg_fill_hash_table(AggState *aggstate)
 		tmpcontext->ecxt_outertuple = outerslot;
 
 		/* Find or build hashtable entries */
-		lookup_hash_entries(aggstate);
+		lookup_hash_entries(aggstate, NULL);
 
 		/* Advance the aggregates (or combine functions) */
 		advance_aggregates(aggstate);
@@ -2570,6 +2670,150 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * Read up to HASHAGG_CHUNK_SIZE input tuples, and aggregate them into the
+ * hash table of the only grouping set, prefetching the hash table entries
+ * they need before they are needed.  Returns false if the input has been
+ * exhausted.
+ */
+static bool
+agg_fill_hash_table_chunk(AggState *aggstate)
+{
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	TupleHashTable hashtable = perhash->hashtable;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot **slots;
+	uint32	   *hashes;
+	int			ntuples = 0;
+	bool		more = true;
+
+	if (aggstate->hash_chunk_slots == NULL)
+	{
+		PlanState  *outerNode = outerPlanState(aggstate);
+		EState	   *estate = aggstate->ss.ps.state;
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		aggstate->hash_chunk_slots = (TupleTableSlot **)
+			palloc(HASHAGG_CHUNK_SIZE * sizeof(TupleTableSlot *));
+		for (int i = 0; i < HASHAGG_CHUNK_SIZE; i++)
+			aggstate->hash_chunk_slots[i] =
+				ExecInitExtraTupleSlot(estate, ExecGetResultType(outerNode),
+									   ExecGetResultSlotOps(outerNode, NULL));
+		aggstate->hash_chunk_hashes = (uint32 *)
+			palloc(HASHAGG_CHUNK_SIZE * sizeof(uint32));
+		MemoryContextSwitchTo(oldcontext);
+	}
+	slots = aggstate->hash_chunk_slots;
+	hashes = aggstate->hash_chunk_hashes;
+
+	/* read the chunk, hash it and prefetch the buckets */
+	select_current_set(aggstate, 0, true);
+	while (ntuples < HASHAGG_CHUNK_SIZE)
+	{
+		TupleTableSlot *outerslot = fetch_input_tuple(aggstate);
+
+		if (TupIsNull(outerslot))
+		{
+			more = false;
+			break;
+		}
+
+		ExecCopySlot(slots[ntuples], outerslot);
+		prepare_hash_slot(perhash, slots[ntuples], perhash->hashslot);
+		hashes[ntuples] = TupleHashTableHash(hashtable, perhash->hashslot);
+		pg_prefetch_mem(&hashtable->hashtab->data[hashes[ntuples] &
+												  hashtable->hashtab->sizemask]);
+		ntuples++;
+	}
+	ResetExprContext(tmpcontext);
+
+	for (int i = 0; i < ntuples; i++)
+	{
+		/*
+		 * The bucket of a tuple further ahead should be in cache by now;
+		 * prefetch the key tuple of the entry in it.  It might not be the
+		 * right entry, or no entry at all, but usually is.
+		 */
+		if (i + HASHAGG_PREFETCH_DISTANCE < ntuples)
+		{
+			uint32		ahead = hashes[i + HASHAGG_PREFETCH_DISTANCE];
+
+			pg_prefetch_mem(hashtable->hashtab->data[ahead &
+													 hashtable->hashtab->sizemask].firstTuple);
+		}
+
+		tmpcontext->ecxt_outertuple = slots[i];
+		lookup_hash_entries(aggstate, &hashes[i]);
+		advance_aggregates(aggstate);
+		ResetExprContext(tmpcontext);
+
+		/* release any buffer pin early */
+		ExecClearTuple(slots[i]);
+	}
+
+	return more;
+}
+
+/*
+ * ExecAgg for a parallel-aware hashed Agg: route the input to the shared
+ * partitions, and wait for the other participants to do the same.  The
+ * groups are then aggregated by agg_refill_hash_table, one claimed partition
+ * at a time, starting from an empty hash table.
+ *
+ * A participant attaching after the partitioning finished has no input left
+ * to read: the others could only have finished once the parallel scans below
+ * were exhausted.
+ */
+static void
+agg_fill_shared_partitions(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->hash_shared;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	int			shift = 32 - my_log2(pstate->npartitions);
+
+	Assert(aggstate->num_hashes == 1);
+
+	if (BarrierAttach(&pstate->barrier) == PHA_PARTITIONING)
+	{
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			TupleTableSlot *spillslot;
+			MinimalTuple tuple;
+			bool		shouldFree;
+			uint32		hash;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+
+			spillslot = hashagg_spill_slot(aggstate, outerslot);
+			tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
+			sts_puttuple(aggstate->hash_shared_sts[hash >> shift], &hash,
+						 tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(aggstate->tmpcontext);
+		}
+
+		for (int i = 0; i < pstate->npartitions; i++)
+			sts_end_write(aggstate->hash_shared_sts[i]);
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+	BarrierDetach(&pstate->barrier);
+
+	aggstate->table_filled = true;
+	/* the hash table is still empty; the first partition is claimed next */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+}
+
 /*
  * If any data was spilled during hash aggregation, reset the hash table and
  * reprocess one batch of spilled data. After reprocessing a batch, the hash
@@ -2588,15 +2832,23 @@ agg_refill_hash_table(AggState *aggstate)
 	HashAggBatch *batch;
 	AggStatePerHash perhash;
 	HashAggSpill spill;
-	HashTapeInfo *tapeinfo = aggstate->hash_tapeinfo;
 	bool		spill_initialized = false;
 
-	if (aggstate->hash_batches == NIL)
+	if (aggstate->hash_batches != NIL)
+	{
+		batch = linitial(aggstate->hash_batches);
+		aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+	}
+	else if (aggstate->hash_shared != NULL)
+	{
+		/* our own spilled batches are done; go on with the next partition */
+		batch = hashagg_claim_shared_batch(aggstate);
+		if (batch == NULL)
+			return false;
+	}
+	else
 		return false;
 
-	batch = linitial(aggstate->hash_batches);
-	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
-
 	hash_agg_set_limits(aggstate->hashentrysize, batch->input_card,
 						batch->used_bits, &aggstate->hash_mem_limit,
 						&aggstate->hash_ngroups_limit, NULL);
@@ -2680,7 +2932,8 @@ agg_refill_hash_table(AggState *aggstate)
 				 * that we don't assign tapes that will never be used.
 				 */
 				spill_initialized = true;
-				hashagg_spill_init(&spill, tapeinfo, batch->used_bits,
+				hashagg_spill_init(&spill, aggstate->hash_tapeinfo,
+								   batch->used_bits,
 								   batch->input_card, aggstate->hashentrysize);
 			}
 			/* no memory for a new group, spill */
@@ -2696,7 +2949,11 @@ agg_refill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
-	hashagg_tapeinfo_release(tapeinfo, batch->input_tapenum);
+	if (batch->sts != NULL)
+		sts_end_parallel_scan(batch->sts);
+	else
+		hashagg_tapeinfo_release(aggstate->hash_tapeinfo,
+								 batch->input_tapenum);
 
 	/* change back to phase 0 */
 	aggstate->current_phase = 0;
@@ -2963,6 +3220,38 @@ hashagg_spill_init(HashAggSpill *spill, HashTapeInfo *tapeinfo, int used_bits,
 		initHyperLogLog(&spill->hll_card[i], HASHAGG_HLL_BIT_WIDTH);
 }
 
+/*
+ * hashagg_spill_slot
+ *
+ * Return a slot holding only the attributes of the input tuple that we
+ * actually need, to be written out.
+ */
+static TupleTableSlot *
+hashagg_spill_slot(AggState *aggstate, TupleTableSlot *inputslot)
+{
+	TupleTableSlot *spillslot;
+
+	if (aggstate->all_cols_needed)
+		return inputslot;
+
+	spillslot = aggstate->hash_spill_wslot;
+	slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
+	ExecClearTuple(spillslot);
+	for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
+	{
+		if (bms_is_member(i + 1, aggstate->colnos_needed))
+		{
+			spillslot->tts_values[i] = inputslot->tts_values[i];
+			spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
+		}
+		else
+			spillslot->tts_isnull[i] = true;
+	}
+	ExecStoreVirtualTuple(spillslot);
+
+	return spillslot;
+}
+
 /*
  * hashagg_spill_tuple
  *
@@ -2983,27 +3272,7 @@ hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 
 	Assert(spill->partitions != NULL);
 
-	/* spill only attributes that we actually need */
-	if (!aggstate->all_cols_needed)
-	{
-		spillslot = aggstate->hash_spill_wslot;
-		slot_getsomeattrs(inputslot, aggstate->max_colno_needed);
-		ExecClearTuple(spillslot);
-		for (int i = 0; i < spillslot->tts_tupleDescriptor->natts; i++)
-		{
-			if (bms_is_member(i + 1, aggstate->colnos_needed))
-			{
-				spillslot->tts_values[i] = inputslot->tts_values[i];
-				spillslot->tts_isnull[i] = inputslot->tts_isnull[i];
-			}
-			else
-				spillslot->tts_isnull[i] = true;
-		}
-		ExecStoreVirtualTuple(spillslot);
-	}
-	else
-		spillslot = inputslot;
-
+	spillslot = hashagg_spill_slot(aggstate, inputslot);
 	tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
 
 	partition = (hash & spill->mask) >> spill->shift;
@@ -3052,6 +3321,37 @@ hashagg_batch_new(LogicalTapeSet *tapeset, int tapenum, int setno,
 	return batch;
 }
 
+/*
+ * hashagg_claim_shared_batch
+ *
+ * Claim the next shared partition not yet aggregated by any participant, and
+ * construct a HashAggBatch reading it.  Returns NULL if there are none left.
+ */
+static HashAggBatch *
+hashagg_claim_shared_batch(AggState *aggstate)
+{
+	ParallelHashAggState *pstate = aggstate->hash_shared;
+	HashAggBatch *batch;
+	uint32		partition;
+	double		input_card;
+
+	partition = pg_atomic_fetch_add_u32(&pstate->next_partition, 1);
+	if (partition >= pstate->npartitions)
+		return NULL;
+
+	/* the planner's estimate is per participant */
+	input_card = aggstate->perhash[0].aggnode->numGroups *
+		pstate->nparticipants / pstate->npartitions;
+
+	batch = hashagg_batch_new(NULL, -1, 0, 0, Max(input_card, 1.0),
+							  my_log2(pstate->npartitions));
+	batch->sts = aggstate->hash_shared_sts[partition];
+	sts_begin_parallel_scan(batch->sts);
+	aggstate->hash_batches_used++;
+
+	return batch;
+}
+
 /*
  * read_spilled_tuple
  * 		read the next tuple from a batch's tape.  Return NULL if no more.
@@ -3066,6 +3366,17 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	size_t		nread;
 	uint32		hash;
 
+	if (batch->sts != NULL)
+	{
+		tuple = sts_parallel_scan_next(batch->sts, &hash);
+		if (tuple == NULL)
+			return NULL;
+		if (hashp != NULL)
+			*hashp = hash;
+		/* the caller frees the tuple, so it must be a copy of our own */
+		return heap_copy_minimal_tuple(tuple);
+	}
+
 	nread = LogicalTapeRead(tapeset, tapenum, &hash, sizeof(uint32));
 	if (nread == 0)
 		return NULL;
@@ -4658,6 +4969,7 @@ ExecReScanAgg(AggState *node)
 		 * again.
 		 */
 		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+			node->hash_shared == NULL &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4969,6 +5281,14 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	/* parallel-aware?  then we need the shared partitions */
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   hashagg_shared_size(pcxt->nworkers + 1));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4982,7 +5302,8 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for the shared partitions of a
+ *		parallel-aware aggregate, and for aggregate statistics.
  * ----------------------------------------------------------------
  */
 void
@@ -4990,6 +5311,31 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelHashAggState *pstate;
+		int			nparticipants = pcxt->nworkers + 1;
+
+		/*
+		 * The statistics below are keyed by plan_node_id already, so the
+		 * shared partitions need a key of their own.
+		 */
+		pstate = shm_toc_allocate(pcxt->toc,
+								  hashagg_shared_size(nparticipants));
+		pstate->nparticipants = nparticipants;
+		pstate->npartitions = hashagg_shared_num_partitions(nparticipants);
+		pstate->sts_size = MAXALIGN(sts_estimate(nparticipants));
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->next_partition, 0);
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_KEY_HASHAGG_SHARED(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->hash_shared = pstate;
+		hashagg_shared_init_partitions(node, pstate);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -5013,10 +5359,99 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 void
 ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelHashAggState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_KEY_HASHAGG_SHARED(node->ss.ps.plan->plan_node_id),
+								false);
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->hash_shared = pstate;
+		node->hash_shared_sts = (SharedTuplestoreAccessor **)
+			palloc(pstate->npartitions * sizeof(SharedTuplestoreAccessor *));
+		for (int i = 0; i < pstate->npartitions; i++)
+			node->hash_shared_sts[i] =
+				sts_attach(HashAggSharedPartition(pstate, i),
+						   ParallelWorkerNumber + 1, &pstate->fileset);
+	}
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset the shared partitions before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelHashAggState *pstate = node->hash_shared;
+
+	if (pstate == NULL)
+		return;
+
+	SharedFileSetDeleteAll(&pstate->fileset);
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+	hashagg_shared_init_partitions(node, pstate);
+}
+
+/*
+ * Number of shared partitions for a parallel-aware aggregate; always a power
+ * of two, since they are chosen by the high bits of the hash value.
+ */
+static int
+hashagg_shared_num_partitions(int nparticipants)
+{
+	int			npartitions;
+
+	npartitions = nparticipants * HASHAGG_SHARED_PARTITIONS_PER_PARTICIPANT;
+	npartitions = Max(npartitions, HASHAGG_MIN_PARTITIONS);
+	npartitions = Min(npartitions, HASHAGG_SHARED_MAX_PARTITIONS);
+
+	return 1 << my_log2(npartitions);
+}
+
+/*
+ * Size of the ParallelHashAggState for the given number of participants.
+ */
+static Size
+hashagg_shared_size(int nparticipants)
+{
+	return add_size(offsetof(ParallelHashAggState, partitions),
+					mul_size(hashagg_shared_num_partitions(nparticipants),
+							 MAXALIGN(sts_estimate(nparticipants))));
+}
+
+/*
+ * Create the (empty) shared partitions, as the leader.
+ */
+static void
+hashagg_shared_init_partitions(AggState *aggstate,
+							   ParallelHashAggState *pstate)
+{
+	if (aggstate->hash_shared_sts == NULL)
+		aggstate->hash_shared_sts = (SharedTuplestoreAccessor **)
+			palloc(pstate->npartitions * sizeof(SharedTuplestoreAccessor *));
+
+	for (int i = 0; i < pstate->npartitions; i++)
+	{
+		char		name[NAMEDATALEN];
+
+		snprintf(name, sizeof(name), "hashagg.p%d", i);
+		aggstate->hash_shared_sts[i] =
+			sts_initialize(HashAggSharedPartition(pstate, i),
+						   pstate->nparticipants, 0, sizeof(uint32),
+						   SHARED_TUPLESTORE_SINGLE_PASS, &pstate->fileset,
+						   name);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggRetrieveInstrumentation
  *
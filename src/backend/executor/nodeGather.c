@@ -278,9 +278,14 @@ gather_getnext(GatherState *gatherstate)
 
 			if (HeapTupleIsValid(tup))
 			{
+				/*
+				 * The tuple wasn't copied out of the queue.  That's fine: it
+				 * stays valid until we're called again, as a returned slot
+				 * must.
+				 */
 				ExecStoreHeapTuple(tup, /* tuple to store */
 								   fslot,	/* slot to store the tuple */
-								   true);	/* pfree tuple when done with it */
+								   false);	/* don't pfree tuple */
 				return fslot;
 			}
 		}
@@ -307,6 +312,9 @@ gather_getnext(GatherState *gatherstate)
 
 /*
  * Attempt to read a tuple from one of our parallel workers.
+ *
+ * The tuple is returned in gatherstate->funnel_tuple, pointing into the
+ * worker's queue; it is only valid until the next call.
  */
 static HeapTuple
 gather_readnext(GatherState *gatherstate)
@@ -316,7 +324,7 @@ gather_readnext(GatherState *gatherstate)
 	for (;;)
 	{
 		TupleQueueReader *reader;
-		HeapTuple	tup;
+		bool		gottuple;
 		bool		readerdone;
 
 		/* Check for async events, particularly messages from workers. */
@@ -325,14 +333,15 @@ gather_readnext(GatherState *gatherstate)
 		/*
 		 * Attempt to read a tuple, but don't block if none is available.
 		 *
-		 * Note that TupleQueueReaderNext will just return NULL for a worker
-		 * which fails to initialize.  We'll treat that worker as having
+		 * Note that TupleQueueReaderNextNoCopy will just return false for a
+		 * worker which fails to initialize.  We'll treat that worker as having
 		 * produced no tuples; WaitForParallelWorkersToFinish will error out
 		 * when we get there.
 		 */
 		Assert(gatherstate->nextreader < gatherstate->nreaders);
 		reader = gatherstate->reader[gatherstate->nextreader];
-		tup = TupleQueueReaderNext(reader, true, &readerdone);
+		gottuple = TupleQueueReaderNextNoCopy(reader, true, &readerdone,
+											  &gatherstate->funnel_tuple);
 
 		/*
 		 * If this reader is done, remove it from our working array of active
@@ -340,7 +349,7 @@ gather_readnext(GatherState *gatherstate)
 		 */
 		if (readerdone)
 		{
-			Assert(!tup);
+			Assert(!gottuple);
 			--gatherstate->nreaders;
 			if (gatherstate->nreaders == 0)
 			{
@@ -357,8 +366,8 @@ gather_readnext(GatherState *gatherstate)
 		}
 
 		/* If we got a tuple, return it. */
-		if (tup)
-			return tup;
+		if (gottuple)
+			return &gatherstate->funnel_tuple;
 
 		/*
 		 * Advance nextreader pointer in round-robin fashion.  Note that we
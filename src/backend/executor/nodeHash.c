@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -44,6 +45,31 @@
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
+/*
+ * Parameters of the Bloom filter a hash join may push down into its outer
+ * scan: the filter is not used at all if more than HASH_FILTER_MAX_BITS_SET
+ * of its bits are set after the build, and it is given up on if it rejects
+ * less than HASH_FILTER_MIN_REJECTED of the tuples checked.  The filter takes
+ * at most 1/HASH_FILTER_MEM_FRACTION of the memory allowed for the hash
+ * table, and at least HASH_FILTER_MIN_BYTES.
+ */
+#define HASH_FILTER_MAX_BITS_SET	0.5
+#define HASH_FILTER_MIN_REJECTED	0.1
+#define HASH_FILTER_CHECK_INTERVAL	1024
+#define HASH_FILTER_MEM_FRACTION	8
+#define HASH_FILTER_MIN_BYTES		1024
+
+static void ExecHashFilterReset(HashJoinFilter *filter,
+								HashJoinTable hashtable, double ntuples);
+static void ExecChooseHashTableSizeInternal(double ntuples, int tupwidth,
+											bool useskew,
+											bool try_combined_hash_mem,
+											int parallel_workers,
+											size_t bucket_entry_size,
+											size_t *space_allowed,
+											int *numbuckets,
+											int *numbatches,
+											int *num_skew_mcvs);
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
@@ -141,6 +167,7 @@ MultiExecPrivateHash(HashState *node)
 	PlanState  *outerNode;
 	List	   *hashkeys;
 	HashJoinTable hashtable;
+	HashJoinFilter *filter;
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
@@ -156,6 +183,14 @@ MultiExecPrivateHash(HashState *node)
 	 */
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
+	filter = node->filter;
+
+	if (filter)
+	{
+		ExecHashFilterReset(filter, hashtable, outerNode->plan->plan_rows);
+		filter->hashfunctions = hashtable->outer_hashfunctions;
+		filter->collations = hashtable->collations;
+	}
 
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
@@ -174,6 +209,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (filter)
+				bloom_add_element(filter->bloom, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -196,11 +235,19 @@ MultiExecPrivateHash(HashState *node)
 		ExecHashIncreaseNumBuckets(hashtable);
 
 	/* Account for the buckets in spaceUsed (reported in EXPLAIN ANALYZE) */
-	hashtable->spaceUsed += hashtable->nbuckets * sizeof(HashJoinTuple);
+	hashtable->spaceUsed += hashtable->nbuckets * HJ_BUCKET_SIZE;
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	/*
+	 * Let the outer scan start checking the filter, unless so many bits are
+	 * set that it would hardly reject anything.
+	 */
+	if (filter &&
+		bloom_prop_bits_set(filter->bloom) <= HASH_FILTER_MAX_BITS_SET)
+		filter->active = true;
 }
 
 /* ----------------------------------------------------------------
@@ -486,6 +533,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->log2_nbuckets = log2_nbuckets;
 	hashtable->log2_nbuckets_optimal = log2_nbuckets;
 	hashtable->buckets.unshared = NULL;
+	hashtable->bucket_tags = NULL;
 	hashtable->keepNulls = keepNulls;
 	hashtable->skewEnabled = false;
 	hashtable->skewBucket = NULL;
@@ -638,6 +686,8 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 
 		hashtable->buckets.unshared = (HashJoinTuple *)
 			palloc0(nbuckets * sizeof(HashJoinTuple));
+		hashtable->bucket_tags = (uint16 *)
+			palloc0(nbuckets * sizeof(uint16));
 
 		/*
 		 * Set up for skew optimization, if possible and there's a need for
@@ -659,6 +709,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
  * relation to be hashed (number of rows and average row width).
  *
  * This is exported so that the planner's costsize.c can use it.
+ *
+ * Buckets of a private hash table also carry a tag, which those of a
+ * Parallel Hash table (try_combined_hash_mem) don't.
  */
 
 /* Target bucket loading (tuples per bucket) */
@@ -672,6 +725,27 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs)
+{
+	ExecChooseHashTableSizeInternal(ntuples, tupwidth, useskew,
+									try_combined_hash_mem,
+									parallel_workers,
+									try_combined_hash_mem ?
+									sizeof(HashJoinTuple) : HJ_BUCKET_SIZE,
+									space_allowed,
+									numbuckets,
+									numbatches,
+									num_skew_mcvs);
+}
+
+static void
+ExecChooseHashTableSizeInternal(double ntuples, int tupwidth, bool useskew,
+								bool try_combined_hash_mem,
+								int parallel_workers,
+								size_t bucket_entry_size,
+								size_t *space_allowed,
+								int *numbuckets,
+								int *numbatches,
+								int *num_skew_mcvs)
 {
 	int			tupsize;
 	double		inner_rel_bytes;
@@ -759,7 +833,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * Note that both nbuckets and nbatch must be powers of 2 to make
 	 * ExecHashGetBucketAndBatch fast.
 	 */
-	max_pointers = *space_allowed / sizeof(HashJoinTuple);
+	max_pointers = *space_allowed / bucket_entry_size;
 	max_pointers = Min(max_pointers, MaxAllocSize / sizeof(HashJoinTuple));
 	/* If max_pointers isn't a power of 2, must round it down to one */
 	mppow2 = 1L << my_log2(max_pointers);
@@ -782,7 +856,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * If there's not enough space to store the projected number of tuples and
 	 * the required bucket headers, we will need multiple batches.
 	 */
-	bucket_bytes = sizeof(HashJoinTuple) * nbuckets;
+	bucket_bytes = bucket_entry_size * nbuckets;
 	if (inner_rel_bytes + bucket_bytes > hash_table_bytes)
 	{
 		/* We'll need multiple batches */
@@ -797,12 +871,13 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 		 */
 		if (try_combined_hash_mem)
 		{
-			ExecChooseHashTableSize(ntuples, tupwidth, useskew,
-									false, parallel_workers,
-									space_allowed,
-									numbuckets,
-									numbatches,
-									num_skew_mcvs);
+			ExecChooseHashTableSizeInternal(ntuples, tupwidth, useskew,
+											false, parallel_workers,
+											bucket_entry_size,
+											space_allowed,
+											numbuckets,
+											numbatches,
+											num_skew_mcvs);
 			return;
 		}
 
@@ -812,12 +887,12 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 		 * NTUP_PER_BUCKET tuples, whose projected size already includes
 		 * overhead for the hash code, pointer to the next tuple, etc.
 		 */
-		bucket_size = (tupsize * NTUP_PER_BUCKET + sizeof(HashJoinTuple));
+		bucket_size = (tupsize * NTUP_PER_BUCKET + bucket_entry_size);
 		lbuckets = 1L << my_log2(hash_table_bytes / bucket_size);
 		lbuckets = Min(lbuckets, max_pointers);
 		nbuckets = (int) lbuckets;
 		nbuckets = 1 << my_log2(nbuckets);
-		bucket_bytes = nbuckets * sizeof(HashJoinTuple);
+		bucket_bytes = nbuckets * bucket_entry_size;
 
 		/*
 		 * Buckets are simple pointers to hashjoin tuples, while tupsize
@@ -957,6 +1032,9 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 		hashtable->buckets.unshared =
 			repalloc(hashtable->buckets.unshared,
 					 sizeof(HashJoinTuple) * hashtable->nbuckets);
+		hashtable->bucket_tags =
+			repalloc(hashtable->bucket_tags,
+					 sizeof(uint16) * hashtable->nbuckets);
 	}
 
 	/*
@@ -966,6 +1044,8 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	 */
 	memset(hashtable->buckets.unshared, 0,
 		   sizeof(HashJoinTuple) * hashtable->nbuckets);
+	memset(hashtable->bucket_tags, 0,
+		   sizeof(uint16) * hashtable->nbuckets);
 	oldchunks = hashtable->chunks;
 	hashtable->chunks = NULL;
 
@@ -1001,6 +1081,8 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				/* and add it back to the appropriate bucket */
 				copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
 				hashtable->buckets.unshared[bucketno] = copyTuple;
+				hashtable->bucket_tags[bucketno] |=
+					HJ_BUCKET_TAG(copyTuple->hashvalue);
 			}
 			else
 			{
@@ -1460,9 +1542,14 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	hashtable->buckets.unshared =
 		(HashJoinTuple *) repalloc(hashtable->buckets.unshared,
 								   hashtable->nbuckets * sizeof(HashJoinTuple));
+	hashtable->bucket_tags =
+		(uint16 *) repalloc(hashtable->bucket_tags,
+							hashtable->nbuckets * sizeof(uint16));
 
 	memset(hashtable->buckets.unshared, 0,
 		   hashtable->nbuckets * sizeof(HashJoinTuple));
+	memset(hashtable->bucket_tags, 0,
+		   hashtable->nbuckets * sizeof(uint16));
 
 	/* scan through all tuples in all chunks to rebuild the hash table */
 	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
@@ -1482,6 +1569,8 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 			/* add the tuple to the proper bucket */
 			hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
 			hashtable->buckets.unshared[bucketno] = hashTuple;
+			hashtable->bucket_tags[bucketno] |=
+				HJ_BUCKET_TAG(hashTuple->hashvalue);
 
 			/* advance index past the tuple */
 			idx += MAXALIGN(HJTUPLE_OVERHEAD +
@@ -1635,6 +1724,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		/* Push it onto the front of the bucket's list */
 		hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
 		hashtable->buckets.unshared[bucketno] = hashTuple;
+		hashtable->bucket_tags[bucketno] |= HJ_BUCKET_TAG(hashvalue);
 
 		/*
 		 * Increase the (optimal) number of buckets if we just exceeded the
@@ -1658,7 +1748,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
 		if (hashtable->spaceUsed +
-			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
+			hashtable->nbuckets_optimal * HJ_BUCKET_SIZE
 			> hashtable->spaceAllowed)
 			ExecHashIncreaseNumBatches(hashtable);
 	}
@@ -1871,6 +1961,103 @@ ExecHashGetHashValue(HashJoinTable hashtable,
 	return true;
 }
 
+/*
+ * ExecHashFilterReset
+ *		Start a new, empty Bloom filter for a hash table about to be built
+ *
+ * The filter is sized for the estimated number of inner tuples, ntuples.
+ * It is used for as long as the hash table is, so its memory is taken out
+ * of the space allowed for the hash table.  The filter is inactive until
+ * the build is complete.
+ */
+static void
+ExecHashFilterReset(HashJoinFilter *filter, HashJoinTable hashtable,
+					double ntuples)
+{
+	MemoryContext oldContext;
+	Size		filter_mem;
+
+	filter->active = false;
+	filter->nchecked = 0;
+	filter->nrejected = 0;
+
+	if (filter->bloom)
+		bloom_free(filter->bloom);
+
+	filter_mem = hashtable->spaceAllowed / HASH_FILTER_MEM_FRACTION;
+	filter_mem = Max(filter_mem, HASH_FILTER_MIN_BYTES);
+
+	/* the bitset lives as long as the filter itself */
+	oldContext = MemoryContextSwitchTo(GetMemoryChunkContext(filter));
+	filter->bloom = bloom_create_extended((int64) Max(ntuples, 1.0),
+										  (int) Min(filter_mem / 1024,
+													MAX_KILOBYTES),
+										  HASH_FILTER_MIN_BYTES, 0);
+	MemoryContextSwitchTo(oldContext);
+
+	hashtable->spaceAllowed -= GetMemoryChunkSpace(filter->bloom);
+}
+
+/*
+ * ExecHashFilterCheck
+ *		Check whether the scan tuple of econtext may have a join partner
+ *
+ * The join keys are evaluated over econtext->ecxt_scantuple and hashed the
+ * same way ExecHashGetHashValue hashes the outer tuples of the join.  A
+ * tuple with a NULL key is rejected: the filter is only used for joins that
+ * do not return unmatched outer tuples, and with strict operators.
+ *
+ * Every HASH_FILTER_CHECK_INTERVAL tuples we look at how many tuples the
+ * filter rejected, and deactivate it if that was too few to make up for the
+ * cost of computing the hash values twice.
+ */
+bool
+ExecHashFilterCheck(HashJoinFilter *filter, ExprContext *econtext)
+{
+	uint32		hashkey = 0;
+	bool		result = true;
+	MemoryContext oldContext;
+
+	Assert(filter->active);
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (int i = 0; i < filter->nkeys; i++)
+	{
+		Datum		keyval;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		keyval = ExecEvalExpr(filter->keys[i], econtext, &isNull);
+		if (isNull)
+		{
+			result = false;
+			break;
+		}
+		hashkey ^= DatumGetUInt32(FunctionCall1Coll(&filter->hashfunctions[i],
+													filter->collations[i],
+													keyval));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (result &&
+		bloom_lacks_element(filter->bloom, (unsigned char *) &hashkey,
+							sizeof(hashkey)))
+		result = false;
+
+	filter->nchecked++;
+	if (!result)
+		filter->nrejected++;
+	if (filter->nchecked % HASH_FILTER_CHECK_INTERVAL == 0 &&
+		filter->nrejected < filter->nchecked * HASH_FILTER_MIN_REJECTED)
+		filter->active = false;
+
+	return result;
+}
+
 /*
  * ExecHashGetBucketAndBatch
  *		Determine the bucket number and batch number for a hash value
@@ -1950,8 +2137,11 @@ ExecScanHashBucket(HashJoinState *hjstate,
 		hashTuple = hashTuple->next.unshared;
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
-	else
+	else if (hashtable->bucket_tags[hjstate->hj_CurBucketNo] &
+			 HJ_BUCKET_TAG(hashvalue))
 		hashTuple = hashtable->buckets.unshared[hjstate->hj_CurBucketNo];
+	else
+		return false;			/* no tuple in the bucket can match */
 
 	while (hashTuple != NULL)
 	{
@@ -2153,6 +2343,8 @@ ExecHashTableReset(HashJoinTable hashtable)
 	/* Reallocate and reinitialize the hash bucket headers. */
 	hashtable->buckets.unshared = (HashJoinTuple *)
 		palloc0(nbuckets * sizeof(HashJoinTuple));
+	hashtable->bucket_tags = (uint16 *)
+		palloc0(nbuckets * sizeof(uint16));
 
 	hashtable->spaceUsed = 0;
 
@@ -2512,6 +2704,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 
 			copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
 			hashtable->buckets.unshared[bucketno] = copyTuple;
+			hashtable->bucket_tags[bucketno] |= HJ_BUCKET_TAG(hashvalue);
 
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
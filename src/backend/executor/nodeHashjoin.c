@@ -113,11 +113,16 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/sharedtuplestore.h"
 
 
+/* GUC parameter */
+bool		hashjoin_bloom_filter = false;
+
 /*
  * States of the ExecHashJoin state machine
  */
@@ -128,6 +133,21 @@
 #define HJ_FILL_INNER_TUPLES	5
 #define HJ_NEED_NEW_BATCH		6
 
+/*
+ * Batched probing of large private hash tables.  Once the table is larger
+ * than HJ_OUTER_BATCH_MIN_SPACE, the probe of each outer tuple is dominated
+ * by cache misses on the bucket and the first tuple of its chain, the
+ * second dependent on the first.  Instead of fetching and probing one outer
+ * tuple at a time, we fetch outer tuples until we have HJ_OUTER_BATCH_SIZE
+ * of them that may have a match according to their bucket tag, or that the
+ * join emits anyway, prefetching their buckets as we go.  The first tuple
+ * of a bucket's chain is prefetched HJ_OUTER_BATCH_DISTANCE outer tuples
+ * before it is probed.
+ */
+#define HJ_OUTER_BATCH_SIZE			32
+#define HJ_OUTER_BATCH_DISTANCE		4
+#define HJ_OUTER_BATCH_MIN_SPACE	(4 * 1024 * 1024)
+
 /* Returns true if doing null-fill on outer relation */
 #define HJ_FILL_OUTER(hjstate)	((hjstate)->hj_NullInnerTupleSlot != NULL)
 /* Returns true if doing null-fill on inner relation */
@@ -136,6 +156,11 @@
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static void ExecHashJoinInitFilter(HashJoinState *hjstate);
+static void ExecHashJoinSetupOuterBatch(HashJoinState *hjstate);
+static TupleTableSlot *ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+														HashJoinState *hjstate,
+														uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
@@ -338,7 +363,10 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					continue;
 				}
 				else
+				{
+					ExecHashJoinSetupOuterBatch(node);
 					node->hj_JoinState = HJ_NEED_NEW_OUTER;
+				}
 
 				/* FALL THRU */
 
@@ -752,9 +780,83 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	if (hashjoin_bloom_filter)
+		ExecHashJoinInitFilter(hjstate);
+
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinInitFilter
+ *
+ *		Push a Bloom filter of the inner hash values down into the outer
+ *		scan, if that is possible and safe.
+ *
+ * Outer tuples may only be dropped early if the join would discard them
+ * anyway when they have no match, and if the hash table is built by this
+ * process alone, so that the filter knows about every inner tuple.  For
+ * now the outer side must be a sequential scan whose output columns used
+ * as join keys are plain columns of the scanned table, so that the scan
+ * can compute the join's hash value before doing any other work on the
+ * tuple.
+ */
+static void
+ExecHashJoinInitFilter(HashJoinState *hjstate)
+{
+	HashJoin   *node = (HashJoin *) hjstate->js.ps.plan;
+	HashState  *hashstate = (HashState *) innerPlanState(hjstate);
+	PlanState  *outerNode = outerPlanState(hjstate);
+	HashJoinFilter *filter;
+	ExprState **keys;
+	ListCell   *lc1;
+	ListCell   *lc2;
+	int			i = 0;
+
+	if (hjstate->js.jointype != JOIN_INNER &&
+		hjstate->js.jointype != JOIN_SEMI &&
+		hjstate->js.jointype != JOIN_RIGHT)
+		return;
+	if (hashstate->ps.plan->parallel_aware)
+		return;
+	if (!IsA(outerNode, SeqScanState))
+		return;
+
+	keys = (ExprState **) palloc(list_length(node->hashkeys) *
+								 sizeof(ExprState *));
+	forboth(lc1, node->hashkeys, lc2, node->hashoperators)
+	{
+		Expr	   *key = (Expr *) lfirst(lc1);
+		TargetEntry *tle;
+
+		while (IsA(key, RelabelType))
+			key = ((RelabelType *) key)->arg;
+		if (!IsA(key, Var) || ((Var *) key)->varno != OUTER_VAR ||
+			!op_strict(lfirst_oid(lc2)))
+		{
+			pfree(keys);
+			return;
+		}
+
+		tle = get_tle_by_resno(outerNode->plan->targetlist,
+							   ((Var *) key)->varattno);
+		if (tle == NULL || !IsA(tle->expr, Var) ||
+			((Var *) tle->expr)->varattno <= 0)
+		{
+			pfree(keys);
+			return;
+		}
+
+		keys[i++] = ExecInitExpr(tle->expr, outerNode);
+	}
+
+	filter = (HashJoinFilter *) palloc0(sizeof(HashJoinFilter));
+	filter->nkeys = i;
+	filter->keys = keys;
+
+	hashstate->filter = filter;
+	((SeqScanState *) outerNode)->filter = filter;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -813,7 +915,9 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hjstate->hj_OuterBatchSize > 0)
+		return ExecHashJoinOuterGetBatchedTuple(outerNode, hjstate, hashvalue);
+	else if (curbatch == 0)		/* if it is the first pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -875,6 +979,158 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinSetupOuterBatch
+ *
+ *		Decide whether to probe the newly built hash table in batches, and
+ *		set up the batch if so.
+ */
+static void
+ExecHashJoinSetupOuterBatch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	EState	   *estate = hjstate->js.ps.state;
+	PlanState  *outerNode = outerPlanState(hjstate);
+	MemoryContext oldcxt;
+
+	hjstate->hj_OuterBatchCount = 0;
+	hjstate->hj_OuterBatchNext = 0;
+
+	/* batches are only worth it if the table doesn't fit in CPU caches */
+	if (hashtable->nbatch != 1 ||
+		hashtable->spaceUsed < HJ_OUTER_BATCH_MIN_SPACE)
+	{
+		hjstate->hj_OuterBatchSize = 0;
+		return;
+	}
+
+	if (hjstate->hj_OuterBatchSlots == NULL)
+	{
+		TupleDesc	outerDesc = ExecGetResultType(outerNode);
+		const TupleTableSlotOps *ops = ExecGetResultSlotOps(outerNode, NULL);
+
+		oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+		hjstate->hj_OuterBatchSlots = (TupleTableSlot **)
+			palloc(HJ_OUTER_BATCH_SIZE * sizeof(TupleTableSlot *));
+		for (int i = 0; i < HJ_OUTER_BATCH_SIZE; i++)
+			hjstate->hj_OuterBatchSlots[i] =
+				ExecInitExtraTupleSlot(estate, outerDesc, ops);
+		hjstate->hj_OuterBatchHashValues = (uint32 *)
+			palloc(HJ_OUTER_BATCH_SIZE * sizeof(uint32));
+		hjstate->hj_OuterBatchBuckets = (int *)
+			palloc(HJ_OUTER_BATCH_SIZE * sizeof(int));
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	hjstate->hj_OuterBatchSize = HJ_OUTER_BATCH_SIZE;
+}
+
+/*
+ * ExecHashJoinOuterGetBatchedTuple
+ *
+ *		ExecHashJoinOuterGetTuple variant for the first pass of a batched
+ *		probe: return the next tuple of the current batch of outer tuples,
+ *		fetching a new batch if needed.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+								 HashJoinState *hjstate,
+								 uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+	TupleTableSlot **slots = hjstate->hj_OuterBatchSlots;
+	uint32	   *hashvalues = hjstate->hj_OuterBatchHashValues;
+	int		   *buckets = hjstate->hj_OuterBatchBuckets;
+	int			next;
+	int			ahead;
+	int			n;
+
+	Assert(hashtable->nbatch == 1 && hashtable->curbatch == 0);
+
+	if (hjstate->hj_OuterBatchNext >= hjstate->hj_OuterBatchCount)
+	{
+		/*
+		 * Fetch and hash the next batch of outer tuples, and check the tags
+		 * of their buckets.  The tags are dense enough to mostly stay in
+		 * cache.  A tuple whose bit is clear cannot have a match, so unless
+		 * the join emits unmatched outer tuples it is dropped right away,
+		 * without being copied out of the outer plan's slot.  Only the
+		 * others are copied into the batch, and their buckets prefetched.
+		 */
+		bool		keep_unmatched = HJ_FILL_OUTER(hjstate) ||
+			hjstate->js.jointype == JOIN_ANTI;
+
+		n = 0;
+		while (n < hjstate->hj_OuterBatchSize)
+		{
+			TupleTableSlot *slot = hjstate->hj_FirstOuterTupleSlot;
+			int			batchno;
+
+			if (!TupIsNull(slot))
+				hjstate->hj_FirstOuterTupleSlot = NULL;
+			else
+				slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				break;
+
+			econtext->ecxt_outertuple = slot;
+			if (!ExecHashGetHashValue(hashtable, econtext,
+									  hjstate->hj_OuterHashKeys,
+									  true, /* outer tuple */
+									  HJ_FILL_OUTER(hjstate),
+									  &hashvalues[n]))
+			{
+				/* can't match because of a NULL, so discard it */
+				continue;
+			}
+
+			/* remember outer relation is not empty for possible rescan */
+			hjstate->hj_OuterNotEmpty = true;
+
+			ExecHashGetBucketAndBatch(hashtable, hashvalues[n],
+									  &buckets[n], &batchno);
+			if (hashtable->bucket_tags[buckets[n]] &
+				HJ_BUCKET_TAG(hashvalues[n]))
+				pg_prefetch_mem(&hashtable->buckets.unshared[buckets[n]]);
+			else if (keep_unmatched)
+				buckets[n] = -1;
+			else
+				continue;
+
+			ExecCopySlot(slots[n], slot);
+			n++;
+		}
+
+		if (n == 0)
+		{
+			hjstate->hj_OuterBatchCount = 0;
+			hjstate->hj_OuterBatchNext = 0;
+			return NULL;
+		}
+
+		hjstate->hj_OuterBatchCount = n;
+		hjstate->hj_OuterBatchNext = 0;
+
+		/* prime the pipeline of chain prefetches */
+		for (int i = 0; i < Min(n, HJ_OUTER_BATCH_DISTANCE); i++)
+		{
+			if (buckets[i] >= 0)
+				pg_prefetch_mem(hashtable->buckets.unshared[buckets[i]]);
+		}
+	}
+
+	next = hjstate->hj_OuterBatchNext++;
+
+	/* prefetch the first tuple of the chain a few outer tuples ahead */
+	ahead = next + HJ_OUTER_BATCH_DISTANCE;
+	if (ahead < hjstate->hj_OuterBatchCount && buckets[ahead] >= 0)
+		pg_prefetch_mem(hashtable->buckets.unshared[buckets[ahead]]);
+
+	*hashvalue = hashvalues[next];
+	return slots[next];
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -1342,6 +1598,10 @@ ExecReScanHashJoin(HashJoinState *node)
 			/* for safety, be sure to clear child plan node's pointer too */
 			hashNode->hashtable = NULL;
 
+			/* the filter points into the hash table, and will be rebuilt */
+			if (hashNode->filter)
+				hashNode->filter->active = false;
+
 			ExecHashTableDestroy(node->hj_HashTable);
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
@@ -1364,6 +1624,12 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget outer tuples fetched ahead */
+	for (int i = 0; i < node->hj_OuterBatchCount; i++)
+		ExecClearTuple(node->hj_OuterBatchSlots[i]);
+	node->hj_OuterBatchCount = 0;
+	node->hj_OuterBatchNext = 0;
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -22,10 +22,77 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/executor.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
+/* GUC parameter */
+bool		adaptive_nestloop = false;
+
+/*
+ * A nested loop whose inner side does not depend on the current outer tuple
+ * reads the same inner tuples over and over, once per outer tuple.  That is
+ * fine as long as the outer side is as small as the planner expected, and
+ * disastrous if the estimate was badly off.  Such a join therefore counts
+ * its outer tuples, and once there are NL_HASH_FACTOR times as many as
+ * estimated (and at least NL_HASH_MIN_OUTER), it reads the inner side one
+ * last time into a hash table keyed by its hashable equality join clauses.
+ * From then on each outer tuple only visits the inner tuples with equal
+ * keys, as in a hash join.  The complete join qual is still checked for
+ * every pair, so the result is the same as before the switch.  If the inner
+ * side does not fit in hash_mem, the join stays a nested loop.
+ */
+#define NL_HASH_FACTOR		10.0
+#define NL_HASH_MIN_OUTER	1000
+
+/* An inner tuple in the hash table; tuples with equal keys are chained */
+typedef struct NestLoopHashTuple
+{
+	struct NestLoopHashTuple *next;
+	MinimalTuple tuple;
+} NestLoopHashTuple;
+
+typedef struct NestLoopHashState
+{
+	double		threshold;		/* switch after this many outer tuples */
+	double		nouter;			/* outer tuples fetched so far */
+	bool		failed;			/* inner side didn't fit in hash_mem */
+
+	/* the hash keys, one per hashable equality join clause */
+	int			numCols;
+	AttrNumber *keyColIdx;		/* just 1..numCols */
+	Oid		   *tab_eq_funcoids;	/* inner = inner equality functions */
+	FmgrInfo   *tab_hash_funcs; /* inner side hash functions */
+	FmgrInfo   *lhs_hash_funcs; /* outer side hash functions */
+	Oid		   *tab_collations;
+	ExprState  *cur_eq_comp;	/* outer = inner comparator */
+	ProjectionInfo *projOuter;	/* computes the keys of an outer tuple */
+	ProjectionInfo *projInner;	/* computes the keys of an inner tuple */
+	TupleDesc	descInner;		/* tuple descriptor of the inner keys */
+
+	/* the hash table, once built */
+	MemoryContext hashtablecxt;
+	MemoryContext hashtempcxt;
+	TupleHashTable hashtable;
+	TupleTableSlot *innerslot;	/* holds the inner tuple being joined */
+	NestLoopHashTuple *curtuple;	/* next match for the outer tuple */
+} NestLoopHashState;
+
+static NestLoopHashState *ExecNestLoopInitHash(NestLoopState *nlstate,
+											   NestLoop *node);
+static bool nl_plan_is_volatile(PlanState *planstate, void *context);
+static int	nl_expr_side(Node *node);
+static bool nl_expr_side_walker(Node *node, int *side);
+static bool ExecNestLoopBuildHash(NestLoopState *node);
+static void ExecNestLoopResetHash(NestLoopHashState *hash);
+static void ExecNestLoopHashProbe(NestLoopHashState *hash);
+static TupleTableSlot *ExecNestLoopHashNext(NestLoopHashState *hash);
+
 
 /* ----------------------------------------------------------------
  *		ExecNestLoop(node)
@@ -69,6 +136,7 @@ ExecNestLoop(PlanState *pstate)
 	ExprState  *joinqual;
 	ExprState  *otherqual;
 	ExprContext *econtext;
+	NestLoopHashState *hash;
 	ListCell   *lc;
 
 	CHECK_FOR_INTERRUPTS();
@@ -84,6 +152,7 @@ ExecNestLoop(PlanState *pstate)
 	outerPlan = outerPlanState(node);
 	innerPlan = innerPlanState(node);
 	econtext = node->js.ps.ps_ExprContext;
+	hash = node->nl_Hash;
 
 	/*
 	 * Reset per-tuple memory context to free any expression evaluation
@@ -123,33 +192,51 @@ ExecNestLoop(PlanState *pstate)
 			node->nl_MatchedOuter = false;
 
 			/*
-			 * fetch the values of any outer Vars that must be passed to the
-			 * inner scan, and store them in the appropriate PARAM_EXEC slots.
+			 * If the outer side turns out to be much larger than expected,
+			 * try to switch to looking up the matching inner tuples in a
+			 * hash table instead of rescanning the inner plan.
 			 */
-			foreach(lc, nl->nestParams)
+			if (hash != NULL && hash->hashtable == NULL && !hash->failed &&
+				++hash->nouter > hash->threshold)
+				(void) ExecNestLoopBuildHash(node);
+
+			if (hash != NULL && hash->hashtable != NULL)
 			{
-				NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
-				int			paramno = nlp->paramno;
-				ParamExecData *prm;
-
-				prm = &(econtext->ecxt_param_exec_vals[paramno]);
-				/* Param value should be an OUTER_VAR var */
-				Assert(IsA(nlp->paramval, Var));
-				Assert(nlp->paramval->varno == OUTER_VAR);
-				Assert(nlp->paramval->varattno > 0);
-				prm->value = slot_getattr(outerTupleSlot,
-										  nlp->paramval->varattno,
-										  &(prm->isnull));
-				/* Flag parameter value as changed */
-				innerPlan->chgParam = bms_add_member(innerPlan->chgParam,
-													 paramno);
+				ENL1_printf("probing inner hash table");
+				ExecNestLoopHashProbe(hash);
 			}
+			else
+			{
+				/*
+				 * fetch the values of any outer Vars that must be passed to
+				 * the inner scan, and store them in the appropriate
+				 * PARAM_EXEC slots.
+				 */
+				foreach(lc, nl->nestParams)
+				{
+					NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+					int			paramno = nlp->paramno;
+					ParamExecData *prm;
+
+					prm = &(econtext->ecxt_param_exec_vals[paramno]);
+					/* Param value should be an OUTER_VAR var */
+					Assert(IsA(nlp->paramval, Var));
+					Assert(nlp->paramval->varno == OUTER_VAR);
+					Assert(nlp->paramval->varattno > 0);
+					prm->value = slot_getattr(outerTupleSlot,
+											  nlp->paramval->varattno,
+											  &(prm->isnull));
+					/* Flag parameter value as changed */
+					innerPlan->chgParam = bms_add_member(innerPlan->chgParam,
+														 paramno);
+				}
 
-			/*
-			 * now rescan the inner plan
-			 */
-			ENL1_printf("rescanning inner plan");
-			ExecReScan(innerPlan);
+				/*
+				 * now rescan the inner plan
+				 */
+				ENL1_printf("rescanning inner plan");
+				ExecReScan(innerPlan);
+			}
 		}
 
 		/*
@@ -157,7 +244,10 @@ ExecNestLoop(PlanState *pstate)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (hash != NULL && hash->hashtable != NULL)
+			innerTupleSlot = ExecNestLoopHashNext(hash);
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -340,6 +430,15 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 				 (int) node->join.jointype);
 	}
 
+	/*
+	 * see if we could switch to hashing the inner side.  Reading the inner
+	 * side once is only equivalent to rescanning it for every outer tuple if
+	 * each rescan returns the same tuples, so volatile functions rule it out.
+	 */
+	if (adaptive_nestloop && node->nestParams == NIL &&
+		!nl_plan_is_volatile(innerPlanState(nlstate), NULL))
+		nlstate->nl_Hash = ExecNestLoopInitHash(nlstate, node);
+
 	/*
 	 * finally, wipe the current outer tuple clean.
 	 */
@@ -406,6 +505,437 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * outer Vars are used as run-time keys...
 	 */
 
+	/*
+	 * The hash table stays valid as long as the inner side doesn't change.
+	 * If we haven't switched yet, start counting the outer tuples afresh,
+	 * since the threshold is for a single scan of the outer side.
+	 */
+	if (node->nl_Hash != NULL)
+	{
+		if (innerPlanState(node)->chgParam != NULL)
+			ExecNestLoopResetHash(node->nl_Hash);
+		node->nl_Hash->curtuple = NULL;
+		node->nl_Hash->nouter = 0;
+	}
+
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
+
+/* ----------------------------------------------------------------
+ *						Adaptive Hashing Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecNestLoopInitHash
+ *
+ *		Set up for switching to a hash table of the inner tuples,
+ *		keyed by the join clauses of the form "outer expression =
+ *		inner expression" using a hashable operator.  Returns NULL
+ *		if there are no such clauses.
+ * ----------------------------------------------------------------
+ */
+static NestLoopHashState *
+ExecNestLoopInitHash(NestLoopState *nlstate, NestLoop *node)
+{
+	EState	   *estate = nlstate->js.ps.state;
+	PlanState  *parent = &nlstate->js.ps;
+	ExprContext *econtext = nlstate->js.ps.ps_ExprContext;
+	NestLoopHashState *hash;
+	List	   *lefttlist = NIL;
+	List	   *righttlist = NIL;
+	List	   *cross_eq_funcoids = NIL;
+	List	   *tab_eq_funcoids = NIL;
+	List	   *lhs_hash_funcoids = NIL;
+	List	   *tab_hash_funcoids = NIL;
+	List	   *collations = NIL;
+	Oid		   *cross_eq_funcs;
+	TupleDesc	descOuter;
+	TupleTableSlot *slot;
+	ListCell   *lc;
+	int			ncols;
+	int			i;
+
+	foreach(lc, node->join.joinqual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Expr	   *outerarg;
+		Expr	   *innerarg;
+		Oid			opno;
+		Oid			rhs_eq_oper;
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			continue;
+
+		/* put the outer side on the left, commuting the operator if needed */
+		opno = opexpr->opno;
+		outerarg = (Expr *) linitial(opexpr->args);
+		innerarg = (Expr *) lsecond(opexpr->args);
+		if (nl_expr_side((Node *) outerarg) == INNER_VAR &&
+			nl_expr_side((Node *) innerarg) == OUTER_VAR)
+		{
+			Expr	   *tmp = outerarg;
+
+			outerarg = innerarg;
+			innerarg = tmp;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				continue;
+		}
+		else if (nl_expr_side((Node *) outerarg) != OUTER_VAR ||
+				 nl_expr_side((Node *) innerarg) != INNER_VAR)
+			continue;
+
+		/* a NULL key must not match anything */
+		if (!op_hashjoinable(opno, exprType((Node *) outerarg)) ||
+			!op_strict(opno))
+			continue;
+		if (contain_volatile_functions((Node *) opexpr))
+			continue;
+		if (!get_compatible_hash_operators(opno, NULL, &rhs_eq_oper) ||
+			!get_op_hash_functions(opno, &left_hashfn, &right_hashfn))
+			continue;
+
+		ncols = list_length(lefttlist) + 1;
+		lefttlist = lappend(lefttlist,
+							makeTargetEntry(outerarg, ncols, NULL, false));
+		righttlist = lappend(righttlist,
+							 makeTargetEntry(innerarg, ncols, NULL, false));
+		cross_eq_funcoids = lappend_oid(cross_eq_funcoids, get_opcode(opno));
+		tab_eq_funcoids = lappend_oid(tab_eq_funcoids,
+									  get_opcode(rhs_eq_oper));
+		lhs_hash_funcoids = lappend_oid(lhs_hash_funcoids, left_hashfn);
+		tab_hash_funcoids = lappend_oid(tab_hash_funcoids, right_hashfn);
+		collations = lappend_oid(collations, opexpr->inputcollid);
+	}
+
+	if (lefttlist == NIL)
+		return NULL;
+
+	ncols = list_length(lefttlist);
+	hash = (NestLoopHashState *) palloc0(sizeof(NestLoopHashState));
+	hash->threshold = Max(outerPlan(node)->plan_rows * NL_HASH_FACTOR,
+						  NL_HASH_MIN_OUTER);
+	hash->numCols = ncols;
+	hash->keyColIdx = (AttrNumber *) palloc(ncols * sizeof(AttrNumber));
+	hash->tab_eq_funcoids = (Oid *) palloc(ncols * sizeof(Oid));
+	hash->tab_hash_funcs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	hash->lhs_hash_funcs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	hash->tab_collations = (Oid *) palloc(ncols * sizeof(Oid));
+	cross_eq_funcs = (Oid *) palloc(ncols * sizeof(Oid));
+
+	for (i = 0; i < ncols; i++)
+	{
+		hash->keyColIdx[i] = i + 1;
+		hash->tab_eq_funcoids[i] = list_nth_oid(tab_eq_funcoids, i);
+		fmgr_info(list_nth_oid(tab_hash_funcoids, i), &hash->tab_hash_funcs[i]);
+		fmgr_info(list_nth_oid(lhs_hash_funcoids, i), &hash->lhs_hash_funcs[i]);
+		hash->tab_collations[i] = list_nth_oid(collations, i);
+		cross_eq_funcs[i] = list_nth_oid(cross_eq_funcoids, i);
+	}
+
+	/* projections computing the keys of outer and inner tuples */
+	descOuter = ExecTypeFromTL(lefttlist);
+	slot = ExecInitExtraTupleSlot(estate, descOuter, &TTSOpsVirtual);
+	hash->projOuter = ExecBuildProjectionInfo(lefttlist, econtext, slot,
+											  parent, NULL);
+	hash->descInner = ExecTypeFromTL(righttlist);
+	slot = ExecInitExtraTupleSlot(estate, hash->descInner, &TTSOpsVirtual);
+	hash->projInner = ExecBuildProjectionInfo(righttlist, econtext, slot,
+											  parent, NULL);
+
+	/* comparator for lookups of outer keys (potentially cross-type) */
+	hash->cur_eq_comp = ExecBuildGroupingEqual(descOuter, hash->descInner,
+											   &TTSOpsVirtual,
+											   &TTSOpsMinimalTuple,
+											   ncols,
+											   hash->keyColIdx,
+											   cross_eq_funcs,
+											   hash->tab_collations,
+											   parent);
+
+	hash->innerslot =
+		ExecInitExtraTupleSlot(estate,
+							   ExecGetResultType(innerPlanState(nlstate)),
+							   &TTSOpsMinimalTuple);
+
+	return hash;
+}
+
+/*
+ * Does a plan tree evaluate volatile functions, or otherwise return
+ * different tuples each time it is rescanned?  This is a planstate_tree_walker
+ * callback, checking the expressions of each node and its subplans.
+ */
+static bool
+nl_plan_is_volatile(PlanState *planstate, void *context)
+{
+	Plan	   *plan = planstate->plan;
+	List	   *exprs = NIL;
+
+	switch (nodeTag(plan))
+	{
+		case T_SampleScan:
+			/* without REPEATABLE, every scan draws a new sample */
+			return true;
+		case T_IndexScan:
+			exprs = list_make2(((IndexScan *) plan)->indexqualorig,
+							   ((IndexScan *) plan)->indexorderbyorig);
+			break;
+		case T_IndexOnlyScan:
+			exprs = list_make2(((IndexOnlyScan *) plan)->indexqual,
+							   ((IndexOnlyScan *) plan)->indexorderby);
+			break;
+		case T_BitmapIndexScan:
+			exprs = list_make1(((BitmapIndexScan *) plan)->indexqualorig);
+			break;
+		case T_BitmapHeapScan:
+			exprs = list_make1(((BitmapHeapScan *) plan)->bitmapqualorig);
+			break;
+		case T_TidScan:
+			exprs = list_make1(((TidScan *) plan)->tidquals);
+			break;
+		case T_FunctionScan:
+			exprs = list_make1(((FunctionScan *) plan)->functions);
+			break;
+		case T_ValuesScan:
+			exprs = list_make1(((ValuesScan *) plan)->values_lists);
+			break;
+		case T_TableFuncScan:
+			exprs = list_make1(((TableFuncScan *) plan)->tablefunc);
+			break;
+		case T_ForeignScan:
+			exprs = list_make1(((ForeignScan *) plan)->fdw_exprs);
+			break;
+		case T_CustomScan:
+			exprs = list_make1(((CustomScan *) plan)->custom_exprs);
+			break;
+		case T_NestLoop:
+			exprs = list_make1(((Join *) plan)->joinqual);
+			break;
+		case T_MergeJoin:
+			exprs = list_make2(((Join *) plan)->joinqual,
+							   ((MergeJoin *) plan)->mergeclauses);
+			break;
+		case T_HashJoin:
+			exprs = list_make2(((Join *) plan)->joinqual,
+							   ((HashJoin *) plan)->hashclauses);
+			break;
+		case T_Hash:
+			exprs = list_make1(((Hash *) plan)->hashkeys);
+			break;
+		case T_Result:
+			exprs = list_make1(((Result *) plan)->resconstantqual);
+			break;
+		case T_WindowAgg:
+			exprs = list_make2(((WindowAgg *) plan)->startOffset,
+							   ((WindowAgg *) plan)->endOffset);
+			break;
+		case T_Limit:
+			exprs = list_make2(((Limit *) plan)->limitOffset,
+							   ((Limit *) plan)->limitCount);
+			break;
+		default:
+			break;
+	}
+	exprs = lappend(exprs, plan->targetlist);
+	exprs = lappend(exprs, plan->qual);
+
+	if (contain_volatile_functions((Node *) exprs))
+		return true;
+
+	return planstate_tree_walker(planstate, nl_plan_is_volatile, context);
+}
+
+/*
+ * Which side of the join do the Vars of an expression come from?  Returns
+ * OUTER_VAR or INNER_VAR, or 0 if the expression mixes both sides, uses
+ * none, or uses parameters or subplans that might change between scans.
+ */
+static int
+nl_expr_side(Node *node)
+{
+	int			side = 0;
+
+	if (nl_expr_side_walker(node, &side))
+		return 0;
+	return side;
+}
+
+static bool
+nl_expr_side_walker(Node *node, int *side)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Index		varno = ((Var *) node)->varno;
+
+		if (varno != OUTER_VAR && varno != INNER_VAR)
+			return true;
+		if (*side != 0 && *side != varno)
+			return true;
+		*side = varno;
+		return false;
+	}
+	if (IsA(node, Param) || IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan))
+		return true;
+	return expression_tree_walker(node, nl_expr_side_walker, (void *) side);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecNestLoopBuildHash
+ *
+ *		Read the whole inner side into the hash table.  Returns false,
+ *		leaving the join a nested loop, if it doesn't fit in hash_mem.
+ * ----------------------------------------------------------------
+ */
+static bool
+ExecNestLoopBuildHash(NestLoopState *node)
+{
+	NestLoopHashState *hash = node->nl_Hash;
+	PlanState  *innerPlan = innerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	EState	   *estate = node->js.ps.state;
+	Size		hash_mem_limit = (Size) get_hash_mem() * 1024L;
+	long		nbuckets;
+
+	if (hash->hashtablecxt == NULL)
+	{
+		hash->hashtablecxt =
+			AllocSetContextCreate(estate->es_query_cxt,
+								  "NestLoop HashTable Context",
+								  ALLOCSET_DEFAULT_SIZES);
+		hash->hashtempcxt =
+			AllocSetContextCreate(estate->es_query_cxt,
+								  "NestLoop HashTable Temp Context",
+								  ALLOCSET_SMALL_SIZES);
+	}
+
+	nbuckets = (long) Min(innerPlan->plan->plan_rows, (double) LONG_MAX);
+	if (nbuckets < 1)
+		nbuckets = 1;
+
+	/* the bucket array counts against hash_mem too */
+	hash->hashtable = BuildTupleHashTableExt(&node->js.ps,
+											 hash->descInner,
+											 hash->numCols,
+											 hash->keyColIdx,
+											 hash->tab_eq_funcoids,
+											 hash->tab_hash_funcs,
+											 hash->tab_collations,
+											 nbuckets,
+											 0,
+											 hash->hashtablecxt,
+											 hash->hashtablecxt,
+											 hash->hashtempcxt,
+											 false);
+
+	ExecReScan(innerPlan);
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(innerPlan);
+		TupleTableSlot *keyslot;
+		bool		hasnulls = false;
+
+		if (TupIsNull(slot))
+			break;
+
+		econtext->ecxt_innertuple = slot;
+		keyslot = ExecProject(hash->projInner);
+		for (int i = 0; i < hash->numCols; i++)
+			hasnulls |= keyslot->tts_isnull[i];
+
+		/* with strict operators, a NULL key can't match anything */
+		if (!hasnulls)
+		{
+			TupleHashEntry entry;
+			NestLoopHashTuple *htup;
+			MemoryContext oldcontext;
+			bool		isnew;
+
+			entry = LookupTupleHashEntry(hash->hashtable, keyslot,
+										 &isnew, NULL);
+
+			oldcontext = MemoryContextSwitchTo(hash->hashtablecxt);
+			htup = (NestLoopHashTuple *) palloc(sizeof(NestLoopHashTuple));
+			htup->tuple = ExecCopySlotMinimalTuple(slot);
+			htup->next = isnew ? NULL : (NestLoopHashTuple *) entry->additional;
+			entry->additional = htup;
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		ResetExprContext(econtext);
+
+		if (MemoryContextMemAllocated(hash->hashtablecxt, true) >
+			hash_mem_limit)
+		{
+			ExecNestLoopResetHash(hash);
+			hash->failed = true;
+			node->nl_HashOverflows++;
+			return false;
+		}
+	}
+
+	node->nl_HashBuilds++;
+	return true;
+}
+
+/*
+ * Throw away the hash table, going back to a nested loop.
+ */
+static void
+ExecNestLoopResetHash(NestLoopHashState *hash)
+{
+	if (hash->hashtablecxt != NULL)
+	{
+		MemoryContextReset(hash->hashtablecxt);
+		MemoryContextReset(hash->hashtempcxt);
+	}
+	hash->hashtable = NULL;
+	hash->curtuple = NULL;
+	hash->nouter = 0;
+	hash->failed = false;
+}
+
+/*
+ * Look up the inner tuples matching the current outer tuple.
+ */
+static void
+ExecNestLoopHashProbe(NestLoopHashState *hash)
+{
+	TupleTableSlot *keyslot = ExecProject(hash->projOuter);
+	TupleHashEntry entry;
+
+	hash->curtuple = NULL;
+
+	for (int i = 0; i < hash->numCols; i++)
+	{
+		if (keyslot->tts_isnull[i])
+			return;
+	}
+
+	entry = FindTupleHashEntry(hash->hashtable, keyslot,
+							   hash->cur_eq_comp, hash->lhs_hash_funcs);
+	if (entry != NULL)
+		hash->curtuple = (NestLoopHashTuple *) entry->additional;
+}
+
+/*
+ * Return the next inner tuple matching the current outer tuple, or NULL.
+ */
+static TupleTableSlot *
+ExecNestLoopHashNext(NestLoopHashState *hash)
+{
+	NestLoopHashTuple *htup = hash->curtuple;
+
+	if (htup == NULL)
+		return NULL;
+	hash->curtuple = htup->next;
+	return ExecStoreMinimalTuple(htup->tuple, hash->innerslot, false);
+}
@@ -134,17 +134,14 @@ ExecInitSampleScan(SampleScan *node, EState *estate, int eflags)
 						  table_slot_callbacks(scanstate->ss.ss_currentRelation));
 
 	/*
-	 * Initialize result type and projection.
+	 * Initialize result type, projection and qual.
 	 */
 	ExecInitResultTypeTL(&scanstate->ss.ps);
-	ExecAssignScanProjectionInfo(&scanstate->ss);
+	ExecAssignScanProjectionInfoQual(&scanstate->ss, node->scan.plan.qual);
 
 	/*
 	 * initialize child expressions
 	 */
-	scanstate->ss.ps.qual =
-		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
-
 	scanstate->args = ExecInitExprList(tsc->args, (PlanState *) scanstate);
 	scanstate->repeatable =
 		ExecInitExpr(tsc->repeatable, (PlanState *) scanstate);
@@ -27,13 +27,24 @@
  */
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "access/htup_details.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
+/* GUC parameter */
+bool		seqscan_batch_mode = false;
+
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static bool SeqNextBatch(SeqScanState *node);
+static inline bool SeqPassesJoinFilter(SeqScanState *node,
+									   TupleTableSlot *slot);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -75,13 +86,42 @@ SeqNext(SeqScanState *node)
 	}
 
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table, skipping those that a hash join
+	 * above us has no use for
 	 */
-	if (table_scan_getnextslot(scandesc, direction, slot))
-		return slot;
+	while (table_scan_getnextslot(scandesc, direction, slot))
+	{
+		if (SeqPassesJoinFilter(node, slot))
+			return slot;
+	}
 	return NULL;
 }
 
+/*
+ * SeqPassesJoinFilter -- can this tuple have a partner in the hash join
+ * that pushed its filter down into the scan?
+ *
+ * Rejected tuples are counted as removed by the filter.
+ */
+static inline bool
+SeqPassesJoinFilter(SeqScanState *node, TupleTableSlot *slot)
+{
+	HashJoinFilter *filter = node->filter;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+
+	if (filter == NULL || !filter->active)
+		return true;
+
+	econtext->ecxt_scantuple = slot;
+	if (ExecHashFilterCheck(filter, econtext))
+		return true;
+
+	InstrCountFiltered1(node, 1);
+	ResetExprContext(econtext);
+	CHECK_FOR_INTERRUPTS();
+	return false;
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -95,6 +135,114 @@ SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
 	return true;
 }
 
+/* ----------------------------------------------------------------
+ *		SeqNextBatch
+ *
+ *		Fetch the next page's worth of tuples and run the batch
+ *		predicates over them.  Returns false at the end of the scan.
+ * ----------------------------------------------------------------
+ */
+static bool
+SeqNextBatch(SeqScanState *node)
+{
+	ScanBatch  *batch = node->batch;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	EState	   *estate = node->ss.ps.state;
+
+	Assert(ScanDirectionIsForward(estate->es_direction));
+
+	if (scandesc == NULL)
+	{
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   estate->es_snapshot,
+								   0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	/* the scan slot may still point into the batch we are replacing */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+
+	batch->ntuples = heap_getnextbatch(scandesc, batch->tuples,
+									   batch->maxtuples);
+	if (batch->ntuples == 0)
+	{
+		ExecResetScanBatch(batch);
+		return false;
+	}
+
+	ResetExprContext(node->ss.ps.ps_ExprContext);
+	ExecScanBatchQual(batch,
+					  RelationGetDescr(node->ss.ss_currentRelation),
+					  node->ss.ps.ps_ExprContext);
+	InstrCountFiltered1(node, batch->ntuples - batch->nselected);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch(node)
+ *
+ *		Like ExecSeqScan, but returns the tuples of the current batch
+ *		that passed the batch predicates, fetching a new batch when the
+ *		current one is used up.  The rest of the qual and the projection
+ *		are still done a tuple at a time, as in ExecScan.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecSeqScanBatch(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+	ScanBatch  *batch = node->batch;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	ExprState  *qual = node->ss.ps.qual;
+	ProjectionInfo *projInfo = node->ss.ps.ps_ProjInfo;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	ResetExprContext(econtext);
+
+	for (;;)
+	{
+		HeapTuple	tuple;
+
+		if (batch->next >= batch->nselected)
+		{
+			if (!SeqNextBatch(node))
+			{
+				if (projInfo)
+					return ExecClearTuple(projInfo->pi_state.resultslot);
+				return slot;
+			}
+			continue;
+		}
+
+		tuple = &batch->tuples[batch->selection[batch->next++]];
+		ExecStoreBufferHeapTuple(tuple, slot,
+								 ((HeapScanDesc) node->ss.ss_currentScanDesc)->rs_cbuf);
+		if (!SeqPassesJoinFilter(node, slot))
+			continue;
+
+		econtext->ecxt_scantuple = slot;
+		if (projInfo && projInfo->pi_hasqual)
+		{
+			if (ExecProjectIfQual(projInfo))
+				return projInfo->pi_state.resultslot;
+			InstrCountFiltered1(node, 1);
+		}
+		else if (qual == NULL || ExecQual(qual, econtext))
+		{
+			if (projInfo)
+				return ExecProject(projInfo);
+			return slot;
+		}
+		else
+			InstrCountFiltered1(node, 1);
+
+		ResetExprContext(econtext);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecSeqScan(node)
  *
@@ -160,16 +308,34 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 						  table_slot_callbacks(scanstate->ss.ss_currentRelation));
 
 	/*
-	 * Initialize result type and projection.
+	 * Initialize result type.
 	 */
 	ExecInitResultTypeTL(&scanstate->ss.ps);
-	ExecAssignScanProjectionInfo(&scanstate->ss);
 
 	/*
-	 * initialize child expressions
+	 * Fetch a page at a time if the table is a heap and we only ever need
+	 * to go forward.  The EvalPlanQual machinery fetches its test tuples
+	 * through ExecScan, so it always gets a plain scan.
 	 */
-	scanstate->ss.ps.qual =
-		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
+	if (seqscan_batch_mode &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) &&
+		estate->es_epq_active == NULL &&
+		scanstate->ss.ss_currentRelation->rd_tableam == GetHeapamTableAmRoutine())
+	{
+		List	   *residual;
+
+		scanstate->batch = ExecInitScanBatch(node->plan.qual,
+											 MaxHeapTuplesPerPage,
+											 &residual);
+		ExecAssignScanProjectionInfoQual(&scanstate->ss, residual);
+		scanstate->ss.ps.ExecProcNode = ExecSeqScanBatch;
+		return scanstate;
+	}
+
+	/*
+	 * Initialize projection and child expressions.
+	 */
+	ExecAssignScanProjectionInfoQual(&scanstate->ss, node->plan.qual);
 
 	return scanstate;
 }
@@ -227,6 +393,12 @@ ExecReScanSeqScan(SeqScanState *node)
 
 	scan = node->ss.ss_currentScanDesc;
 
+	if (node->batch)
+	{
+		ExecClearTuple(node->ss.ss_ScanTupleSlot);
+		ExecResetScanBatch(node->batch);
+	}
+
 	if (scan != NULL)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
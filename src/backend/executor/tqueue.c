@@ -8,6 +8,15 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * Sending every tuple as a message of its own costs a round of queue
+ * bookkeeping and, often enough, a latch wakeup of the reader per tuple,
+ * which limits how many tuples a Gather can collect per second.  So the
+ * receiver packs tuples into batches, each sent as one message: the tuples
+ * follow one another, each preceded by its length and MAXALIGN'd.  The
+ * first batches hold a single tuple, and each batch may hold twice as many
+ * as the one before, so that a reader wanting only the first few tuples
+ * does not have to wait for a batch to fill up.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,6 +31,16 @@
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
 
+/*
+ * Limits on the size of a batch.  A tuple too large for the buffer is sent
+ * in a batch of its own, without being copied to the buffer first.
+ */
+#define TQUEUE_BATCH_BUFFER_SIZE	8192
+#define TQUEUE_BATCH_MAX_TUPLES		64
+
+/* Space taken by the length word preceding each tuple of a batch */
+#define TQUEUE_ITEM_HEADER_SIZE		MAXALIGN(sizeof(uint32))
+
 /*
  * DestReceiver object's private contents
  *
@@ -31,22 +50,38 @@ typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *buffer;			/* batch being assembled */
+	Size		used;			/* bytes of buffer used */
+	int			ntuples;		/* tuples in buffer */
+	int			maxtuples;		/* tuples allowed in this batch */
 } TQueueDestReceiver;
 
 /*
  * TupleQueueReader object's private contents
  *
- * queue is a pointer to data supplied by reader's caller.
+ * queue is a pointer to data supplied by reader's caller.  data and nbytes
+ * describe the batch last received, and offset is the position of its next
+ * tuple; the batch stays valid until the next shm_mq_receive.
  *
  * "typedef struct TupleQueueReader TupleQueueReader" is in tqueue.h
  */
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *data;			/* current batch */
+	Size		nbytes;			/* size of current batch */
+	Size		offset;			/* offset of next tuple in batch */
 };
 
+static bool tqueueFlush(TQueueDestReceiver *tqueue);
+static bool tqueueSend(TQueueDestReceiver *tqueue, shm_mq_iovec *iov,
+					   int iovcnt);
+static bool TupleQueueReaderNextData(TupleQueueReader *reader, bool nowait,
+									 bool *done, HeapTuple tuple);
+
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Receive a tuple from a query, and add it to the batch for the designated
+ * shm_mq, sending the batch if it is full.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
@@ -55,16 +90,85 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 	HeapTuple	tuple;
-	shm_mq_result result;
+	Size		itemsize;
 	bool		should_free;
+	bool		result = true;
 
-	/* Send the tuple itself. */
 	tuple = ExecFetchSlotHeapTuple(slot, true, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple->t_data, false);
+	itemsize = TQUEUE_ITEM_HEADER_SIZE + MAXALIGN(tuple->t_len);
+
+	/* Make room for the tuple, if the current batch can't take it. */
+	if (tqueue->used + itemsize > TQUEUE_BATCH_BUFFER_SIZE &&
+		!tqueueFlush(tqueue))
+		result = false;
+	else if (itemsize > TQUEUE_BATCH_BUFFER_SIZE)
+	{
+		/* Too large for the buffer; send the tuple on its own. */
+		uint32		header[TQUEUE_ITEM_HEADER_SIZE / sizeof(uint32)];
+		shm_mq_iovec iov[2];
+
+		memset(header, 0, sizeof(header));
+		header[0] = tuple->t_len;
+		iov[0].data = (char *) header;
+		iov[0].len = TQUEUE_ITEM_HEADER_SIZE;
+		iov[1].data = (char *) tuple->t_data;
+		iov[1].len = tuple->t_len;
+		result = tqueueSend(tqueue, iov, 2);
+	}
+	else
+	{
+		char	   *item = tqueue->buffer + tqueue->used;
+
+		*(uint32 *) item = tuple->t_len;
+		memcpy(item + TQUEUE_ITEM_HEADER_SIZE, tuple->t_data, tuple->t_len);
+		tqueue->used += itemsize;
+		if (++tqueue->ntuples >= tqueue->maxtuples)
+			result = tqueueFlush(tqueue);
+	}
 
 	if (should_free)
 		heap_freetuple(tuple);
 
+	return result;
+}
+
+/*
+ * Send the current batch, if any, and allow the next one to be larger.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueFlush(TQueueDestReceiver *tqueue)
+{
+	shm_mq_iovec iov;
+	bool		result;
+
+	if (tqueue->ntuples == 0)
+		return true;
+
+	iov.data = tqueue->buffer;
+	iov.len = tqueue->used;
+	result = tqueueSend(tqueue, &iov, 1);
+
+	tqueue->used = 0;
+	tqueue->ntuples = 0;
+	tqueue->maxtuples = Min(tqueue->maxtuples * 2, TQUEUE_BATCH_MAX_TUPLES);
+
+	return result;
+}
+
+/*
+ * Send one batch to the shm_mq.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueSend(TQueueDestReceiver *tqueue, shm_mq_iovec *iov, int iovcnt)
+{
+	shm_mq_result result;
+
+	result = shm_mq_sendv(tqueue->queue, iov, iovcnt, false);
+
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
 		return false;
@@ -94,7 +198,11 @@ tqueueShutdownReceiver(DestReceiver *self)
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
 	if (tqueue->queue != NULL)
+	{
+		/* send what's left; if the reader is gone, nobody cares */
+		(void) tqueueFlush(tqueue);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
 }
 
@@ -108,7 +216,11 @@ tqueueDestroyReceiver(DestReceiver *self)
 
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
+	{
+		(void) tqueueFlush(tqueue);
 		shm_mq_detach(tqueue->queue);
+	}
+	pfree(tqueue->buffer);
 	pfree(self);
 }
 
@@ -128,6 +240,8 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	self->buffer = palloc(TQUEUE_BATCH_BUFFER_SIZE);
+	self->maxtuples = 1;
 
 	return (DestReceiver *) self;
 }
@@ -176,37 +290,84 @@ HeapTuple
 TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 {
 	HeapTupleData htup;
+
+	if (!TupleQueueReaderNextData(reader, nowait, done, &htup))
+		return NULL;
+
+	return heap_copytuple(&htup);
+}
+
+/*
+ * Fetch a tuple from a tuple queue reader, without copying it.
+ *
+ * Like TupleQueueReaderNext, but instead of returning a copy, *tuple is set
+ * to point to the tuple right where it was received, normally in the shared
+ * memory of the queue.  The tuple stays valid only until the next call for
+ * this reader, or until the queue is detached, whichever comes first.
+ * Returns false if no tuple was fetched.
+ */
+bool
+TupleQueueReaderNextNoCopy(TupleQueueReader *reader, bool nowait, bool *done,
+						   HeapTuple tuple)
+{
+	return TupleQueueReaderNextData(reader, nowait, done, tuple);
+}
+
+/*
+ * Workhorse for the above: step to the next tuple of the current batch, or
+ * receive the next batch if that one is used up.
+ */
+static bool
+TupleQueueReaderNextData(TupleQueueReader *reader, bool nowait, bool *done,
+						 HeapTuple tuple)
+{
 	shm_mq_result result;
-	Size		nbytes;
-	void	   *data;
+	uint32		t_len;
 
 	if (done != NULL)
 		*done = false;
 
-	/* Attempt to read a message. */
-	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
-
-	/* If queue is detached, set *done and return NULL. */
-	if (result == SHM_MQ_DETACHED)
+	if (reader->offset >= reader->nbytes)
 	{
-		if (done != NULL)
-			*done = true;
-		return NULL;
+		Size		nbytes;
+		void	   *data;
+
+		/* Attempt to read a message. */
+		result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
+
+		/* If queue is detached, set *done and return false. */
+		if (result == SHM_MQ_DETACHED)
+		{
+			if (done != NULL)
+				*done = true;
+			return false;
+		}
+
+		/* In non-blocking mode, bail out if no message ready yet. */
+		if (result == SHM_MQ_WOULD_BLOCK)
+			return false;
+		Assert(result == SHM_MQ_SUCCESS);
+
+		reader->data = data;
+		reader->nbytes = nbytes;
+		reader->offset = 0;
 	}
 
-	/* In non-blocking mode, bail out if no message ready yet. */
-	if (result == SHM_MQ_WOULD_BLOCK)
-		return NULL;
-	Assert(result == SHM_MQ_SUCCESS);
+	Assert(reader->offset + TQUEUE_ITEM_HEADER_SIZE <= reader->nbytes);
+	t_len = *(uint32 *) (reader->data + reader->offset);
+	Assert(reader->offset + TQUEUE_ITEM_HEADER_SIZE + t_len <= reader->nbytes);
 
 	/*
 	 * Set up a dummy HeapTupleData pointing to the data from the shm_mq
 	 * (which had better be sufficiently aligned).
 	 */
-	ItemPointerSetInvalid(&htup.t_self);
-	htup.t_tableOid = InvalidOid;
-	htup.t_len = nbytes;
-	htup.t_data = data;
+	ItemPointerSetInvalid(&tuple->t_self);
+	tuple->t_tableOid = InvalidOid;
+	tuple->t_len = t_len;
+	tuple->t_data = (HeapTupleHeader)
+		(reader->data + reader->offset + TQUEUE_ITEM_HEADER_SIZE);
 
-	return heap_copytuple(&htup);
+	reader->offset += TQUEUE_ITEM_HEADER_SIZE + MAXALIGN(t_len);
+
+	return true;
 }
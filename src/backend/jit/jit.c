@@ -25,7 +25,10 @@
 #include "fmgr.h"
 #include "jit/jit.h"
 #include "miscadmin.h"
+#include "nodes/plannodes.h"
 #include "utils/fmgrprotos.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/resowner_private.h"
 
 /* GUCs */
@@ -39,6 +42,35 @@ bool		jit_tuple_deforming = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
 double		jit_optimize_above_cost = 500000;
+bool		jit_skip_unprofitable = false;
+
+/*
+ * Statistics about the JIT compilation of plans that are executed over and
+ * over again.
+ *
+ * Generated code refers to the state of one particular execution of a plan,
+ * so it can't be kept for the next execution: each execution of a cached
+ * generic plan compiles its expressions anew.  For plans that run quickly
+ * that easily costs more than the compiled code saves.  So the plan cache
+ * registers the generic plans it builds here, and we track how much of
+ * their executions went into compiling.  Once that has been more than the
+ * rest of the execution time, over at least JIT_PLAN_MIN_EXECUTIONS
+ * executions, the compiled code can't have made up for its cost (it would
+ * have to run more than twice as fast), and the plan is executed without JIT
+ * from then on.
+ */
+typedef struct JitPlanStats
+{
+	const PlannedStmt *stmt;	/* hash key --- MUST BE FIRST */
+	int64		executions;		/* executions tracked so far */
+	double		compile_time;	/* total time spent compiling, in ms */
+	double		total_time;		/* total time of the executions, in ms */
+	bool		skip;			/* execute without JIT from now on? */
+} JitPlanStats;
+
+#define JIT_PLAN_MIN_EXECUTIONS 3
+
+static HTAB *jit_plan_stats = NULL;
 
 static JitProviderCallbacks provider;
 static bool provider_successfully_loaded = false;
@@ -206,3 +238,117 @@ file_exists(const char *name)
 
 	return false;
 }
+
+/*
+ * Start tracking the JIT statistics of a plan that will be executed
+ * repeatedly, i.e. a cached generic plan.  The caller must call
+ * jit_forget_plan before the plan is freed.
+ */
+void
+jit_register_plan(const PlannedStmt *stmt)
+{
+	JitPlanStats *entry;
+	bool		found;
+
+	if (!(stmt->jitFlags & PGJIT_PERFORM))
+		return;
+
+	if (jit_plan_stats == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(const PlannedStmt *);
+		ctl.entrysize = sizeof(JitPlanStats);
+		ctl.hcxt = TopMemoryContext;
+		jit_plan_stats = hash_create("JIT plan statistics", 64, &ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (JitPlanStats *) hash_search(jit_plan_stats, &stmt, HASH_ENTER,
+										 &found);
+	if (!found)
+	{
+		entry->executions = 0;
+		entry->compile_time = 0;
+		entry->total_time = 0;
+		entry->skip = false;
+	}
+}
+
+/*
+ * Stop tracking a plan registered with jit_register_plan.
+ */
+void
+jit_forget_plan(const PlannedStmt *stmt)
+{
+	if (jit_plan_stats != NULL)
+		(void) hash_search(jit_plan_stats, &stmt, HASH_REMOVE, NULL);
+}
+
+/*
+ * Return the JIT flags to execute a plan with.
+ *
+ * *tracked is set to true if the caller should report the execution to
+ * jit_report_plan.
+ */
+int
+jit_plan_flags(const PlannedStmt *stmt, bool *tracked)
+{
+	JitPlanStats *entry;
+
+	*tracked = false;
+
+	if (stmt->jitFlags == PGJIT_NONE || jit_plan_stats == NULL ||
+		!jit_skip_unprofitable)
+		return stmt->jitFlags;
+
+	entry = (JitPlanStats *) hash_search(jit_plan_stats, &stmt, HASH_FIND,
+										 NULL);
+	if (entry == NULL)
+		return stmt->jitFlags;
+	if (entry->skip)
+		return PGJIT_NONE;
+
+	*tracked = true;
+	return stmt->jitFlags;
+}
+
+/*
+ * Account for one execution of a tracked plan, which took total_time ms.
+ * context and worker_instr are the JIT context and the combined worker
+ * instrumentation of the execution, either of which may be NULL.
+ */
+void
+jit_report_plan(const PlannedStmt *stmt, JitContext *context,
+				JitInstrumentation *worker_instr, double total_time)
+{
+	JitPlanStats *entry;
+	JitInstrumentation instr = {0};
+	double		compile_time;
+
+	if (jit_plan_stats == NULL)
+		return;
+	entry = (JitPlanStats *) hash_search(jit_plan_stats, &stmt, HASH_FIND,
+										 NULL);
+	if (entry == NULL)
+		return;
+
+	if (context != NULL)
+		InstrJitAgg(&instr, &context->instr);
+	if (worker_instr != NULL)
+		InstrJitAgg(&instr, worker_instr);
+
+	compile_time = INSTR_TIME_GET_MILLISEC(instr.generation_counter) +
+		INSTR_TIME_GET_MILLISEC(instr.inlining_counter) +
+		INSTR_TIME_GET_MILLISEC(instr.optimization_counter) +
+		INSTR_TIME_GET_MILLISEC(instr.emission_counter);
+
+	entry->executions++;
+	entry->compile_time += compile_time;
+	entry->total_time += total_time;
+
+	if (entry->executions >= JIT_PLAN_MIN_EXECUTIONS &&
+		entry->compile_time > entry->total_time - entry->compile_time)
+		entry->skip = true;
+}
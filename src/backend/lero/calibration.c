@@ -0,0 +1,320 @@
+#include "postgres.h"
+
+#include <math.h>
+#include "access/parallel.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "lero/calibration.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+
+/*
+ * Cost-model calibration.
+ *
+ * Lero only rescales cardinalities, so a machine whose page and CPU costs
+ * differ from the defaults still gets its scans and joins ranked wrongly.
+ * With lero_cost_calibration on, a fraction lero_calibration_sample_rate of
+ * the executed queries is instrumented, since timing every node isn't free.
+ * Their scan nodes contribute one sample each: the actual time spent in the
+ * node against the quantities the cost formulas of costsize.c charge for
+ * (sequential pages, random pages, heap tuples, index tuples and operator
+ * evaluations).
+ *
+ * Samples from all backends are accumulated as normal equations in shared
+ * memory, and every CALIB_REFIT_SAMPLES samples the constants are refitted
+ * by least squares.  Cost units are relative, so the published constants are
+ * scaled such that a sequential page keeps costing seq_page_cost.  With
+ * lero_use_calibrated_costs on, planner() plans with the published constants
+ * instead of the configured ones.
+ */
+
+bool lero_cost_calibration = false;
+
+bool lero_use_calibrated_costs = false;
+
+double lero_calibration_sample_rate = 0.1;
+
+typedef struct CalibrationAccum {
+	double xtx[CALIB_NUM_CONSTANTS][CALIB_NUM_CONSTANTS];
+
+	double xty[CALIB_NUM_CONSTANTS];
+
+	int64 nsamples;
+} CalibrationAccum;
+
+typedef struct CalibrationShared {
+	slock_t mutex;
+
+	CalibrationAccum accum;
+
+	// number of samples the published constants were fitted on
+	int64 nsamples_at_fit;
+
+	bool valid;
+
+	// fitted milliseconds per unit of each feature
+	double ms_per_unit[CALIB_NUM_CONSTANTS];
+} CalibrationShared;
+
+static CalibrationShared *calibration = NULL;
+
+static bool collect_node_sample(PlanState *planstate, CalibrationAccum *accum);
+static void refit_constants(void);
+static bool solve_normal_equations(double a[CALIB_NUM_CONSTANTS][CALIB_NUM_CONSTANTS],
+								   double b[CALIB_NUM_CONSTANTS],
+								   double x[CALIB_NUM_CONSTANTS]);
+
+Size
+LeroCalibrationShmemSize(void)
+{
+	return sizeof(CalibrationShared);
+}
+
+void
+LeroCalibrationShmemInit(void)
+{
+	bool found;
+
+	calibration = (CalibrationShared *)
+		ShmemInitStruct("Lero Cost Calibration", LeroCalibrationShmemSize(), &found);
+
+	if (!found) {
+		memset(calibration, 0, sizeof(CalibrationShared));
+		SpinLockInit(&calibration->mutex);
+	}
+}
+
+// Instrumentation the executor must collect for a calibrated query, or 0 if
+// this query isn't sampled.
+int
+lero_calibration_instrument_options(void)
+{
+	if (lero_calibration_sample_rate < 1.0 &&
+		random() > lero_calibration_sample_rate * MAX_RANDOM_VALUE)
+		return 0;
+	return INSTRUMENT_TIMER | INSTRUMENT_BUFFERS;
+}
+
+// Add the scan nodes of a finished query to the calibration samples.
+void
+lero_calibration_collect(QueryDesc *queryDesc)
+{
+	CalibrationAccum accum;
+	bool refit;
+
+	if (calibration == NULL || IsParallelWorker() ||
+		queryDesc->planstate == NULL ||
+		(queryDesc->instrument_options & INSTRUMENT_TIMER) == 0 ||
+		(queryDesc->estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		return;
+
+	memset(&accum, 0, sizeof(CalibrationAccum));
+	collect_node_sample(queryDesc->planstate, &accum);
+	if (accum.nsamples == 0)
+		return;
+
+	SpinLockAcquire(&calibration->mutex);
+	for (int i = 0; i < CALIB_NUM_CONSTANTS; i++) {
+		for (int j = 0; j < CALIB_NUM_CONSTANTS; j++)
+			calibration->accum.xtx[i][j] += accum.xtx[i][j];
+		calibration->accum.xty[i] += accum.xty[i];
+	}
+	calibration->accum.nsamples += accum.nsamples;
+	refit = calibration->accum.nsamples - calibration->nsamples_at_fit >= CALIB_REFIT_SAMPLES;
+	SpinLockRelease(&calibration->mutex);
+
+	if (refit)
+		refit_constants();
+}
+
+// Returns the published constants scaled to the current seq_page_cost.
+bool
+lero_get_calibrated_costs(CalibratedCosts *costs)
+{
+	double ms_per_unit[CALIB_NUM_CONSTANTS];
+	bool valid;
+	double scale;
+
+	if (calibration == NULL)
+		return false;
+
+	SpinLockAcquire(&calibration->mutex);
+	valid = calibration->valid;
+	memcpy(ms_per_unit, calibration->ms_per_unit, sizeof(ms_per_unit));
+	SpinLockRelease(&calibration->mutex);
+
+	if (!valid)
+		return false;
+
+	scale = seq_page_cost / ms_per_unit[CALIB_SEQ_PAGE];
+	costs->seq_page_cost = seq_page_cost;
+	costs->random_page_cost = ms_per_unit[CALIB_RANDOM_PAGE] * scale;
+	costs->cpu_tuple_cost = ms_per_unit[CALIB_CPU_TUPLE] * scale;
+	costs->cpu_index_tuple_cost = ms_per_unit[CALIB_CPU_INDEX_TUPLE] * scale;
+	costs->cpu_operator_cost = ms_per_unit[CALIB_CPU_OPERATOR] * scale;
+	return true;
+}
+
+static bool
+collect_node_sample(PlanState *planstate, CalibrationAccum *accum)
+{
+	Instrumentation *instr = planstate->instrument;
+	Plan *plan = planstate->plan;
+	double x[CALIB_NUM_CONSTANTS] = {0.0};
+	double pages, tuples, ms;
+
+	if (instr == NULL)
+		return false;
+
+	InstrEndLoop(instr);
+	if (instr->nloops <= 0)
+		return planstate_tree_walker(planstate, collect_node_sample, accum);
+
+	pages = instr->bufusage.shared_blks_hit + instr->bufusage.shared_blks_read +
+		instr->bufusage.local_blks_hit + instr->bufusage.local_blks_read;
+	tuples = instr->ntuples + instr->nfiltered1;
+	ms = instr->total * 1000.0;
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+			x[CALIB_SEQ_PAGE] = pages;
+			x[CALIB_CPU_TUPLE] = tuples;
+			x[CALIB_CPU_OPERATOR] = tuples * list_length(plan->qual);
+			break;
+		case T_IndexScan:
+			x[CALIB_RANDOM_PAGE] = pages;
+			x[CALIB_CPU_TUPLE] = tuples;
+			x[CALIB_CPU_INDEX_TUPLE] = tuples;
+			x[CALIB_CPU_OPERATOR] = tuples * (list_length(plan->qual) +
+				list_length(((IndexScan *) plan)->indexqualorig));
+			break;
+		case T_IndexOnlyScan:
+			x[CALIB_RANDOM_PAGE] = pages;
+			x[CALIB_CPU_TUPLE] = tuples;
+			x[CALIB_CPU_INDEX_TUPLE] = tuples;
+			x[CALIB_CPU_OPERATOR] = tuples * (list_length(plan->qual) +
+				list_length(((IndexOnlyScan *) plan)->indexqual));
+			break;
+		default:
+			// only leaf scans have a self time we can attribute
+			return planstate_tree_walker(planstate, collect_node_sample, accum);
+	}
+
+	for (int i = 0; i < CALIB_NUM_CONSTANTS; i++) {
+		for (int j = 0; j < CALIB_NUM_CONSTANTS; j++)
+			accum->xtx[i][j] += x[i] * x[j];
+		accum->xty[i] += x[i] * ms;
+	}
+	accum->nsamples++;
+
+	return planstate_tree_walker(planstate, collect_node_sample, accum);
+}
+
+static void
+refit_constants(void)
+{
+	CalibrationAccum accum;
+	double beta[CALIB_NUM_CONSTANTS];
+	bool ok;
+
+	SpinLockAcquire(&calibration->mutex);
+	accum = calibration->accum;
+	calibration->nsamples_at_fit = accum.nsamples;
+	SpinLockRelease(&calibration->mutex);
+
+	ok = solve_normal_equations(accum.xtx, accum.xty, beta);
+	if (ok) {
+		// a feature nothing has exercised yet keeps a small positive price
+		for (int i = 0; i < CALIB_NUM_CONSTANTS; i++) {
+			if (!(beta[i] > 0.0))
+				beta[i] = 0.0;
+		}
+		ok = beta[CALIB_SEQ_PAGE] > 0.0;
+		if (ok) {
+			for (int i = 0; i < CALIB_NUM_CONSTANTS; i++) {
+				if (beta[i] == 0.0)
+					beta[i] = beta[CALIB_SEQ_PAGE] * 1e-4;
+			}
+		}
+	}
+
+	if (!ok) {
+		elog(DEBUG1, "cost calibration could not fit %lld samples",
+			 (long long) accum.nsamples);
+		return;
+	}
+
+	SpinLockAcquire(&calibration->mutex);
+	memcpy(calibration->ms_per_unit, beta, sizeof(beta));
+	calibration->valid = true;
+	SpinLockRelease(&calibration->mutex);
+
+	elog(DEBUG1, "cost calibration refitted on %lld samples",
+		 (long long) accum.nsamples);
+}
+
+/*
+ * Solve (A + lambda I) x = b by Gaussian elimination with partial pivoting.
+ * The small ridge term keeps features that never occurred from making the
+ * system singular.
+ */
+static bool
+solve_normal_equations(double a[CALIB_NUM_CONSTANTS][CALIB_NUM_CONSTANTS],
+					   double b[CALIB_NUM_CONSTANTS],
+					   double x[CALIB_NUM_CONSTANTS])
+{
+	const int n = CALIB_NUM_CONSTANTS;
+	double m[CALIB_NUM_CONSTANTS][CALIB_NUM_CONSTANTS + 1];
+	double trace = 0.0;
+	double lambda;
+
+	for (int i = 0; i < n; i++)
+		trace += a[i][i];
+	if (trace <= 0.0)
+		return false;
+	lambda = trace * 1e-9;
+
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++)
+			m[i][j] = a[i][j] + (i == j ? lambda : 0.0);
+		m[i][n] = b[i];
+	}
+
+	for (int col = 0; col < n; col++) {
+		int pivot = col;
+
+		for (int row = col + 1; row < n; row++) {
+			if (fabs(m[row][col]) > fabs(m[pivot][col]))
+				pivot = row;
+		}
+		if (fabs(m[pivot][col]) < 1e-300)
+			return false;
+		if (pivot != col) {
+			for (int j = col; j <= n; j++) {
+				double tmp = m[col][j];
+
+				m[col][j] = m[pivot][j];
+				m[pivot][j] = tmp;
+			}
+		}
+
+		for (int row = col + 1; row < n; row++) {
+			double factor = m[row][col] / m[col][col];
+
+			for (int j = col; j <= n; j++)
+				m[row][j] -= factor * m[col][j];
+		}
+	}
+
+	for (int row = n - 1; row >= 0; row--) {
+		double sum = m[row][n];
+
+		for (int j = row + 1; j < n; j++)
+			sum -= m[row][j] * x[j];
+		x[row] = sum / m[row][row];
+	}
+	return true;
+}
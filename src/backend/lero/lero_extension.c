@@ -1,13 +1,16 @@
 #include "lero/lero_extension.h"
 #include "miscadmin.h"
 #include "optimizer/appendinfo.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/planner.h"
 #include "optimizer/paths.h"
 #include "partitioning/partbounds.h"
+#include "storage/fd.h"
 #include "nodes/bitmapset.h"
 #include "utils/memutils.h"
+#include "lero/router.h"
 #include "lero/utils.h"
 #include "lero/yyjson.h"
 #include "commands/explain.h"
@@ -26,6 +29,8 @@ bool enable_lero_verbose = false;
 // lero server configuration
 int lero_server_port = 14567;
 char *lero_server_host = "localhost";
+// milliseconds to wait for a connection to a Lero server, 0 means forever
+int lero_connect_timeout = 1000;
 
 // the number of join cardinalities to be calculated in this query
 int join_card_num = -1;
@@ -43,6 +48,19 @@ RelatedTable *join_input_tables[CARD_MAX_NUM] = {NULL};
 int cur_card_idx = 0;
 
 char* query_unique_id = NULL;
+// fingerprint of the query being planned, messages are routed by it
+static uint32 query_route_hash = 0;
+
+// join cardinalities read from lero_joinest_fname, handed out in call order
+#define CARD_EST_QUERY_NUM 30000
+char *lero_joinest_fname = "";
+static double join_card_ests[CARD_EST_QUERY_NUM] = {0.0};
+static int join_est_no = 0;
+static int max_join_est_no = -1;
+static bool join_card_ests_loaded = false;
+// the file the estimates above come from
+static char join_card_ests_fname[MAXPGPATH] = "";
+static join_size_estimate_hook_type prev_join_size_estimate_hook = NULL;
 
 
 static
@@ -61,6 +79,99 @@ void get_join_card_list();
 static 
 void remove_opt_state();
 
+static
+void read_from_fspn_join_estimate(const char* filename);
+
+static
+bool lero_file_join_size_estimate(PlannerInfo *root, RelOptInfo *joinrel,
+								  RelOptInfo *outer_rel, RelOptInfo *inner_rel,
+								  double outer_rows, double inner_rows,
+								  SpecialJoinInfo *sjinfo, List *restrictlist,
+								  double *nrows);
+
+/*
+ * Install the file-based join size estimator while lero_joinest_fname is set.
+ * It is an ordinary join_size_estimate_hook plug-in, so a loadable module can
+ * supply estimates computed in-process the same way.
+ *
+ * The file holds one estimate per line, handed out in the order the planner
+ * asks for them.  The planner caches plug-in estimates for the rest of the
+ * planning cycle, so a line is consumed by each distinct estimate, that is
+ * each join relation and set of input sizes, rather than by each call as
+ * before the hook existed.  The position in the file is kept for the life of
+ * the backend, and only starts over when a different file is set.
+ */
+void
+assign_lero_joinest_fname(const char *newval, void *extra)
+{
+	bool enable = newval != NULL && newval[0] != '\0';
+
+	if (enable && join_size_estimate_hook != lero_file_join_size_estimate) {
+		prev_join_size_estimate_hook = join_size_estimate_hook;
+		join_size_estimate_hook = lero_file_join_size_estimate;
+	} else if (!enable && join_size_estimate_hook == lero_file_join_size_estimate) {
+		join_size_estimate_hook = prev_join_size_estimate_hook;
+		prev_join_size_estimate_hook = NULL;
+	}
+
+	// read a different file from its start on its next use; assign hooks also
+	// run when the value didn't change, e.g. on a configuration reload
+	if (enable && strcmp(newval, join_card_ests_fname) != 0) {
+		strlcpy(join_card_ests_fname, newval, sizeof(join_card_ests_fname));
+		join_card_ests_loaded = false;
+		join_est_no = 0;
+	}
+}
+
+static
+bool lero_file_join_size_estimate(PlannerInfo *root, RelOptInfo *joinrel,
+								  RelOptInfo *outer_rel, RelOptInfo *inner_rel,
+								  double outer_rows, double inner_rows,
+								  SpecialJoinInfo *sjinfo, List *restrictlist,
+								  double *nrows)
+{
+	if (!join_card_ests_loaded) {
+		read_from_fspn_join_estimate(lero_joinest_fname);
+		join_card_ests_loaded = true;
+	}
+
+	if (join_est_no <= max_join_est_no) {
+		*nrows = join_card_ests[join_est_no];
+		Assert(*nrows >= 0);
+		elog(DEBUG1, "set card %f", *nrows);
+		join_est_no++;
+		return true;
+	}
+
+	if (prev_join_size_estimate_hook)
+		return prev_join_size_estimate_hook(root, joinrel, outer_rel, inner_rel,
+											outer_rows, inner_rows,
+											sjinfo, restrictlist, nrows);
+	return false;
+}
+
+static
+void read_from_fspn_join_estimate(const char* filename)
+{
+	FILE* fp = AllocateFile(filename, "r");
+	double card_est;
+	int cnt = -1;
+
+	if (fp == NULL) {
+		elog(WARNING, "could not open join estimate file \"%s\": %m", filename);
+		max_join_est_no = -1;
+		return;
+	}
+
+	while (cnt + 1 < CARD_EST_QUERY_NUM && fscanf(fp, "%lf", &card_est) == 1) {
+		cnt += 1;
+		join_card_ests[cnt] = card_est;
+	}
+
+	max_join_est_no = cnt;
+	FreeFile(fp);
+}
+
 void lero_pgsysml_set_joinrel_size_estimates(PlannerInfo *root, RelOptInfo *rel,
 											RelOptInfo *outer_rel,
 											RelOptInfo *inner_rel,
@@ -102,6 +213,7 @@ PlannedStmt *lero_pgsysml_hook_planner(Query *parse, const char *queryString,
 	}
 
 	query_unique_id = get_query_unique_id(queryString);
+	query_route_hash = get_query_fingerprint(parse, queryString);
 
 	LeroPlan *plan_for_card[PLAN_MAX_SAMPLES];
 	Query *query_copy;
@@ -217,10 +329,9 @@ LeroPlan *get_lero_plan(int i, Query *parse, const char *queryString,
 static 
 void send_default_rows(const char *queryString)
 {
-	int conn_fd = connect_to_server(lero_server_host, lero_server_port);
+	int conn_fd = connect_to_lero_server(query_route_hash);
 	if (conn_fd == -1)
 	{
-		elog(WARNING, "%s:%d", lero_server_host, lero_server_port);
 		elog(ERROR, "Unable to connect to Lero server.");
 		return;
 	}
@@ -265,9 +376,9 @@ void send_default_rows(const char *queryString)
 	}
 
 	// check whether Lero is initialized
-	char *msg = send_and_receive_msg(conn_fd, send_json);
-	yyjson_doc *msg_doc = parse_json_str(msg);
-	pfree(msg);
+	size_t msg_len;
+	char *msg = send_and_receive_msg(conn_fd, send_json, &msg_len);
+	yyjson_doc *msg_doc = parse_json_str(msg, msg_len);
 
 	yyjson_val *msg_json_obj = yyjson_doc_get_root(msg_doc);
 	yyjson_val *msg_type = yyjson_obj_get(msg_json_obj, MSG_TYPE);
@@ -294,15 +405,15 @@ double predict_plan_score(yyjson_mut_doc *json_doc, yyjson_mut_val *json_root, i
 	char *json = yyjson_mut_write(json_doc, YYJSON_WRITE_PRETTY, NULL);
 	json = concat_str(json, MSG_END_FLAG);
 
-	int conn_fd = connect_to_server(lero_server_host, lero_server_port);
+	int conn_fd = connect_to_lero_server(query_route_hash);
 	if (conn_fd == -1)
 	{
 		elog(ERROR, "Unable to connect to Lero server.");
 	}
 
-	char *msg = send_and_receive_msg(conn_fd, json);
-	yyjson_doc *msg_doc = parse_json_str(msg);
-	pfree(msg);
+	size_t msg_len;
+	char *msg = send_and_receive_msg(conn_fd, json, &msg_len);
+	yyjson_doc *msg_doc = parse_json_str(msg, msg_len);
 
 	yyjson_val *msg_json_obj = yyjson_doc_get_root(msg_doc);
 	yyjson_val *msg_type = yyjson_obj_get(msg_json_obj, MSG_TYPE);
@@ -336,17 +447,17 @@ void get_join_card_list() {
 		free(json);
 	}
 
-	int conn_fd = connect_to_server(lero_server_host, lero_server_port);
+	int conn_fd = connect_to_lero_server(query_route_hash);
 	if (conn_fd == -1)
 	{
 		elog(ERROR, "Unable to connect to Lero server.");
 	}
-	char *msg = send_and_receive_msg(conn_fd, send_json);
-	yyjson_doc *msg_doc = parse_json_str(msg);
+	size_t msg_len;
+	char *msg = send_and_receive_msg(conn_fd, send_json, &msg_len);
+	yyjson_doc *msg_doc = parse_json_str(msg, msg_len);
 	
 	close(conn_fd);
 	yyjson_mut_doc_free(json_doc);
-	pfree(msg);
 	pfree(send_json);
 	
 	yyjson_val *msg_json_obj = yyjson_doc_get_root(msg_doc);
@@ -389,17 +500,17 @@ void remove_opt_state() {
 		free(json);
 	}
 
-	int conn_fd = connect_to_server(lero_server_host, lero_server_port);
+	int conn_fd = connect_to_lero_server(query_route_hash);
 	if (conn_fd == -1)
 	{
 		elog(ERROR, "Unable to connect to Lero server.");
 	}
-	char *msg = send_and_receive_msg(conn_fd, send_json);
-	yyjson_doc *msg_doc = parse_json_str(msg);
+	size_t msg_len;
+	char *msg = send_and_receive_msg(conn_fd, send_json, &msg_len);
+	yyjson_doc *msg_doc = parse_json_str(msg, msg_len);
 	
 	close(conn_fd);
 	yyjson_mut_doc_free(json_doc);
-	pfree(msg);
 	pfree(send_json);
 	
 	yyjson_val *msg_json_obj = yyjson_doc_get_root(msg_doc);
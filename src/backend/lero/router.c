@@ -0,0 +1,217 @@
+#include "postgres.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "common/hashfn.h"
+#include "lero/lero_extension.h"
+#include "lero/router.h"
+#include "lero/utils.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+#include "utils/varlena.h"
+
+/*
+ * Routing of Lero messages over several model servers.
+ *
+ * lero_servers holds a comma separated list of host:port endpoints.  Every
+ * endpoint owns LERO_RING_VNODES points on a consistent hash ring and a
+ * message is sent to the first point following its route hash.  Messages
+ * are routed by the fingerprint of the query they are about, so the
+ * exploration state kept by a server (init -> join_card -> remove_state)
+ * stays on that server, a query that is planned again goes back to the
+ * server that has seen it, and different queries spread over all of them.
+ *
+ * An endpoint that refuses a connection is taken off the ring for
+ * LERO_DEAD_RETRY_MS; only the keys it owned move to other servers.  When
+ * lero_servers is empty, lero_server_host and lero_server_port are used as a
+ * single endpoint.
+ */
+
+// comma separated host:port list of Lero servers
+char *lero_servers = "";
+
+typedef struct LeroEndpoint {
+	char *host;
+
+	int port;
+
+	// the endpoint is kept off the ring until this time
+	TimestampTz dead_until;
+} LeroEndpoint;
+
+typedef struct RingPoint {
+	uint32 hash;
+
+	int endpoint;
+} RingPoint;
+
+// the configuration the endpoints below were parsed from
+static char *endpoints_config = NULL;
+static LeroEndpoint *endpoints = NULL;
+static int num_endpoints = 0;
+
+static RingPoint *ring = NULL;
+static int num_ring_points = 0;
+static bool ring_valid = false;
+// earliest time a dead endpoint may rejoin the ring, 0 if none is dead
+static TimestampTz ring_next_revival = 0;
+
+static void load_endpoints(void);
+static void build_ring(TimestampTz now);
+static int ring_point_cmp(const void *a, const void *b);
+static int ring_lookup(uint32 hash);
+
+// Connect to the server owning the given route hash, failing over to the
+// next live server on the ring.  Returns -1 if no server is reachable.
+int
+connect_to_lero_server(uint32 route_hash)
+{
+	load_endpoints();
+
+	for (;;)
+	{
+		TimestampTz now = GetCurrentTimestamp();
+		LeroEndpoint *ep;
+		int conn_fd;
+
+		if (!ring_valid || (ring_next_revival != 0 && now >= ring_next_revival))
+			build_ring(now);
+		if (num_ring_points == 0)
+			return -1;
+
+		ep = &endpoints[ring[ring_lookup(route_hash)].endpoint];
+		conn_fd = connect_to_server(ep->host, ep->port);
+		if (conn_fd >= 0)
+			return conn_fd;
+
+		elog(WARNING, "Lero server %s:%d is unreachable, removing it from the ring",
+			 ep->host, ep->port);
+		ep->dead_until = TimestampTzPlusMilliseconds(now, LERO_DEAD_RETRY_MS);
+		ring_valid = false;
+	}
+}
+
+// (Re)parse the endpoint list if the configuration has changed.
+static void
+load_endpoints(void)
+{
+	char *config;
+	char *rawstring;
+	List *elemlist;
+	ListCell *lc;
+	MemoryContext oldcxt;
+
+	if (lero_servers != NULL && lero_servers[0] != '\0')
+		config = pstrdup(lero_servers);
+	else
+		config = psprintf("%s:%d", lero_server_host, lero_server_port);
+
+	if (endpoints_config != NULL && strcmp(config, endpoints_config) == 0) {
+		pfree(config);
+		return;
+	}
+
+	if (endpoints != NULL) {
+		for (int i = 0; i < num_endpoints; i++)
+			pfree(endpoints[i].host);
+		pfree(endpoints);
+		pfree(endpoints_config);
+	}
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	endpoints_config = pstrdup(config);
+	rawstring = pstrdup(config);
+	if (!SplitGUCList(rawstring, ',', &elemlist))
+		elemlist = NIL;
+
+	endpoints = (LeroEndpoint *) palloc0(Max(list_length(elemlist), 1) * sizeof(LeroEndpoint));
+	num_endpoints = 0;
+	foreach(lc, elemlist) {
+		char *item = (char *) lfirst(lc);
+		char *sep = strrchr(item, ':');
+		LeroEndpoint *ep;
+
+		if (sep == NULL || sep == item || sep[1] == '\0') {
+			elog(WARNING, "ignoring malformed Lero server \"%s\", expected host:port", item);
+			continue;
+		}
+
+		ep = &endpoints[num_endpoints++];
+		ep->host = pnstrdup(item, sep - item);
+		ep->port = atoi(sep + 1);
+		ep->dead_until = 0;
+	}
+	list_free(elemlist);
+	pfree(rawstring);
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(config);
+	ring_valid = false;
+}
+
+// Put every live endpoint on the ring.
+static void
+build_ring(TimestampTz now)
+{
+	if (ring == NULL)
+		ring = (RingPoint *) MemoryContextAlloc(TopMemoryContext,
+			Max(num_endpoints, 1) * LERO_RING_VNODES * sizeof(RingPoint));
+	else
+		ring = (RingPoint *) repalloc(ring,
+			Max(num_endpoints, 1) * LERO_RING_VNODES * sizeof(RingPoint));
+
+	num_ring_points = 0;
+	ring_next_revival = 0;
+	for (int i = 0; i < num_endpoints; i++) {
+		LeroEndpoint *ep = &endpoints[i];
+
+		if (ep->dead_until > now) {
+			if (ring_next_revival == 0 || ep->dead_until < ring_next_revival)
+				ring_next_revival = ep->dead_until;
+			continue;
+		}
+
+		for (int v = 0; v < LERO_RING_VNODES; v++) {
+			// not a fixed-size buffer: host names can be of any length
+			char *point_name = psprintf("%s:%d#%d", ep->host, ep->port, v);
+
+			ring[num_ring_points].hash = hash_bytes((const unsigned char *) point_name,
+													strlen(point_name));
+			ring[num_ring_points].endpoint = i;
+			num_ring_points++;
+			pfree(point_name);
+		}
+	}
+
+	qsort(ring, num_ring_points, sizeof(RingPoint), ring_point_cmp);
+	ring_valid = true;
+}
+
+static int
+ring_point_cmp(const void *a, const void *b)
+{
+	const RingPoint *pa = (const RingPoint *) a;
+	const RingPoint *pb = (const RingPoint *) b;
+
+	if (pa->hash != pb->hash)
+		return pa->hash < pb->hash ? -1 : 1;
+	return pa->endpoint - pb->endpoint;
+}
+
+// Find the first ring point at or after the given hash, wrapping around.
+static int
+ring_lookup(uint32 hash)
+{
+	int lo = 0;
+	int hi = num_ring_points;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (ring[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo == num_ring_points ? 0 : lo;
+}
@@ -3,8 +3,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <unistd.h>
+#include "common/hashfn.h"
+#include "lib/stringinfo.h"
 #include "nodes/pg_list.h"
 #include "lero/utils.h"
 #include "c.h"
@@ -15,15 +19,17 @@
 #include "nodes/pathnodes.h"
 #include "miscadmin.h"
 #include "parser/parsetree.h"
+#include "utils/memutils.h"
 
-#define MSG_SIZE 524288
+#define RECV_ARENA_INITIAL_SIZE 8192
 #define SOCKET_ERR -1
 #define SOCKET_SUCC 0
 
-// Connect to the server.
+// Connect to the server, giving up after lero_connect_timeout so that a dead
+// server can't hang planning.
 int 
 connect_to_server(const char* host, int port) {
-  int ret, conn_fd;
+  int ret, conn_fd, flags;
   struct sockaddr_in server_addr = { 0 };
 
   server_addr.sin_family = AF_INET;
@@ -33,10 +39,40 @@ connect_to_server(const char* host, int port) {
   if (conn_fd < 0) {
     return conn_fd;
   }
-  
+
+  // connect without blocking, and wait for it to complete ourselves
+  flags = fcntl(conn_fd, F_GETFL, 0);
+  if (flags == -1 || fcntl(conn_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    close(conn_fd);
+    return SOCKET_ERR;
+  }
+
   ret = connect(conn_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
-  if (ret == -1) {
-    return ret;
+  if (ret == -1 && errno == EINPROGRESS) {
+    struct pollfd pfd = { 0 };
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+
+    pfd.fd = conn_fd;
+    pfd.events = POLLOUT;
+    do {
+      ret = poll(&pfd, 1, lero_connect_timeout > 0 ? lero_connect_timeout : -1);
+    } while (ret == -1 && errno == EINTR);
+
+    // timed out, or the connection failed
+    if (ret != 1 ||
+        getsockopt(conn_fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == -1 ||
+        err != 0) {
+      ret = SOCKET_ERR;
+    } else {
+      ret = SOCKET_SUCC;
+    }
+  }
+
+  // the messages are exchanged with blocking I/O
+  if (ret == -1 || fcntl(conn_fd, F_SETFL, flags) == -1) {
+    close(conn_fd);
+    return SOCKET_ERR;
   }
 
   return conn_fd;
@@ -75,45 +111,138 @@ concat_str(char* a, char *b)
 	return output;
 }
 
+/*
+ * Receive arena shared by every message exchanged with the Lero server.
+ *
+ * The arena lives in TopMemoryContext and is only ever grown, so after the
+ * first few queries a response costs no allocation at all.  Responses are
+ * parsed in place (YYJSON_READ_INSITU), which means a document returned by
+ * parse_json_str() points into the arena and must be freed before the next
+ * call to send_and_receive_msg().
+ */
+static char *recv_arena = NULL;
+static size_t recv_arena_size = 0;
+
+static void
+ensure_recv_arena(size_t needed)
+{
+	size_t new_size;
+
+	if (recv_arena_size >= needed)
+		return;
+
+	new_size = Max(recv_arena_size, RECV_ARENA_INITIAL_SIZE);
+	while (new_size < needed)
+		new_size *= 2;
+
+	if (recv_arena == NULL)
+		recv_arena = (char *) MemoryContextAlloc(TopMemoryContext, new_size);
+	else
+		recv_arena = (char *) repalloc(recv_arena, new_size);
+	recv_arena_size = new_size;
+}
+
+/*
+ * Send json_str to the server and read the whole response into the receive
+ * arena.  The returned pointer is owned by the arena; *len is set to the
+ * length of the response, which is always followed by YYJSON_PADDING_SIZE
+ * zero bytes as required by the in-situ parser.
+ */
 char*
-send_and_receive_msg(int conn_fd, char* json_str) 
+send_and_receive_msg(int conn_fd, char* json_str, size_t *len)
 {
+	size_t offset = 0;
+	ssize_t ret = 0;
+
+	*len = 0;
 	if (conn_fd < 0) {
-      elog(WARNING, "Unable to connect to server.");
-      return;
-    }
+		elog(WARNING, "Unable to connect to server.");
+		return NULL;
+	}
 
 	write_all_to_socket(conn_fd, json_str);
 	shutdown(conn_fd, SHUT_WR);
 
-	int current_msg_size = MSG_SIZE;
-	char *msg = (char *) palloc(current_msg_size * sizeof(char));
-	memset(msg, '\0', current_msg_size);
-    int ret = 0;
-	int offset = 0;
-
-	while ((ret = read(conn_fd, msg + offset, MSG_SIZE - 1)) > 0) {
-		offset += ret;
-		if (offset >= current_msg_size) {
-			int new_msg_size = current_msg_size;
-			while(offset >= new_msg_size) {
-				new_msg_size *= 2;
-			}
+	ensure_recv_arena(RECV_ARENA_INITIAL_SIZE);
+	for (;;)
+	{
+		/* always keep room for the parser's padding */
+		if (recv_arena_size - offset <= YYJSON_PADDING_SIZE)
+			ensure_recv_arena(recv_arena_size * 2);
 
-			msg = (char *) repalloc(msg, new_msg_size * sizeof(char));
-			current_msg_size = new_msg_size;
-		}
+		ret = read(conn_fd, recv_arena + offset,
+				   recv_arena_size - offset - YYJSON_PADDING_SIZE);
+		if (ret > 0)
+			offset += ret;
+		else if (ret < 0 && errno == EINTR)
+			continue;
+		else
+			break;
 	}
-	msg[offset] = '\0';
+	memset(recv_arena + offset, '\0', YYJSON_PADDING_SIZE);
 
 	if (SOCKET_ERR == ret) {
 		elog(WARNING, "can not read the response from the server.");
 	}
-	return msg;
+	*len = offset;
+	return recv_arena;
+}
+
+/*
+ * Fingerprint of a query, used to route all of its messages to the same Lero
+ * server.  The query id is used if a module such as pg_stat_statements has
+ * computed one.  Otherwise the query text is hashed, ignoring letter case and
+ * white space outside of quoted strings and identifiers, so that the same
+ * query written slightly differently still goes to the same server.
+ */
+uint32
+get_query_fingerprint(Query *parse, const char *queryString)
+{
+	StringInfoData buf;
+	char quote = '\0';
+	bool pending_space = false;
+	uint32 hash;
+
+	if (parse != NULL && parse->queryId != UINT64CONST(0))
+		return (uint32) parse->queryId ^ (uint32) (parse->queryId >> 32);
+
+	initStringInfo(&buf);
+	for (const char *c = queryString; *c != '\0'; c++) {
+		if (quote != '\0') {
+			appendStringInfoChar(&buf, *c);
+			if (*c == quote)
+				quote = '\0';
+			continue;
+		}
+
+		if (isspace((unsigned char) *c)) {
+			pending_space = buf.len > 0;
+			continue;
+		}
+		if (pending_space) {
+			appendStringInfoChar(&buf, ' ');
+			pending_space = false;
+		}
+
+		if (*c == '\'' || *c == '"')
+			quote = *c;
+		appendStringInfoChar(&buf, pg_ascii_tolower((unsigned char) *c));
+	}
+
+	// a trailing semicolon doesn't make a different query
+	while (buf.len > 0 && buf.data[buf.len - 1] == ';')
+		buf.data[--buf.len] = '\0';
+
+	hash = hash_bytes((const unsigned char *) buf.data, buf.len);
+	pfree(buf.data);
+	return hash;
 }
 
 /**
  * A tricky method to create an unique id of a given query.
+ *
+ * It identifies one planning cycle to the Lero server, and differs between
+ * two cycles of the same query; see get_query_fingerprint() for routing.
  */
 char*
 get_query_unique_id(const char *queryString)
@@ -133,19 +262,23 @@ get_query_unique_id(const char *queryString)
 	return unique_id;
 }
 
+/*
+ * Parse a response held in the receive arena.  The data is parsed in place,
+ * so the returned document is only valid until the next message is received.
+ * An empty or malformed response is reported as an error message.
+ */
 yyjson_doc*
-parse_json_str(const char* json)
+parse_json_str(char* json, size_t len)
 {
-    if (json == NULL || strlen(json) == 0)
-    {
-        yyjson_mut_doc *json_doc = yyjson_mut_doc_new(NULL);
-	    yyjson_mut_val *root = yyjson_mut_obj(json_doc);
-        yyjson_mut_doc_set_root(json_doc, root);
-	    yyjson_mut_obj_put(root, yyjson_mut_strcpy(json_doc, MSG_TYPE), "error");
-        return json_doc;
-    }
+	static const char error_msg[] = "{\"" MSG_TYPE "\":\"" MSG_ERROR "\"}";
+	yyjson_doc *doc = NULL;
+
+	if (json != NULL && len > 0)
+		doc = yyjson_read_opts(json, len, YYJSON_READ_INSITU, NULL, NULL);
 
-    return yyjson_read(json, strlen(json), 0);
+	if (doc == NULL)
+		doc = yyjson_read(error_msg, strlen(error_msg), 0);
+	return doc;
 }
 
 yyjson_mut_val*
@@ -86,12 +86,27 @@ static inline uint32 mod_m(uint32 a, uint64 m);
  */
 bloom_filter *
 bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
+{
+	return bloom_create_extended(total_elems, bloom_work_mem,
+								 1024 * 1024, seed);
+}
+
+/*
+ * Like bloom_create, but with a bitset of at least min_bitset_bytes instead
+ * of at least 1MB, for callers that want the memory used to follow a small
+ * total_elems more closely.
+ */
+bloom_filter *
+bloom_create_extended(int64 total_elems, int bloom_work_mem,
+					  Size min_bitset_bytes, uint64 seed)
 {
 	bloom_filter *filter;
 	int			bloom_power;
 	uint64		bitset_bytes;
 	uint64		bitset_bits;
 
+	Assert(min_bitset_bytes > 0);
+
 	/*
 	 * Aim for two bytes per element; this is sufficient to get a false
 	 * positive rate below 1%, independent of the size of the bitset or total
@@ -100,7 +115,7 @@ bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 	 * false positive rate still won't exceed 2% in almost all cases.
 	 */
 	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
-	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+	bitset_bytes = Max(min_bitset_bytes, bitset_bytes);
 
 	/*
 	 * Size in bits should be the highest power of two <= target.  bitset_bits
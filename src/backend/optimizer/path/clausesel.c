@@ -18,6 +18,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
+#include "optimizer/estcache.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/plancat.h"
@@ -45,6 +46,9 @@ static void addRangeClause(RangeQueryClause **rqlist, Node *clause,
 static RelOptInfo *find_single_rel_for_clauses(PlannerInfo *root,
 											   List *clauses);
 
+/* Hook for plugins to supply clause list selectivities */
+clauselist_selectivity_hook_type clauselist_selectivity_hook = NULL;
+
 /****************************************************************************
  *		ROUTINES TO COMPUTE SELECTIVITIES
  ****************************************************************************/
@@ -59,11 +63,11 @@ static RelOptInfo *find_single_rel_for_clauses(PlannerInfo *root,
  *
  * See clause_selectivity() for the meaning of the additional parameters.
  *
- * The basic approach is to apply extended statistics first, on as many
- * clauses as possible, in order to capture cross-column dependencies etc.
- * The remaining clauses are then estimated using regular statistics tracked
- * for individual columns.  This is done by simply passing the clauses to
- * clauselist_selectivity_simple.
+ * A plugin can supply the estimate through clauselist_selectivity_hook.
+ * What it returns is cached for the rest of the planning cycle, keyed by the
+ * clause set (see estcache.c), so it must depend only on the clauses and the
+ * varRelid/jointype/sjinfo context.  The plugin can fall back on the
+ * built-in estimate by calling standard_clauselist_selectivity.
  */
 Selectivity
 clauselist_selectivity(PlannerInfo *root,
@@ -71,6 +75,48 @@ clauselist_selectivity(PlannerInfo *root,
 					   int varRelid,
 					   JoinType jointype,
 					   SpecialJoinInfo *sjinfo)
+{
+	if (clauselist_selectivity_hook && clauses != NIL)
+	{
+		Relids		relids = sjinfo ? bms_union(sjinfo->syn_lefthand,
+												 sjinfo->syn_righthand) : NULL;
+		double		cached;
+		Selectivity selec;
+
+		if (estimate_cache_lookup(root, EST_CLAUSELIST_SELEC, relids,
+								  varRelid, jointype, 0, 0, clauses, &cached))
+			return (Selectivity) cached;
+
+		if ((*clauselist_selectivity_hook) (root, clauses, varRelid,
+											jointype, sjinfo, &selec))
+		{
+			CLAMP_PROBABILITY(selec);
+			estimate_cache_store(root, EST_CLAUSELIST_SELEC, relids,
+								 varRelid, jointype, 0, 0, clauses, selec);
+			return selec;
+		}
+	}
+
+	return standard_clauselist_selectivity(root, clauses, varRelid,
+										   jointype, sjinfo);
+}
+
+/*
+ * standard_clauselist_selectivity -
+ *	  The built-in estimate for clauselist_selectivity.
+ *
+ * The basic approach is to apply extended statistics first, on as many
+ * clauses as possible, in order to capture cross-column dependencies etc.
+ * The remaining clauses are then estimated using regular statistics tracked
+ * for individual columns.  This is done by simply passing the clauses to
+ * clauselist_selectivity_simple.
+ */
+Selectivity
+standard_clauselist_selectivity(PlannerInfo *root,
+								List *clauses,
+								int varRelid,
+								JoinType jointype,
+								SpecialJoinInfo *sjinfo)
 {
 	Selectivity s1 = 1.0;
 	RelOptInfo *rel;
@@ -84,6 +84,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
+#include "optimizer/estcache.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -108,14 +109,6 @@
  */
 #define APPEND_CPU_COST_MULTIPLIER 0.5
 
-/** Lero Extension */
-#define CARD_EST_QUERY_NUM 30000
-double 		join_card_ests[CARD_EST_QUERY_NUM] = {0.0};
-int         join_est_no = 0;
-int			max_join_est_no = CARD_EST_QUERY_NUM - 1;
-char        *lero_joinest_fname = "";
-/** ==== Lero Extension ==== */
-
 double		seq_page_cost = DEFAULT_SEQ_PAGE_COST;
 double		random_page_cost = DEFAULT_RANDOM_PAGE_COST;
 double		cpu_tuple_cost = DEFAULT_CPU_TUPLE_COST;
@@ -147,6 +140,7 @@ bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = false;
 bool		enable_partition_pruning = true;
 
 typedef struct
@@ -175,7 +169,8 @@ static double calc_joinrel_size_estimate(PlannerInfo *root,
 										 double outer_rows,
 										 double inner_rows,
 										 SpecialJoinInfo *sjinfo,
-										 List *restrictlist);
+										 List *restrictlist,
+										 bool *from_plugin);
 static Selectivity get_foreign_key_join_selectivity(PlannerInfo *root,
 													Relids outer_relids,
 													Relids inner_relids,
@@ -186,25 +181,9 @@ static Cost append_nonpartial_cost(List *subpaths, int numpaths,
 static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
-static double get_parallel_divisor(Path *path);
-
-/** Lero Extension */
-void
-read_from_fspn_join_estimate(const char* filename){
-    FILE* fp = fopen(filename, "r");
-
-    double card_est;
-    int cnt = -1;
 
-    while (fscanf(fp, "%lf", &card_est) == 1){
-		cnt += 1;
-        join_card_ests[cnt] = card_est;
-    }
-
-	max_join_est_no = cnt;
-    fclose(fp);
-}
-/** ==== Lero Extension ==== */
+/* Hook for plugins to supply join size estimates */
+join_size_estimate_hook_type join_size_estimate_hook = NULL;
 
 /*
  * clamp_row_est
@@ -4750,6 +4729,9 @@ set_joinrel_size_estimates(PlannerInfo *root, RelOptInfo *rel,
 						   SpecialJoinInfo *sjinfo,
 						   List *restrictlist)
 {
+	double		sampled_rows;
+	bool		from_plugin;
+
 	rel->rows = calc_joinrel_size_estimate(root,
 										   rel,
 										   outer_rel,
@@ -4757,7 +4739,17 @@ set_joinrel_size_estimates(PlannerInfo *root, RelOptInfo *rel,
 										   outer_rel->rows,
 										   inner_rel->rows,
 										   sjinfo,
-										   restrictlist);
+										   restrictlist,
+										   &from_plugin);
+
+	/*
+	 * Measure the size instead if the estimate is uncertain and allowed, but
+	 * don't second-guess an estimator plugin.
+	 */
+	if (join_sample_rows > 0 && !from_plugin &&
+		estimate_join_size_by_sampling(root, rel, outer_rel, inner_rel,
+									   sjinfo, restrictlist, &sampled_rows))
+		rel->rows = sampled_rows;
 	if (enable_lero) {
         lero_pgsysml_set_joinrel_size_estimates(root, rel, outer_rel,
                                                inner_rel, sjinfo, restrictlist);
@@ -4804,7 +4796,8 @@ get_parameterized_joinrel_size(PlannerInfo *root, RelOptInfo *rel,
 									   outer_path->rows,
 									   inner_path->rows,
 									   sjinfo,
-									   restrict_clauses);
+									   restrict_clauses,
+									   NULL);
 	/* For safety, make sure result is not more than the base estimate */
 	if (nrows > rel->rows)
 		nrows = rel->rows;
@@ -4819,6 +4812,9 @@ get_parameterized_joinrel_size(PlannerInfo *root, RelOptInfo *rel,
  * outer_rel/inner_rel are the relations being joined, but they should be
  * assumed to have sizes outer_rows/inner_rows; those numbers might be less
  * than what rel->rows says, when we are considering parameterized paths.
+ *
+ * If from_plugin isn't NULL, *from_plugin is set to whether the estimate
+ * came from join_size_estimate_hook.
  */
 static double
 calc_joinrel_size_estimate(PlannerInfo *root,
@@ -4828,7 +4824,8 @@ calc_joinrel_size_estimate(PlannerInfo *root,
 						   double outer_rows,
 						   double inner_rows,
 						   SpecialJoinInfo *sjinfo,
-						   List *restrictlist_in)
+						   List *restrictlist_in,
+						   bool *from_plugin)
 {
 	/* This apparently-useless variable dodges a compiler bug in VS2013: */
 	List	   *restrictlist = restrictlist_in;
@@ -4838,6 +4835,41 @@ calc_joinrel_size_estimate(PlannerInfo *root,
 	Selectivity pselec;
 	double		nrows;
 
+	if (from_plugin)
+		*from_plugin = false;
+
+	/*
+	 * Give an estimator plugin the first chance.  Its answer is cached for
+	 * the rest of the planning cycle, keyed by the joinrel's relids, the
+	 * input sizes and the clause set, so asking again for another pair of
+	 * input rels costs nothing.  Parameterized paths have smaller inputs, so
+	 * they get estimates of their own.
+	 */
+	if (join_size_estimate_hook)
+	{
+		if (estimate_cache_lookup(root, EST_JOINREL_ROWS, joinrel->relids,
+								  0, jointype, outer_rows, inner_rows,
+								  restrictlist, &nrows))
+		{
+			if (from_plugin)
+				*from_plugin = true;
+			return nrows;
+		}
+
+		if ((*join_size_estimate_hook) (root, joinrel, outer_rel, inner_rel,
+										outer_rows, inner_rows,
+										sjinfo, restrictlist, &nrows))
+		{
+			nrows = clamp_row_est(nrows);
+			estimate_cache_store(root, EST_JOINREL_ROWS, joinrel->relids,
+								 0, jointype, outer_rows, inner_rows,
+								 restrictlist, nrows);
+			if (from_plugin)
+				*from_plugin = true;
+			return nrows;
+		}
+	}
+
 	/*
 	 * Compute joinclause selectivity.  Note that we are only considering
 	 * clauses that become restriction clauses at this join level; we are not
@@ -4954,23 +4986,6 @@ calc_joinrel_size_estimate(PlannerInfo *root,
 			break;
 	}
 
-	/** Lero extension */
-    if (lero_joinest_fname != NULL && strlen(lero_joinest_fname) > 0) {
-        if (join_est_no == 0) {
-            read_from_fspn_join_estimate(lero_joinest_fname);
-        }
-
-		if (join_est_no <= max_join_est_no) {
-			double join_est = join_card_ests[join_est_no];
-			Assert(join_est >= 0);
-			elog(WARNING, "set card %f", join_est);
-
-			join_est_no++;
-			return clamp_row_est(join_est);
-		}
-    }
-	/** ==== Lero Extension ==== */
-
 	return clamp_row_est(nrows);
 }
 
@@ -5756,7 +5771,7 @@ page_size(double tuples, int width)
  * Estimate the fraction of the work that each worker will do given the
  * number of workers budgeted for the path.
  */
-static double
+double
 get_parallel_divisor(Path *path)
 {
 	double		parallel_divisor = path->parallel_workers;
@@ -0,0 +1,576 @@
+/*-------------------------------------------------------------------------
+ *
+ * joinsample.c
+ *	  Correct uncertain join size estimates by sampling at plan time
+ *
+ * The selectivity of a join clause is normally derived from per-column
+ * statistics, assuming that several clauses are independent of each other.
+ * When that assumption fails, or there are no statistics at all, the row
+ * estimate can be off by orders of magnitude and a catastrophic join order
+ * results.  For such "uncertain" joins we optionally measure the selectivity
+ * instead: both base relations involved are block-sampled once per planning
+ * cycle, and the join clauses are evaluated over the cross product of the
+ * two samples (using a hash table when the operators allow it).
+ *
+ * A join is uncertain if some pair of base relations is connected by two or
+ * more clauses, or if a joined column has no statistics.  Only clauses of the
+ * form "a.x op b.y" between plain tables can be sampled; the remaining
+ * clauses are estimated as usual.  Sampling is off unless join_sample_rows
+ * is set, and it is skipped for tables the current user could not read or
+ * that have row level security enabled, since the estimate would otherwise
+ * reveal something about rows the user cannot see.  Estimates supplied by
+ * an estimator plugin are never second-guessed.
+ *
+ * Rows are sampled the way ANALYZE samples them, not through the query's
+ * snapshot: the sample holds the rows that are live for everybody, which is
+ * what an estimate should reflect anyway.  Whole blocks are read, so a sample
+ * can hold up to twice join_sample_rows rows, and it is kept until the end
+ * of the planning cycle.  The sample of each relation is also limited to
+ * work_mem bytes of tuples.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/path/joinsample.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/table.h"
+#include "access/tableam.h"
+#include "catalog/pg_class.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "parser/parsetree.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "utils/acl.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/rls.h"
+#include "utils/sampling.h"
+#include "utils/selfuncs.h"
+
+/* GUC parameter: target number of sample rows per relation, 0 disables */
+int			join_sample_rows = 0;
+
+/*
+ * Clauses whose operators can't be hashed are evaluated for every pair of
+ * sample rows.  Beyond this many pairs, only evenly spaced subsets of the
+ * two samples are compared, to bound the time spent planning.
+ */
+#define JOIN_SAMPLE_MAX_PAIRS	1000000
+
+/* Rows sampled from one base relation, kept for the planning cycle */
+typedef struct JoinSampleRel
+{
+	Index		relid;			/* range table index */
+	bool		valid;			/* false if the rel cannot be sampled */
+	TupleDesc	tupdesc;
+	int			nrows;
+	HeapTuple  *rows;
+} JoinSampleRel;
+
+/* Evaluation state for the clauses of one pair */
+typedef struct PairKeys
+{
+	int			nkeys;
+	FmgrInfo   *opfuncs;
+	Oid		   *collations;
+	bool	   *commuted;		/* call the operator as (side 2, side 1) */
+	Datum	   *values1;		/* nkeys key values per row of sample 1 */
+	Datum	   *values2;		/* likewise for sample 2 */
+} PairKeys;
+
+/* The sampleable join clauses between one pair of base relations */
+typedef struct JoinSamplePair
+{
+	Index		relid1;			/* the lower-numbered relation */
+	Index		relid2;
+	List	   *clauses;		/* RestrictInfos */
+	List	   *vars1;			/* the relid1 side of each clause */
+	List	   *vars2;			/* the relid2 side of each clause */
+	List	   *commuted;		/* true if the clause reads "relid2 op relid1" */
+	bool		uncertain;
+} JoinSamplePair;
+
+static bool sampleable_clause(RestrictInfo *rinfo, Var **leftvar,
+							  Var **rightvar);
+static bool var_lacks_stats(PlannerInfo *root, Var *var);
+static JoinSampleRel *get_join_sample(PlannerInfo *root, Index relid);
+static bool measure_pair_selectivity(PlannerInfo *root, JoinSamplePair *pair,
+									 Selectivity *selec);
+static void extract_keys(JoinSampleRel *sample, List *vars,
+						 Datum *values, bool *hasnull);
+static bool sample_rows_match(PairKeys *keys, int row1, int row2);
+
+
+/*
+ * estimate_join_size_by_sampling
+ *		Estimate the size of an inner join by sampling, if it is uncertain.
+ *
+ * Returns true and sets *nrows if at least one pair of relations was
+ * sampled; false means the caller's estimate stands.
+ */
+bool
+estimate_join_size_by_sampling(PlannerInfo *root, RelOptInfo *joinrel,
+							   RelOptInfo *outer_rel, RelOptInfo *inner_rel,
+							   SpecialJoinInfo *sjinfo, List *restrictlist,
+							   double *nrows)
+{
+	List	   *pairs = NIL;
+	List	   *otherclauses = NIL;
+	Selectivity selec = 1.0;
+	bool		sampled = false;
+	ListCell   *lc;
+
+	if (join_sample_rows <= 0 || sjinfo->jointype != JOIN_INNER)
+		return false;
+
+	/* Group the sampleable clauses by the pair of base rels they connect */
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		Var		   *leftvar;
+		Var		   *rightvar;
+		Index		relid1;
+		Index		relid2;
+		bool		commuted;
+		JoinSamplePair *pair = NULL;
+		ListCell   *lc2;
+
+		if (!sampleable_clause(rinfo, &leftvar, &rightvar) ||
+			!((bms_is_member(leftvar->varno, outer_rel->relids) &&
+			   bms_is_member(rightvar->varno, inner_rel->relids)) ||
+			  (bms_is_member(leftvar->varno, inner_rel->relids) &&
+			   bms_is_member(rightvar->varno, outer_rel->relids))))
+		{
+			otherclauses = lappend(otherclauses, rinfo);
+			continue;
+		}
+
+		commuted = leftvar->varno > rightvar->varno;
+		relid1 = commuted ? rightvar->varno : leftvar->varno;
+		relid2 = commuted ? leftvar->varno : rightvar->varno;
+
+		foreach(lc2, pairs)
+		{
+			JoinSamplePair *p = (JoinSamplePair *) lfirst(lc2);
+
+			if (p->relid1 == relid1 && p->relid2 == relid2)
+			{
+				pair = p;
+				break;
+			}
+		}
+		if (pair == NULL)
+		{
+			pair = (JoinSamplePair *) palloc0(sizeof(JoinSamplePair));
+			pair->relid1 = relid1;
+			pair->relid2 = relid2;
+			pairs = lappend(pairs, pair);
+		}
+
+		pair->clauses = lappend(pair->clauses, rinfo);
+		pair->vars1 = lappend(pair->vars1, commuted ? rightvar : leftvar);
+		pair->vars2 = lappend(pair->vars2, commuted ? leftvar : rightvar);
+		pair->commuted = lappend_int(pair->commuted, commuted);
+		if (list_length(pair->clauses) > 1 ||
+			var_lacks_stats(root, leftvar) ||
+			var_lacks_stats(root, rightvar))
+			pair->uncertain = true;
+	}
+
+	foreach(lc, pairs)
+	{
+		JoinSamplePair *pair = (JoinSamplePair *) lfirst(lc);
+		Selectivity pairselec;
+
+		if (pair->uncertain && measure_pair_selectivity(root, pair, &pairselec))
+		{
+			selec *= pairselec;
+			sampled = true;
+		}
+		else
+			otherclauses = list_concat(otherclauses, pair->clauses);
+	}
+
+	if (!sampled)
+		return false;
+
+	selec *= clauselist_selectivity(root, otherclauses, 0, JOIN_INNER, sjinfo);
+	*nrows = clamp_row_est(outer_rel->rows * inner_rel->rows * selec);
+	return true;
+}
+
+/*
+ * Is this a strict binary operator clause comparing plain user columns of
+ * two different relations?
+ */
+static bool
+sampleable_clause(RestrictInfo *rinfo, Var **leftvar, Var **rightvar)
+{
+	OpExpr	   *opexpr;
+	Node	   *left;
+	Node	   *right;
+
+	if (rinfo->pseudoconstant || !is_opclause(rinfo->clause))
+		return false;
+
+	opexpr = (OpExpr *) rinfo->clause;
+	if (list_length(opexpr->args) != 2 || opexpr->opretset ||
+		!op_strict(opexpr->opno))
+		return false;
+
+	/* binary-compatible relabeling does not change the values compared */
+	left = linitial(opexpr->args);
+	while (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+	right = lsecond(opexpr->args);
+	while (IsA(right, RelabelType))
+		right = (Node *) ((RelabelType *) right)->arg;
+	if (!IsA(left, Var) || !IsA(right, Var))
+		return false;
+
+	*leftvar = (Var *) left;
+	*rightvar = (Var *) right;
+	return (*leftvar)->varlevelsup == 0 && (*rightvar)->varlevelsup == 0 &&
+		(*leftvar)->varattno > 0 && (*rightvar)->varattno > 0 &&
+		(*leftvar)->varno != (*rightvar)->varno;
+}
+
+static bool
+var_lacks_stats(PlannerInfo *root, Var *var)
+{
+	VariableStatData vardata;
+	bool		result;
+
+	examine_variable(root, (Node *) var, 0, &vardata);
+	result = !HeapTupleIsValid(vardata.statsTuple);
+	ReleaseVariableStats(vardata);
+	return result;
+}
+
+/*
+ * get_join_sample
+ *		Fetch (sampling it on first use) the sample of a base relation.
+ *
+ * Returns NULL if the relation cannot or must not be sampled.
+ */
+static JoinSampleRel *
+get_join_sample(PlannerInfo *root, Index relid)
+{
+	RangeTblEntry *rte = planner_rt_fetch(relid, root);
+	RelOptInfo *brel = find_base_rel(root, relid);
+	JoinSampleRel *sample;
+	MemoryContext oldcxt;
+	Relation	rel;
+	BlockNumber nblocks;
+	BlockNumber targblocks;
+	BlockSamplerData bs;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	TransactionId OldestXmin;
+	double		liverows = 0;
+	double		deadrows = 0;
+	int			maxrows;
+	Size		maxbytes = (Size) work_mem * 1024;
+	Size		nbytes = 0;
+	ListCell   *lc;
+
+	foreach(lc, root->join_samples)
+	{
+		sample = (JoinSampleRel *) lfirst(lc);
+		if (sample->relid == relid)
+			return sample->valid ? sample : NULL;
+	}
+
+	/* the sample must survive GEQO's per-evaluation contexts */
+	oldcxt = MemoryContextSwitchTo(root->planner_cxt);
+	sample = (JoinSampleRel *) palloc0(sizeof(JoinSampleRel));
+	sample->relid = relid;
+	root->join_samples = lappend(root->join_samples, sample);
+
+	if (rte->rtekind != RTE_RELATION || rte->inh ||
+		(rte->relkind != RELKIND_RELATION && rte->relkind != RELKIND_MATVIEW) ||
+		brel->pages == 0 ||
+		pg_class_aclcheck(rte->relid, GetUserId(), ACL_SELECT) != ACLCHECK_OK ||
+		check_enable_rls(rte->relid, InvalidOid, true) == RLS_ENABLED)
+	{
+		MemoryContextSwitchTo(oldcxt);
+		return NULL;
+	}
+
+	/* read about enough blocks to collect join_sample_rows rows */
+	rel = table_open(rte->relid, NoLock);
+	nblocks = RelationGetNumberOfBlocks(rel);
+	targblocks = (BlockNumber)
+		ceil(join_sample_rows / Max(brel->tuples / brel->pages, 1.0));
+	maxrows = join_sample_rows * 2;
+
+	sample->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	sample->rows = (HeapTuple *) palloc(maxrows * sizeof(HeapTuple));
+
+	OldestXmin = GetOldestXmin(rel, PROCARRAY_FLAGS_VACUUM);
+	BlockSampler_Init(&bs, nblocks, Max(targblocks, 1), random());
+	scan = table_beginscan_analyze(rel);
+	slot = table_slot_create(rel, NULL);
+
+	while (BlockSampler_HasMore(&bs) && sample->nrows < maxrows &&
+		   nbytes < maxbytes)
+	{
+		BlockNumber targblock = BlockSampler_Next(&bs);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (!table_scan_analyze_next_block(scan, targblock, NULL))
+			continue;
+
+		while (table_scan_analyze_next_tuple(scan, OldestXmin,
+											 &liverows, &deadrows, slot))
+		{
+			if (sample->nrows < maxrows && nbytes < maxbytes)
+			{
+				HeapTuple	tuple = ExecCopySlotHeapTuple(slot);
+
+				sample->rows[sample->nrows++] = tuple;
+				nbytes += HEAPTUPLESIZE + tuple->t_len;
+			}
+		}
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+	table_close(rel, NoLock);
+
+	sample->valid = sample->nrows > 0;
+	MemoryContextSwitchTo(oldcxt);
+
+	return sample->valid ? sample : NULL;
+}
+
+/*
+ * measure_pair_selectivity
+ *		Evaluate the pair's clauses over the cross product of the samples.
+ *
+ * Without hash functions for the clauses' operators, only up to
+ * JOIN_SAMPLE_MAX_PAIRS of the pairs of sample rows are evaluated.
+ */
+static bool
+measure_pair_selectivity(PlannerInfo *root, JoinSamplePair *pair,
+						 Selectivity *selec)
+{
+	JoinSampleRel *sample1 = get_join_sample(root, pair->relid1);
+	JoinSampleRel *sample2 = get_join_sample(root, pair->relid2);
+	int			nkeys = list_length(pair->clauses);
+	PairKeys	keys;
+	FmgrInfo   *hashfuncs1;
+	FmgrInfo   *hashfuncs2;
+	bool	   *hasnull1;
+	bool	   *hasnull2;
+	bool		hashable = true;
+	double		matches = 0;
+	double		npairs;
+	int			i;
+	ListCell   *lc;
+
+	if (sample1 == NULL || sample2 == NULL)
+		return false;
+
+	keys.nkeys = nkeys;
+	keys.opfuncs = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	keys.collations = (Oid *) palloc(nkeys * sizeof(Oid));
+	keys.commuted = (bool *) palloc(nkeys * sizeof(bool));
+	hashfuncs1 = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	hashfuncs2 = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+
+	i = 0;
+	foreach(lc, pair->clauses)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst_node(RestrictInfo, lc)->clause;
+		bool		commuted = list_nth_int(pair->commuted, i);
+		RegProcedure lefthash;
+		RegProcedure righthash;
+
+		fmgr_info(get_opcode(opexpr->opno), &keys.opfuncs[i]);
+		keys.collations[i] = opexpr->inputcollid;
+		keys.commuted[i] = commuted;
+
+		if (hashable &&
+			op_hashjoinable(opexpr->opno, exprType(linitial(opexpr->args))) &&
+			get_op_hash_functions(opexpr->opno, &lefthash, &righthash))
+		{
+			fmgr_info(commuted ? righthash : lefthash, &hashfuncs1[i]);
+			fmgr_info(commuted ? lefthash : righthash, &hashfuncs2[i]);
+		}
+		else
+			hashable = false;
+		i++;
+	}
+
+	keys.values1 = (Datum *) palloc(sample1->nrows * nkeys * sizeof(Datum));
+	keys.values2 = (Datum *) palloc(sample2->nrows * nkeys * sizeof(Datum));
+	hasnull1 = (bool *) palloc(sample1->nrows * sizeof(bool));
+	hasnull2 = (bool *) palloc(sample2->nrows * sizeof(bool));
+	extract_keys(sample1, pair->vars1, keys.values1, hasnull1);
+	extract_keys(sample2, pair->vars2, keys.values2, hasnull2);
+
+	if (hashable)
+	{
+		/* chain the rows of the second sample into buckets by key hash */
+		int			nbuckets = 1;
+		int		   *heads;
+		int		   *next;
+		uint32	   *hashes2;
+
+		while (nbuckets < sample2->nrows)
+			nbuckets <<= 1;
+		heads = (int *) palloc(nbuckets * sizeof(int));
+		next = (int *) palloc(sample2->nrows * sizeof(int));
+		hashes2 = (uint32 *) palloc(sample2->nrows * sizeof(uint32));
+		for (i = 0; i < nbuckets; i++)
+			heads[i] = -1;
+
+		for (i = 0; i < sample2->nrows; i++)
+		{
+			uint32		hash = 0;
+
+			if (hasnull2[i])
+				continue;
+			for (int k = 0; k < nkeys; k++)
+			{
+				hash = (hash << 1) | (hash >> 31);
+				hash ^= DatumGetUInt32(FunctionCall1Coll(&hashfuncs2[k],
+														 keys.collations[k],
+														 keys.values2[i * nkeys + k]));
+			}
+			hashes2[i] = hash;
+			next[i] = heads[hash & (nbuckets - 1)];
+			heads[hash & (nbuckets - 1)] = i;
+		}
+
+		for (i = 0; i < sample1->nrows; i++)
+		{
+			uint32		hash = 0;
+
+			if (hasnull1[i])
+				continue;
+			CHECK_FOR_INTERRUPTS();
+			for (int k = 0; k < nkeys; k++)
+			{
+				hash = (hash << 1) | (hash >> 31);
+				hash ^= DatumGetUInt32(FunctionCall1Coll(&hashfuncs1[k],
+														 keys.collations[k],
+														 keys.values1[i * nkeys + k]));
+			}
+			for (int j = heads[hash & (nbuckets - 1)]; j >= 0; j = next[j])
+			{
+				if (hashes2[j] == hash && sample_rows_match(&keys, i, j))
+					matches += 1;
+			}
+		}
+		npairs = (double) sample1->nrows * sample2->nrows;
+	}
+	else
+	{
+		/* shrink both samples alike if there are too many pairs */
+		double		scale = 1.0;
+		int			nrows1;
+		int			nrows2;
+
+		if ((double) sample1->nrows * sample2->nrows > JOIN_SAMPLE_MAX_PAIRS)
+			scale = sqrt(JOIN_SAMPLE_MAX_PAIRS /
+						 ((double) sample1->nrows * sample2->nrows));
+		nrows1 = Max((int) (sample1->nrows * scale), 1);
+		nrows2 = Max((int) (sample2->nrows * scale), 1);
+
+		for (int i1 = 0; i1 < nrows1; i1++)
+		{
+			i = (int) ((double) i1 * sample1->nrows / nrows1);
+			if (hasnull1[i])
+				continue;
+			for (int j2 = 0; j2 < nrows2; j2++)
+			{
+				int			j = (int) ((double) j2 * sample2->nrows / nrows2);
+
+				CHECK_FOR_INTERRUPTS();
+				if (!hasnull2[j] && sample_rows_match(&keys, i, j))
+					matches += 1;
+			}
+		}
+		npairs = (double) nrows1 * nrows2;
+	}
+
+	if (matches > 0)
+		*selec = matches / npairs;
+	else
+	{
+		/*
+		 * No pair of sample rows joins.  All we know is that the selectivity
+		 * is probably below one match in the pairs we looked at.
+		 */
+		*selec = Min(clauselist_selectivity(root, pair->clauses, 0,
+											JOIN_INNER, NULL),
+					 1.0 / npairs);
+	}
+	CLAMP_PROBABILITY(*selec);
+	return true;
+}
+
+/*
+ * Deform the key columns of every sample row; hasnull[i] is set if any key
+ * of row i is null, since a strict operator cannot match it.
+ */
+static void
+extract_keys(JoinSampleRel *sample, List *vars, Datum *values, bool *hasnull)
+{
+	int			nkeys = list_length(vars);
+
+	for (int i = 0; i < sample->nrows; i++)
+	{
+		int			k = 0;
+		ListCell   *lc;
+
+		hasnull[i] = false;
+		foreach(lc, vars)
+		{
+			Var		   *var = (Var *) lfirst(lc);
+			bool		isnull;
+
+			values[i * nkeys + k] = heap_getattr(sample->rows[i], var->varattno,
+												 sample->tupdesc, &isnull);
+			if (isnull)
+				hasnull[i] = true;
+			k++;
+		}
+	}
+}
+
+/*
+ * Do rows row1 of sample 1 and row2 of sample 2 satisfy all the clauses?
+ */
+static bool
+sample_rows_match(PairKeys *keys, int row1, int row2)
+{
+	for (int k = 0; k < keys->nkeys; k++)
+	{
+		Datum		a = keys->values1[row1 * keys->nkeys + k];
+		Datum		b = keys->values2[row2 * keys->nkeys + k];
+
+		if (!DatumGetBool(FunctionCall2Coll(&keys->opfuncs[k],
+											keys->collations[k],
+											keys->commuted[k] ? b : a,
+											keys->commuted[k] ? a : b)))
+			return false;
+	}
+	return true;
+}
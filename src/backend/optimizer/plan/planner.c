@@ -64,6 +64,7 @@
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
 #include "utils/syscache.h"
+#include "lero/calibration.h"
 #include "lero/lero_extension.h"
 
 /* GUC parameters */
@@ -269,16 +270,54 @@ planner(Query *parse, const char *query_string, int cursorOptions,
 		ParamListInfo boundParams)
 {
 	PlannedStmt *result;
+	CalibratedCosts calibrated;
+	CalibratedCosts saved;
+	bool		use_calibrated;
 
-	if (planner_hook)
-		result = (*planner_hook) (parse, query_string, cursorOptions, boundParams);
-	else {
-		if (enable_lero) {
-			result = lero_pgsysml_hook_planner(parse, query_string, cursorOptions, boundParams);
-		} else{
-			result = standard_planner(parse, query_string, cursorOptions, boundParams);
+	/*
+	 * Plan with the cost constants fitted by Lero's calibration mode, if
+	 * asked to.  The configured values are restored afterwards so that they
+	 * remain what SHOW reports.
+	 */
+	use_calibrated = lero_use_calibrated_costs &&
+		lero_get_calibrated_costs(&calibrated);
+	if (use_calibrated)
+	{
+		saved.random_page_cost = random_page_cost;
+		saved.cpu_tuple_cost = cpu_tuple_cost;
+		saved.cpu_index_tuple_cost = cpu_index_tuple_cost;
+		saved.cpu_operator_cost = cpu_operator_cost;
+
+		random_page_cost = calibrated.random_page_cost;
+		cpu_tuple_cost = calibrated.cpu_tuple_cost;
+		cpu_index_tuple_cost = calibrated.cpu_index_tuple_cost;
+		cpu_operator_cost = calibrated.cpu_operator_cost;
+	}
+
+	PG_TRY();
+	{
+		if (planner_hook)
+			result = (*planner_hook) (parse, query_string, cursorOptions, boundParams);
+		else {
+			if (enable_lero) {
+				result = lero_pgsysml_hook_planner(parse, query_string, cursorOptions, boundParams);
+			} else{
+				result = standard_planner(parse, query_string, cursorOptions, boundParams);
+			}
+		}
+	}
+	PG_FINALLY();
+	{
+		if (use_calibrated)
+		{
+			random_page_cost = saved.random_page_cost;
+			cpu_tuple_cost = saved.cpu_tuple_cost;
+			cpu_index_tuple_cost = saved.cpu_index_tuple_cost;
+			cpu_operator_cost = saved.cpu_operator_cost;
 		}
 	}
+	PG_END_TRY();
+
 	return result;
 }
 
@@ -6797,6 +6836,46 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 agg_final_costs,
 									 dNumGroups));
 		}
+
+		/*
+		 * We can also finalize in parallel, below the Gather: a parallel-aware
+		 * Finalize HashAgg has each participant aggregate a disjoint share of
+		 * the groups, so the Gather merely collects the results.  Such a
+		 * path is fully aggregated, so it goes to grouped_rel's partial
+		 * pathlist, and is gathered below.
+		 */
+		if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+			partially_grouped_rel &&
+			partially_grouped_rel->partial_pathlist != NIL)
+		{
+			Path	   *path = linitial(partially_grouped_rel->partial_pathlist);
+			AggPath    *aggpath;
+			double		pages;
+
+			aggpath = create_agg_path(root,
+									  grouped_rel,
+									  path,
+									  grouped_rel->reltarget,
+									  AGG_HASHED,
+									  AGGSPLIT_FINAL_DESERIAL,
+									  parse->groupClause,
+									  havingQual,
+									  agg_final_costs,
+									  dNumGroups / get_parallel_divisor(path));
+			aggpath->path.parallel_aware = true;
+
+			/*
+			 * Every partially aggregated group is written out to a shared
+			 * partition and read back once before any result is returned.
+			 */
+			pages = ceil(path->rows *
+						 (MAXALIGN(path->pathtarget->width) +
+						  MAXALIGN(SizeofMinimalTupleHeader)) / BLCKSZ);
+			aggpath->path.startup_cost += 2 * seq_page_cost * pages;
+			aggpath->path.total_cost += 2 * seq_page_cost * pages;
+
+			add_partial_path(grouped_rel, (Path *) aggpath);
+		}
 	}
 
 	/*
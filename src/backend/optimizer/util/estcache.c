@@ -0,0 +1,236 @@
+/*-------------------------------------------------------------------------
+ *
+ * estcache.c
+ *	  Cache of plugin-supplied size estimates for one planning cycle
+ *
+ * Estimator plugins (join_size_estimate_hook, clauselist_selectivity_hook)
+ * may be expensive, e.g. when they evaluate a learned model, and the planner
+ * asks for the same estimate many times: once for every pair of input rels
+ * that can form a join relation, and again for each parameterized path.
+ * This module remembers their answers, keyed by the set of relations and the
+ * set of clauses the estimate is for.  A join size also depends on the sizes
+ * of the inputs, which are smaller than the input rels' for parameterized
+ * paths, so those are part of its key too.
+ *
+ * Clauses are identified by address.  Within one planning cycle the same
+ * RestrictInfo is shared by every list mentioning it, so the order in which
+ * a clause list was built does not matter; the addresses are sorted before
+ * being hashed.  The cache lives in the planner's memory context and hangs
+ * off the PlannerInfo, so it disappears along with the rest of the cycle.
+ *
+ * Nothing is cached while running in a shorter-lived context, as GEQO does:
+ * clauses built there are freed again and their addresses could be reused
+ * for different clauses.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/estcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "optimizer/estcache.h"
+#include "utils/hsearch.h"
+
+/* One cached estimate */
+typedef struct EstimateCacheItem
+{
+	EstimateKind kind;
+	Relids		relids;
+	int			varRelid;
+	JoinType	jointype;
+	double		outer_rows;		/* input sizes, 0 if not a join size */
+	double		inner_rows;
+	int			nclauses;
+	void	  **clauses;		/* sorted clause addresses */
+	double		value;
+} EstimateCacheItem;
+
+/* Hash table entry: all items whose key hashes to the same value */
+typedef struct EstimateCacheEntry
+{
+	uint32		hash;			/* hash key --- MUST BE FIRST */
+	List	   *items;			/* list of EstimateCacheItem */
+} EstimateCacheEntry;
+
+static void **sorted_clause_array(List *clauses);
+static int	clause_ptr_cmp(const void *a, const void *b);
+static uint32 estimate_key_hash(EstimateKind kind, Relids relids,
+								int varRelid, JoinType jointype,
+								double outer_rows, double inner_rows,
+								int nclauses, void **clauses);
+
+
+/*
+ * estimate_cache_lookup
+ *		Look for a cached estimate; returns true and sets *value if found.
+ *
+ * outer_rows and inner_rows are the input sizes of a join size estimate, and
+ * should be passed as 0 for other kinds of estimates.
+ */
+bool
+estimate_cache_lookup(PlannerInfo *root, EstimateKind kind,
+					  Relids relids, int varRelid, JoinType jointype,
+					  double outer_rows, double inner_rows,
+					  List *clauses, double *value)
+{
+	int			nclauses = list_length(clauses);
+	void	  **sorted;
+	uint32		hash;
+	EstimateCacheEntry *entry;
+	ListCell   *lc;
+	bool		found = false;
+
+	if (root == NULL || root->estimate_cache == NULL)
+		return false;
+
+	sorted = sorted_clause_array(clauses);
+	hash = estimate_key_hash(kind, relids, varRelid, jointype,
+							 outer_rows, inner_rows, nclauses, sorted);
+
+	entry = (EstimateCacheEntry *) hash_search(root->estimate_cache,
+											   &hash, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		foreach(lc, entry->items)
+		{
+			EstimateCacheItem *item = (EstimateCacheItem *) lfirst(lc);
+
+			if (item->kind == kind &&
+				item->varRelid == varRelid &&
+				item->jointype == jointype &&
+				item->outer_rows == outer_rows &&
+				item->inner_rows == inner_rows &&
+				item->nclauses == nclauses &&
+				bms_equal(item->relids, relids) &&
+				(nclauses == 0 ||
+				 memcmp(item->clauses, sorted,
+						nclauses * sizeof(void *)) == 0))
+			{
+				*value = item->value;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	if (sorted)
+		pfree(sorted);
+	return found;
+}
+
+/*
+ * estimate_cache_store
+ *		Remember an estimate supplied by a plugin.
+ *
+ * The caller is expected to have checked estimate_cache_lookup first.
+ */
+void
+estimate_cache_store(PlannerInfo *root, EstimateKind kind,
+					 Relids relids, int varRelid, JoinType jointype,
+					 double outer_rows, double inner_rows,
+					 List *clauses, double value)
+{
+	EstimateCacheItem *item;
+	EstimateCacheEntry *entry;
+	uint32		hash;
+	bool		found;
+
+	if (root == NULL || CurrentMemoryContext != root->planner_cxt)
+		return;
+
+	if (root->estimate_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(uint32);
+		ctl.entrysize = sizeof(EstimateCacheEntry);
+		ctl.hcxt = CurrentMemoryContext;
+		root->estimate_cache = hash_create("Estimate cache", 256, &ctl,
+										   HASH_ELEM | HASH_BLOBS |
+										   HASH_CONTEXT);
+	}
+
+	item = (EstimateCacheItem *) palloc(sizeof(EstimateCacheItem));
+	item->kind = kind;
+	item->relids = bms_copy(relids);
+	item->varRelid = varRelid;
+	item->jointype = jointype;
+	item->outer_rows = outer_rows;
+	item->inner_rows = inner_rows;
+	item->nclauses = list_length(clauses);
+	item->clauses = sorted_clause_array(clauses);
+	item->value = value;
+
+	hash = estimate_key_hash(kind, relids, varRelid, jointype,
+							 outer_rows, inner_rows,
+							 item->nclauses, item->clauses);
+	entry = (EstimateCacheEntry *) hash_search(root->estimate_cache,
+											   &hash, HASH_ENTER, &found);
+	if (!found)
+		entry->items = NIL;
+	entry->items = lappend(entry->items, item);
+}
+
+/*
+ * Build a sorted array of the clause addresses, or NULL for an empty list.
+ */
+static void **
+sorted_clause_array(List *clauses)
+{
+	int			nclauses = list_length(clauses);
+	void	  **result;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (nclauses == 0)
+		return NULL;
+
+	result = (void **) palloc(nclauses * sizeof(void *));
+	foreach(lc, clauses)
+		result[i++] = lfirst(lc);
+	qsort(result, nclauses, sizeof(void *), clause_ptr_cmp);
+	return result;
+}
+
+static int
+clause_ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t	pa = (uintptr_t) *(void *const *) a;
+	uintptr_t	pb = (uintptr_t) *(void *const *) b;
+
+	if (pa < pb)
+		return -1;
+	if (pa > pb)
+		return 1;
+	return 0;
+}
+
+static uint32
+estimate_key_hash(EstimateKind kind, Relids relids, int varRelid,
+				  JoinType jointype, double outer_rows, double inner_rows,
+				  int nclauses, void **clauses)
+{
+	uint32		hash;
+	double		rows[2];
+
+	hash = hash_combine(murmurhash32((uint32) kind),
+						murmurhash32((uint32) varRelid));
+	hash = hash_combine(hash, murmurhash32((uint32) jointype));
+	hash = hash_combine(hash, bms_hash_value(relids));
+	rows[0] = outer_rows;
+	rows[1] = inner_rows;
+	hash = hash_combine(hash, hash_bytes((const unsigned char *) rows,
+										 sizeof(rows)));
+	if (nclauses > 0)
+		hash = hash_combine(hash,
+							hash_bytes((const unsigned char *) clauses,
+									   nclauses * sizeof(void *)));
+	return hash;
+}
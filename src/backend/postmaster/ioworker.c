@@ -0,0 +1,484 @@
+/*-------------------------------------------------------------------------
+ *
+ * ioworker.c
+ *
+ * I/O workers read blocks into shared buffers on behalf of backends that
+ * call PrefetchBuffer.  Without them, a prefetch only hints the kernel with
+ * posix_fadvise, the block still has to be copied into shared buffers by
+ * the backend when it gets to it, and a backend never has more than one
+ * read of its own in flight.  With io_workers > 0, a prefetch request is
+ * queued in shared memory instead, and an idle worker reads the block into
+ * a shared buffer while the backend gets on with other work.  When the
+ * backend needs the page it finds it in shared buffers, or waits only for
+ * the remainder of the read already under way.  Thus up to io_workers reads
+ * can be in flight on behalf of one backend.
+ *
+ * A relation's locks are released at commit before its files are deleted
+ * and its buffers dropped, so holding a lock doesn't keep a worker from
+ * loading a block of a relation whose buffers are about to be dropped, which
+ * would leave a stale buffer behind.  Instead, whoever drops buffers first
+ * calls IoWorkerForgetRelations or IoWorkerForgetDatabase, which cancel the
+ * queued requests for those relations and wait for the workers to finish
+ * any read of them already under way.  No new requests for them can be
+ * queued by then: that takes a lock on the relation, which is gone from the
+ * catalogs, or for a truncation, one that conflicts with the truncation.
+ * Workers still lock the relation before reading a block, without waiting,
+ * so that they skip relations that are being truncated or rewritten rather
+ * than holding up those operations.  When the queue is full, PrefetchBuffer
+ * falls back to posix_fadvise.
+ *
+ * The workers are background workers registered at postmaster start, so
+ * they take slots of max_worker_processes.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/ioworker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bitutils.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/ioworker.h"
+#include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/relfilenode.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/resowner.h"
+
+/* GUC variable */
+int			io_workers = 0;
+
+/* number of requests the queue holds */
+#define IO_WORKER_QUEUE_SIZE 1024
+
+/* A block to read into shared buffers */
+typedef struct IoWorkerRequest
+{
+	LockRelId	lockrelid;		/* relation to lock while reading */
+	RelFileNode rnode;
+	char		relpersistence;
+	ForkNumber	forknum;
+	BlockNumber blocknum;		/* InvalidBlockNumber if cancelled */
+} IoWorkerRequest;
+
+/* Shared memory state */
+typedef struct IoWorkerControl
+{
+	slock_t		mutex;			/* protects all fields below */
+	uint32		running;		/* bitmap of running workers */
+	uint32		idle;			/* bitmap of workers waiting for work */
+	Latch	   *latches[MAX_IO_WORKERS];
+	uint32		busy;			/* bitmap of workers processing a request */
+	RelFileNode current[MAX_IO_WORKERS];	/* relation each busy worker reads */
+	uint32		head;			/* next request to hand out */
+	uint32		tail;			/* next free slot */
+	IoWorkerRequest queue[IO_WORKER_QUEUE_SIZE];
+
+	/* broadcast when a worker is done with a request */
+	ConditionVariable done_cv;
+} IoWorkerControl;
+
+static IoWorkerControl *IoWorkerCtl = NULL;
+
+static int	MyIoWorkerId = -1;
+
+static void IoWorkerProcess(IoWorkerRequest *req);
+static void IoWorkerDone(void);
+static void IoWorkerShutdown(int code, Datum arg);
+static void IoWorkerForget(Oid dbid, const RelFileNode *rnodes, int nnodes,
+						   bool sorted);
+static bool IoWorkerMatch(const RelFileNode *rnode, Oid dbid,
+						  const RelFileNode *rnodes, int nnodes, bool sorted);
+
+
+/*
+ * Register the I/O workers with the postmaster.  Like ApplyLauncherRegister,
+ * this must be called before InitializeMaxBackends().
+ */
+void
+IoWorkersRegister(void)
+{
+	BackgroundWorker bgw;
+
+	for (int i = 0; i < io_workers; i++)
+	{
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_ConsistentState;
+		snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "IoWorkerMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "io worker %d", i);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "io worker");
+		bgw.bgw_restart_time = 1;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(i);
+
+		RegisterBackgroundWorker(&bgw);
+	}
+}
+
+/*
+ * IoWorkerShmemSize
+ *		Compute space needed for I/O worker shared memory
+ */
+Size
+IoWorkerShmemSize(void)
+{
+	return sizeof(IoWorkerControl);
+}
+
+/*
+ * IoWorkerShmemInit
+ *		Allocate and initialize I/O worker shared memory
+ */
+void
+IoWorkerShmemInit(void)
+{
+	bool		found;
+
+	IoWorkerCtl = (IoWorkerControl *)
+		ShmemInitStruct("I/O Worker Data", IoWorkerShmemSize(), &found);
+
+	if (!found)
+	{
+		SpinLockInit(&IoWorkerCtl->mutex);
+		IoWorkerCtl->running = 0;
+		IoWorkerCtl->idle = 0;
+		IoWorkerCtl->busy = 0;
+		for (int i = 0; i < MAX_IO_WORKERS; i++)
+			IoWorkerCtl->latches[i] = NULL;
+		IoWorkerCtl->head = 0;
+		IoWorkerCtl->tail = 0;
+		ConditionVariableInit(&IoWorkerCtl->done_cv);
+	}
+}
+
+/*
+ * IoWorkerPrefetch
+ *		Ask an I/O worker to read a block of a relation into shared buffers.
+ *
+ * Returns false if that's not possible right now: there are no workers, or
+ * too many requests are queued already.
+ */
+bool
+IoWorkerPrefetch(Relation reln, ForkNumber forknum, BlockNumber blocknum)
+{
+	IoWorkerRequest *req;
+	Latch	   *latch = NULL;
+
+	Assert(!RelationUsesLocalBuffers(reln));
+
+	if (io_workers == 0)
+		return false;
+
+	SpinLockAcquire(&IoWorkerCtl->mutex);
+
+	if (IoWorkerCtl->running == 0 ||
+		IoWorkerCtl->tail - IoWorkerCtl->head >= IO_WORKER_QUEUE_SIZE)
+	{
+		SpinLockRelease(&IoWorkerCtl->mutex);
+		return false;
+	}
+
+	req = &IoWorkerCtl->queue[IoWorkerCtl->tail % IO_WORKER_QUEUE_SIZE];
+	req->lockrelid = reln->rd_lockInfo.lockRelId;
+	req->rnode = reln->rd_node;
+	req->relpersistence = reln->rd_rel->relpersistence;
+	req->forknum = forknum;
+	req->blocknum = blocknum;
+	IoWorkerCtl->tail++;
+
+	/* wake up an idle worker, if there is one */
+	if (IoWorkerCtl->idle != 0)
+	{
+		int			i = pg_rightmost_one_pos32(IoWorkerCtl->idle);
+
+		IoWorkerCtl->idle &= ~((uint32) 1 << i);
+		latch = IoWorkerCtl->latches[i];
+	}
+
+	SpinLockRelease(&IoWorkerCtl->mutex);
+
+	if (latch)
+		SetLatch(latch);
+
+	return true;
+}
+
+/*
+ * Main entry point for I/O worker processes
+ */
+void
+IoWorkerMain(Datum main_arg)
+{
+	sigjmp_buf	local_sigjmp_buf;
+	MemoryContext ioworker_context;
+
+	MyIoWorkerId = DatumGetInt32(main_arg);
+	Assert(MyIoWorkerId >= 0 && MyIoWorkerId < MAX_IO_WORKERS);
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+
+	CreateAuxProcessResourceOwner();
+
+	ioworker_context = AllocSetContextCreate(TopMemoryContext,
+											 "I/O Worker",
+											 ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(ioworker_context);
+
+	/*
+	 * If an exception is encountered, processing resumes here: the request
+	 * that failed is forgotten.  See notes in postgres.c about the design of
+	 * this coding.
+	 */
+	if (sigsetjmp(local_sigjmp_buf, 1) != 0)
+	{
+		/* Since not using PG_TRY, must reset error stack by hand */
+		error_context_stack = NULL;
+
+		/* Prevent interrupts while cleaning up */
+		HOLD_INTERRUPTS();
+
+		/* Report the error to the server log */
+		EmitErrorReport();
+
+		/* see BackgroundWriterMain */
+		LWLockReleaseAll();
+		ConditionVariableCancelSleep();
+		pgstat_report_wait_end();
+		AbortBufferIO();
+		UnlockBuffers();
+		LockReleaseAll(DEFAULT_LOCKMETHOD, true);
+		IoWorkerDone();
+		ReleaseAuxProcessResources(false);
+		AtEOXact_Buffers(false);
+		AtEOXact_SMgr();
+		AtEOXact_Files(false);
+		AtEOXact_HashTables(false);
+
+		MemoryContextSwitchTo(ioworker_context);
+		FlushErrorState();
+		MemoryContextResetAndDeleteChildren(ioworker_context);
+
+		RESUME_INTERRUPTS();
+
+		smgrcloseall();
+	}
+
+	/* We can now handle ereport(ERROR) */
+	PG_exception_stack = &local_sigjmp_buf;
+
+	if (IoWorkerCtl->latches[MyIoWorkerId] == NULL)
+	{
+		before_shmem_exit(IoWorkerShutdown, (Datum) 0);
+
+		SpinLockAcquire(&IoWorkerCtl->mutex);
+		IoWorkerCtl->latches[MyIoWorkerId] = MyLatch;
+		IoWorkerCtl->running |= (uint32) 1 << MyIoWorkerId;
+		SpinLockRelease(&IoWorkerCtl->mutex);
+	}
+
+	BackgroundWorkerUnblockSignals();
+
+	for (;;)
+	{
+		IoWorkerRequest req;
+		bool		found = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		SpinLockAcquire(&IoWorkerCtl->mutex);
+		while (IoWorkerCtl->head != IoWorkerCtl->tail)
+		{
+			req = IoWorkerCtl->queue[IoWorkerCtl->head % IO_WORKER_QUEUE_SIZE];
+			IoWorkerCtl->head++;
+			if (req.blocknum != InvalidBlockNumber)
+			{
+				IoWorkerCtl->busy |= (uint32) 1 << MyIoWorkerId;
+				IoWorkerCtl->current[MyIoWorkerId] = req.rnode;
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			IoWorkerCtl->idle |= (uint32) 1 << MyIoWorkerId;
+		SpinLockRelease(&IoWorkerCtl->mutex);
+
+		if (found)
+		{
+			IoWorkerProcess(&req);
+			IoWorkerDone();
+			continue;
+		}
+
+		/*
+		 * Close our files before going to sleep, so that we don't keep files
+		 * of dropped relations around.
+		 */
+		smgrcloseall();
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_IO_WORKER_MAIN);
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Read the block of one request into shared buffers.
+ */
+static void
+IoWorkerProcess(IoWorkerRequest *req)
+{
+	LOCKTAG		tag;
+
+	/*
+	 * Don't wait for a conflicting lock: whoever holds it may be about to
+	 * drop the relation's buffers, and then we mustn't load any.
+	 */
+	SET_LOCKTAG_RELATION(tag, req->lockrelid.dbId, req->lockrelid.relId);
+	if (LockAcquire(&tag, AccessShareLock, true, true) == LOCKACQUIRE_NOT_AVAIL)
+		return;
+
+	LoadSharedBuffer(req->rnode, req->relpersistence, req->forknum,
+					 req->blocknum);
+
+	LockRelease(&tag, AccessShareLock, true);
+}
+
+/*
+ * Let those waiting in IoWorkerForget know that we're done with our request.
+ */
+static void
+IoWorkerDone(void)
+{
+	uint32		mask = (uint32) 1 << MyIoWorkerId;
+	bool		was_busy;
+
+	SpinLockAcquire(&IoWorkerCtl->mutex);
+	was_busy = (IoWorkerCtl->busy & mask) != 0;
+	IoWorkerCtl->busy &= ~mask;
+	SpinLockRelease(&IoWorkerCtl->mutex);
+
+	if (was_busy)
+		ConditionVariableBroadcast(&IoWorkerCtl->done_cv);
+}
+
+/*
+ * IoWorkerForgetRelations
+ *		Make sure no I/O worker loads blocks of the given relations anymore.
+ *
+ * Requests still queued for them are cancelled, and we wait for reads of
+ * them that are under way.  This is called before their buffers are dropped,
+ * so that none can be loaded again afterwards.  If sorted is true, rnodes is
+ * sorted with rnode_comparator.
+ */
+void
+IoWorkerForgetRelations(const RelFileNode *rnodes, int nnodes, bool sorted)
+{
+	IoWorkerForget(InvalidOid, rnodes, nnodes, sorted);
+}
+
+/*
+ * IoWorkerForgetDatabase
+ *		Like IoWorkerForgetRelations, for all relations of a database.
+ */
+void
+IoWorkerForgetDatabase(Oid dbid)
+{
+	IoWorkerForget(dbid, NULL, 0, false);
+}
+
+static void
+IoWorkerForget(Oid dbid, const RelFileNode *rnodes, int nnodes, bool sorted)
+{
+	if (io_workers == 0)
+		return;
+
+	for (;;)
+	{
+		bool		wait = false;
+
+		SpinLockAcquire(&IoWorkerCtl->mutex);
+
+		for (uint32 i = IoWorkerCtl->head; i != IoWorkerCtl->tail; i++)
+		{
+			IoWorkerRequest *req = &IoWorkerCtl->queue[i % IO_WORKER_QUEUE_SIZE];
+
+			if (req->blocknum != InvalidBlockNumber &&
+				IoWorkerMatch(&req->rnode, dbid, rnodes, nnodes, sorted))
+				req->blocknum = InvalidBlockNumber;
+		}
+
+		for (int i = 0; i < MAX_IO_WORKERS; i++)
+		{
+			if ((IoWorkerCtl->busy & ((uint32) 1 << i)) != 0 &&
+				IoWorkerMatch(&IoWorkerCtl->current[i], dbid, rnodes, nnodes,
+							  sorted))
+				wait = true;
+		}
+
+		SpinLockRelease(&IoWorkerCtl->mutex);
+
+		if (!wait)
+			break;
+		ConditionVariableSleep(&IoWorkerCtl->done_cv,
+							   WAIT_EVENT_IO_WORKER_FORGET);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Does a relation belong to database dbid, if that's valid, or else is it
+ * one of rnodes?
+ */
+static bool
+IoWorkerMatch(const RelFileNode *rnode, Oid dbid,
+			  const RelFileNode *rnodes, int nnodes, bool sorted)
+{
+	if (OidIsValid(dbid))
+		return rnode->dbNode == dbid;
+
+	if (sorted)
+		return bsearch(rnode, rnodes, nnodes, sizeof(RelFileNode),
+					   rnode_comparator) != NULL;
+
+	for (int i = 0; i < nnodes; i++)
+	{
+		if (RelFileNodeEquals(*rnode, rnodes[i]))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Stop getting requests, when the worker exits.
+ */
+static void
+IoWorkerShutdown(int code, Datum arg)
+{
+	SpinLockAcquire(&IoWorkerCtl->mutex);
+	IoWorkerCtl->running &= ~((uint32) 1 << MyIoWorkerId);
+	IoWorkerCtl->idle &= ~((uint32) 1 << MyIoWorkerId);
+	IoWorkerCtl->latches[MyIoWorkerId] = NULL;
+	SpinLockRelease(&IoWorkerCtl->mutex);
+
+	IoWorkerDone();
+}
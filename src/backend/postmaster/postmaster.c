@@ -113,6 +113,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/interrupt.h"
+#include "postmaster/ioworker.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
@@ -992,6 +993,9 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the I/O workers */
+	IoWorkersRegister();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -14,6 +14,11 @@
  */
 #include "postgres.h"
 
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
@@ -23,6 +28,28 @@ LWLockMinimallyPadded *BufferIOLWLockArray = NULL;
 WritebackContext BackendWritebackContext;
 CkptSortItem *CkptBufferIds;
 
+/* GUC variable */
+bool		numa_interleave_buffers = false;
+
+/*
+ * Spreading the buffer pool over NUMA nodes is done with the mbind() system
+ * call, over the nodes that get_mempolicy() says we may use.  We call them
+ * directly rather than through libnuma, whose only job here would be to
+ * spell the constants below.  The range passed must be aligned to the page
+ * size actually backing it, so we align to 2MB, the common huge page size,
+ * which also covers regular pages.
+ */
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+#define USE_NUMA_INTERLEAVE 1
+#define PG_MPOL_INTERLEAVE	3
+#define PG_MPOL_F_MEMS_ALLOWED	(1 << 2)
+#define NUMA_MAX_NODES		1024
+#define NUMA_MASK_BITS		(8 * sizeof(unsigned long))
+#define NUMA_ALIGN_SIZE		(2 * 1024 * 1024)
+#endif
+
+static void InterleaveBufferMemory(const char *name, void *ptr, Size size);
+
 
 /*
  * Data Structures:
@@ -87,6 +114,21 @@ InitBufferPool(void)
 						NBuffers * (Size) sizeof(LWLockMinimallyPadded),
 						&foundIOLocks);
 
+	/*
+	 * If asked to, spread the descriptors and pages over all NUMA nodes
+	 * before they are first touched, so that the pool is not allocated from
+	 * whichever node the postmaster happens to run on.  Each backend then
+	 * sees the same average memory latency, and no single node's memory
+	 * bandwidth becomes the bottleneck for the whole pool.
+	 */
+	if (numa_interleave_buffers && !foundDescs)
+	{
+		InterleaveBufferMemory("buffer descriptors", BufferDescriptors,
+							   NBuffers * sizeof(BufferDescPadded));
+		InterleaveBufferMemory("buffer blocks", BufferBlocks,
+							   NBuffers * (Size) BLCKSZ);
+	}
+
 	/*
 	 * The array used to sort to-be-checkpointed buffer ids is located in
 	 * shared memory, to avoid having to allocate significant amounts of
@@ -147,6 +189,70 @@ InitBufferPool(void)
 						 &backend_flush_after);
 }
 
+/*
+ * Set the NUMA policy of a shared memory range to interleave its pages over
+ * all nodes we are allowed to allocate from.  Failure is not fatal: the pool
+ * works just as well, only with the kernel's default placement.
+ */
+static void
+InterleaveBufferMemory(const char *name, void *ptr, Size size)
+{
+#ifdef USE_NUMA_INTERLEAVE
+	unsigned long nodemask[NUMA_MAX_NODES / NUMA_MASK_BITS];
+	unsigned long maxnode;
+	int			nnodes = 0;
+	int			lastnode = -1;
+	uintptr_t	start = TYPEALIGN(NUMA_ALIGN_SIZE, (uintptr_t) ptr);
+	uintptr_t	end = TYPEALIGN_DOWN(NUMA_ALIGN_SIZE, (uintptr_t) ptr + size);
+
+	if (end <= start)
+		return;
+
+	/*
+	 * Fetch the nodes of our cpuset.  The kernel rejects a mask with fewer
+	 * bits than it has possible nodes, so start small and grow the mask.
+	 */
+	for (maxnode = NUMA_MASK_BITS;; maxnode *= 2)
+	{
+		memset(nodemask, 0, sizeof(nodemask));
+		if (syscall(SYS_get_mempolicy, NULL, nodemask, maxnode, NULL,
+					PG_MPOL_F_MEMS_ALLOWED) == 0)
+			break;
+		if (errno != EINVAL || maxnode >= NUMA_MAX_NODES)
+		{
+			ereport(LOG,
+					(errmsg("could not determine the NUMA nodes for %s: %m",
+							name)));
+			return;
+		}
+	}
+
+	for (int node = 0; node < maxnode; node++)
+	{
+		if (nodemask[node / NUMA_MASK_BITS] & (1UL << (node % NUMA_MASK_BITS)))
+		{
+			nnodes++;
+			lastnode = node;
+		}
+	}
+
+	/* nothing to spread over */
+	if (nnodes < 2)
+		return;
+
+	/*
+	 * mbind() reads one bit less than maxnode says, a quirk every caller has
+	 * to make up for.
+	 */
+	if (syscall(SYS_mbind, (void *) start, (unsigned long) (end - start),
+				PG_MPOL_INTERLEAVE, nodemask,
+				(unsigned long) lastnode + 2, 0) != 0)
+		ereport(LOG,
+				(errmsg("could not interleave %s across NUMA nodes: %m",
+						name)));
+#endif
+}
+
 /*
  * BufferShmemSize
  *
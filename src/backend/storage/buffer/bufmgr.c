@@ -43,12 +43,14 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/ioworker.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -140,6 +142,12 @@ int			effective_io_concurrency = 0;
  */
 int			maintenance_io_concurrency = 0;
 
+/*
+ * Maximum number of consecutive blocks ReadBufferRange reads with a single
+ * system call.
+ */
+int			io_combine_limit = 16;
+
 /*
  * GUC variables about triggering kernel writeback for buffers written; OS
  * dependent defaults are set via the GUC mechanism.
@@ -148,9 +156,19 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * ReadBufferRange starts I/O on up to MAX_IO_COMBINE_LIMIT buffers before
+ * reading them all, and allocating a buffer in the meantime may need to write
+ * out one more victim buffer.  SyncBufferRun starts I/O on as many buffers
+ * before writing them.
+ */
+#define MAX_IN_PROGRESS_BUFS (MAX_IO_COMBINE_LIMIT + 1)
+
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_BUFS];
+static bool IsForInput[MAX_IN_PROGRESS_BUFS];
+static int	NumInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -452,6 +470,12 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 								ForkNumber forkNum, BlockNumber blockNum,
 								ReadBufferMode mode, BufferAccessStrategy strategy,
 								bool *hit);
+static void ReadBufferRun(SMgrRelation smgr, ForkNumber forkNum,
+						  BlockNumber blockNum, BufferDesc **bufs, int nbufs);
+static PrefetchBufferResult PrefetchSharedBufferInternal(SMgrRelation smgr_reln,
+														 Relation reln,
+														 ForkNumber forkNum,
+														 BlockNumber blockNum);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
@@ -459,8 +483,11 @@ static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
+static int	SyncBufferRun(CkptSortItem *items, int nitems,
+						  WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
 static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool ConditionalStartBufferIO(BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
@@ -474,7 +501,6 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
-static int	rnode_comparator(const void *p1, const void *p2);
 static int	buffertag_comparator(const void *p1, const void *p2);
 static int	ckpt_buforder_comparator(const void *pa, const void *pb);
 static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
@@ -487,6 +513,19 @@ PrefetchBufferResult
 PrefetchSharedBuffer(SMgrRelation smgr_reln,
 					 ForkNumber forkNum,
 					 BlockNumber blockNum)
+{
+	return PrefetchSharedBufferInternal(smgr_reln, NULL, forkNum, blockNum);
+}
+
+/*
+ * Guts of PrefetchSharedBuffer().  If the caller has a relcache entry, reln
+ * is it, else NULL; only in the former case can an I/O worker do the read.
+ */
+static PrefetchBufferResult
+PrefetchSharedBufferInternal(SMgrRelation smgr_reln,
+							 Relation reln,
+							 ForkNumber forkNum,
+							 BlockNumber blockNum)
 {
 	PrefetchBufferResult result = {InvalidBuffer, false};
 	BufferTag	newTag;			/* identity of requested block */
@@ -512,12 +551,16 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 	/* If not in buffers, initiate prefetch */
 	if (buf_id < 0)
 	{
-#ifdef USE_PREFETCH
 		/*
-		 * Try to initiate an asynchronous read.  This returns false in
-		 * recovery if the relation file doesn't exist.
+		 * Preferably have an I/O worker read the block into shared buffers;
+		 * else, try to initiate an asynchronous read by the kernel.  The
+		 * latter returns false in recovery if the relation file doesn't
+		 * exist.
 		 */
-		if (smgrprefetch(smgr_reln, forkNum, blockNum))
+		if (reln != NULL && IoWorkerPrefetch(reln, forkNum, blockNum))
+			result.initiated_io = true;
+#ifdef USE_PREFETCH
+		else if (smgrprefetch(smgr_reln, forkNum, blockNum))
 			result.initiated_io = true;
 #endif							/* USE_PREFETCH */
 	}
@@ -559,10 +602,11 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
  * could be used by the caller to avoid the need for a later buffer lookup, but
  * it's not pinned, so the caller must recheck it.
  *
- * 2.  If the kernel has been asked to initiate I/O, the initated_io member is
- * true.  Currently there is no way to know if the data was already cached by
- * the kernel and therefore didn't really initiate I/O, and no way to know when
- * the I/O completes other than using synchronous ReadBuffer().
+ * 2.  If an I/O worker or the kernel has been asked to initiate I/O, the
+ * initated_io member is true.  Currently there is no way to know if the data
+ * was already cached by the kernel and therefore didn't really initiate I/O,
+ * and no way to know when the I/O completes other than using synchronous
+ * ReadBuffer().
  *
  * 3.  Otherwise, the buffer wasn't already cached by PostgreSQL, and either
  * USE_PREFETCH is not defined (this build doesn't support prefetching due to
@@ -593,7 +637,8 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	else
 	{
 		/* pass it to the shared buffer version */
-		return PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
+		return PrefetchSharedBufferInternal(reln->rd_smgr, reln, forkNum,
+											blockNum);
 	}
 }
 
@@ -706,6 +751,210 @@ ReadBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
 							 mode, strategy, &hit);
 }
 
+/*
+ * ReadBufferRange -- read a range of consecutive blocks of a relation
+ *
+ * Like ReadBufferExtended in RBM_NORMAL mode for blocks blockNum up to
+ * blockNum + nblocks - 1, returning the pinned buffers in buffers[].  Runs
+ * of blocks that are not in shared buffers yet are read with a single
+ * smgrreadv call each, of up to io_combine_limit blocks.
+ *
+ * Fewer blocks than requested may be read, so as not to pin too large a
+ * share of shared buffers, or of the strategy's ring of buffers; the number
+ * read (at least one) is returned.  A buffer of the ring that is still
+ * pinned can't be reused, so if the blocks read ahead took up much of the
+ * ring, it would have to grow by taking buffers from the rest of the pool,
+ * defeating its purpose.
+ *
+ * We hold I/O in progress on all buffers of a run while allocating the
+ * next, which may have to wait for another backend's I/O on it.  That can't
+ * deadlock as long as every backend reading more than one block goes through
+ * here, because they all acquire their buffers in ascending block order.
+ */
+int
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr;
+	BufferDesc *run[MAX_IO_COMBINE_LIMIT];
+	int			nrun = 0;
+	int			maxpins;
+
+	Assert(nblocks > 0);
+
+	/* local buffers are cheap to read one at a time */
+	if (RelationUsesLocalBuffers(reln) || io_combine_limit <= 1)
+	{
+		buffers[0] = ReadBufferExtended(reln, forkNum, blockNum, RBM_NORMAL,
+										strategy);
+		return 1;
+	}
+
+	RelationOpenSmgr(reln);
+	smgr = reln->rd_smgr;
+
+	/* leave every backend its fair share of pins */
+	maxpins = Max(NBuffers / (MaxBackends + NUM_AUXILIARY_PROCS), 1);
+
+	/* and keep most of the strategy's ring free for reuse */
+	if (strategy != NULL)
+		maxpins = Min(maxpins,
+					  Max(GetAccessStrategyRingSize(strategy) / 4, 1));
+	nblocks = Min(nblocks, maxpins);
+
+	for (int i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		TRACE_POSTGRESQL_BUFFER_READ_START(forkNum, blockNum + i,
+										   smgr->smgr_rnode.node.spcNode,
+										   smgr->smgr_rnode.node.dbNode,
+										   smgr->smgr_rnode.node.relNode,
+										   smgr->smgr_rnode.backend,
+										   false);
+
+		/* IO_IN_PROGRESS is set if the block is not in memory yet */
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+							 blockNum + i, strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (found)
+		{
+			/* a hit ends the current run of misses */
+			if (nrun > 0)
+				ReadBufferRun(smgr, forkNum, blockNum + i - nrun, run, nrun);
+			nrun = 0;
+
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+
+			TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+											  smgr->smgr_rnode.node.spcNode,
+											  smgr->smgr_rnode.node.dbNode,
+											  smgr->smgr_rnode.node.relNode,
+											  smgr->smgr_rnode.backend,
+											  false,
+											  true);
+			continue;
+		}
+
+		pgBufferUsage.shared_blks_read++;
+		run[nrun++] = bufHdr;
+		if (nrun == io_combine_limit)
+		{
+			ReadBufferRun(smgr, forkNum, blockNum + i + 1 - nrun, run, nrun);
+			nrun = 0;
+		}
+	}
+
+	if (nrun > 0)
+		ReadBufferRun(smgr, forkNum, blockNum + nblocks - nrun, run, nrun);
+
+	return nblocks;
+}
+
+/*
+ * LoadSharedBuffer -- make sure a block is in shared buffers
+ *
+ * Reads the block into shared buffers unless it's there already, without
+ * keeping it pinned.  This is for I/O workers, which have no relcache entry;
+ * a block that no longer exists is silently ignored.  Whoever drops the
+ * relation's buffers waits for the worker first, see IoWorkerForgetRelations.
+ */
+void
+LoadSharedBuffer(RelFileNode rnode, char relpersistence, ForkNumber forkNum,
+				 BlockNumber blockNum)
+{
+	SMgrRelation smgr = smgropen(rnode, InvalidBackendId);
+	bool		hit;
+
+	Assert(relpersistence != RELPERSISTENCE_TEMP);
+
+	if (!smgrexists(smgr, forkNum) || blockNum >= smgrnblocks(smgr, forkNum))
+		return;
+
+	ReleaseBuffer(ReadBuffer_common(smgr, relpersistence, forkNum, blockNum,
+									RBM_NORMAL, NULL, &hit));
+}
+
+/*
+ * ReadBufferRun -- read a run of consecutive blocks for ReadBufferRange
+ *
+ * bufs[] are the buffers for blocks blockNum up to blockNum + nbufs - 1, all
+ * pinned with I/O in progress.  On return they are all valid.
+ */
+static void
+ReadBufferRun(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
+			  BufferDesc **bufs, int nbufs)
+{
+	char	   *blocks[MAX_IO_COMBINE_LIMIT];
+	instr_time	io_start,
+				io_time;
+
+	for (int i = 0; i < nbufs; i++)
+		blocks[i] = (char *) BufHdrGetBlock(bufs[i]);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrreadv(smgr, forkNum, blockNum, blocks, nbufs);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+	}
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		/* check for garbage data */
+		if (!PageIsVerifiedExtended((Page) blocks[i], blockNum + i,
+									PIV_LOG_WARNING | PIV_REPORT_STAT))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(blocks[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(bufs[i], false, BM_VALID);
+
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+
+		TRACE_POSTGRESQL_BUFFER_READ_DONE(forkNum, blockNum + i,
+										  smgr->smgr_rnode.node.spcNode,
+										  smgr->smgr_rnode.node.dbNode,
+										  smgr->smgr_rnode.node.relNode,
+										  smgr->smgr_rnode.backend,
+										  false,
+										  false);
+	}
+}
+
 
 /*
  * ReadBuffer_common -- common logic for all ReadBuffer variants
@@ -1987,14 +2236,14 @@ BufferSync(int flags)
 		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
+		CkptSortItem *item = &CkptBufferIds[ts_stat->index];
+		int			nitems = 1;
 
-		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		buf_id = item->buf_id;
 		Assert(buf_id != -1);
 
 		bufHdr = GetBufferDescriptor(buf_id);
 
-		num_processed++;
-
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
 		 * at a single bit. It's possible that someone else writes the buffer
@@ -2009,21 +2258,58 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			int			maxitems;
+
+			/*
+			 * Buffers for the blocks that follow in the same fork are written
+			 * along with this one, with a single vectored write.  The same
+			 * unlocked check is good enough here; SyncBufferRun looks again
+			 * under the header lock, and stops at the first buffer that
+			 * doesn't hold the expected block anymore.
+			 */
+			maxitems = Min(io_combine_limit,
+						   ts_stat->num_to_scan - ts_stat->num_scanned);
+			while (nitems < maxitems &&
+				   item[nitems].relNode == item->relNode &&
+				   item[nitems].forkNum == item->forkNum &&
+				   item[nitems].blockNum == item->blockNum + nitems &&
+				   (pg_atomic_read_u32(&GetBufferDescriptor(item[nitems].buf_id)->state) &
+					BM_CHECKPOINT_NEEDED))
+				nitems++;
+
+			if (nitems == 1)
+			{
+				if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+				{
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
+					BgWriterStats.m_buf_written_checkpoints++;
+					num_written++;
+				}
+			}
+			else
 			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				BgWriterStats.m_buf_written_checkpoints++;
-				num_written++;
+				int			nwritten;
+
+				nwritten = SyncBufferRun(item, nitems, &wb_context);
+				for (i = 0; i < nwritten; i++)
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(item[i].buf_id);
+				BgWriterStats.m_buf_written_checkpoints += nwritten;
+				num_written += nwritten;
+
+				/* the rest of the run is looked at again next time around */
+				nitems = Max(nwritten, 1);
 			}
 		}
 
+		num_processed += nitems;
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * nitems;
+		ts_stat->num_scanned += nitems;
+		ts_stat->index += nitems;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2434,6 +2720,193 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * SyncBufferRun -- write out buffers for consecutive blocks for BufferSync
+ *
+ * items[] are the sort items for nitems consecutive blocks of one relation
+ * fork.  Each buffer that is still dirty and holds the expected block joins
+ * the run, up to the first one that doesn't; then they are all written with
+ * one smgrwritev call, and their writeback is scheduled in wb_context.
+ *
+ * Returns the number of buffers written, which are those of the first that
+ * many items.
+ *
+ * We hold I/O in progress on the earlier buffers of the run while adding the
+ * next, so we mustn't wait for its content lock or for I/O on it: anyone
+ * holding that lock exclusively, or doing that I/O, might be waiting for one
+ * of ours.  So the later buffers are locked and marked I/O busy only
+ * conditionally, and a buffer whose content lock or io_in_progress lock
+ * isn't free ends the run.
+ */
+static int
+SyncBufferRun(CkptSortItem *items, int nitems, WritebackContext *wb_context)
+{
+	static char *pageCopies = NULL;
+	BufferDesc *bufs[MAX_IO_COMBINE_LIMIT];
+	char	   *blocks[MAX_IO_COMBINE_LIMIT];
+	BufferTag	tag;
+	SMgrRelation reln;
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+	bool		permanent = false;
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+	int			nbufs;
+
+	Assert(nitems <= MAX_IO_COMBINE_LIMIT);
+
+	for (nbufs = 0; nbufs < nitems; nbufs++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(items[nbufs].buf_id);
+		uint32		buf_state;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		/* see SyncOneBuffer about checking this without the content lock */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+
+		if (nbufs == 0)
+			tag = bufHdr->tag;
+		else if ((buf_state & BM_IO_IN_PROGRESS) ||
+				 !RelFileNodeEquals(bufHdr->tag.rnode, tag.rnode) ||
+				 bufHdr->tag.forkNum != tag.forkNum ||
+				 bufHdr->tag.blockNum != tag.blockNum + nbufs)
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		if (nbufs == 0)
+			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+		else if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+										   LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		/* someone else may have flushed it before we could */
+		if (nbufs == 0 ? !StartBufferIO(bufHdr, false) :
+			!ConditionalStartBufferIO(bufHdr, false))
+		{
+			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		bufs[nbufs] = bufHdr;
+	}
+
+	if (nbufs == 0)
+		return 0;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) bufs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(tag.rnode, InvalidBackendId);
+
+	/* as in FlushBuffer, but the WAL is flushed once for the whole run */
+	for (int i = 0; i < nbufs; i++)
+	{
+		uint32		buf_state;
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(tag.forkNum,
+											tag.blockNum + i,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode);
+
+		buf_state = LockBufHdr(bufs[i]);
+		if (buf_state & BM_PERMANENT)
+		{
+			permanent = true;
+			recptr = Max(recptr, BufferGetLSN(bufs[i]));
+		}
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(bufs[i], buf_state);
+	}
+
+	if (permanent)
+		XLogFlush(recptr);
+
+	/*
+	 * Checksummed pages are copied to private storage, as in FlushBuffer, but
+	 * PageSetChecksumCopy has room for only one page.
+	 */
+	if (pageCopies == NULL)
+		pageCopies = MemoryContextAlloc(TopMemoryContext,
+										MAX_IO_COMBINE_LIMIT * BLCKSZ);
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		blocks[i] = (char *) BufHdrGetBlock(bufs[i]);
+
+		if (DataChecksumsEnabled() && !PageIsNew((Page) blocks[i]))
+		{
+			char	   *copy = pageCopies + i * BLCKSZ;
+
+			memcpy(copy, blocks[i], BLCKSZ);
+			PageSetChecksumInplace((Page) copy, tag.blockNum + i);
+			blocks[i] = copy;
+		}
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrwritev(reln, tag.forkNum, tag.blockNum, blocks, nbufs, false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += nbufs;
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		TerminateBufferIO(bufs[i], true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(tag.forkNum,
+										   tag.blockNum + i,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferTag	buftag = tag;
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufs[i]));
+		UnpinBuffer(bufs[i], true);
+
+		buftag.blockNum = tag.blockNum + i;
+		ScheduleBufferTagForWriteback(wb_context, &buftag);
+	}
+
+	return nbufs;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2964,6 +3437,9 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber *forkNum,
 		return;
 	}
 
+	/* make sure no I/O worker loads blocks of the relation behind our back */
+	IoWorkerForgetRelations(&rnode.node, 1, false);
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -3061,6 +3537,9 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	if (use_bsearch)
 		pg_qsort(nodes, n, sizeof(RelFileNode), rnode_comparator);
 
+	/* make sure no I/O worker loads blocks of the relations behind our back */
+	IoWorkerForgetRelations(nodes, n, use_bsearch);
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		RelFileNode *rnode = NULL;
@@ -3127,6 +3606,9 @@ DropDatabaseBuffers(Oid dbid)
 	 * database isn't our own.
 	 */
 
+	/* make sure no I/O worker loads blocks of the database behind our back */
+	IoWorkerForgetDatabase(dbid);
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -4056,7 +4538,7 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing no IO on this buffer
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
@@ -4076,7 +4558,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_BUFS);
 
 	for (;;)
 	{
@@ -4115,8 +4597,46 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	IsForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
+
+	return true;
+}
+
+/*
+ * ConditionalStartBufferIO: begin I/O on this buffer, if that needs no wait
+ *
+ * Like StartBufferIO, but returns false rather than waiting if someone else
+ * holds the io_in_progress lock, or has I/O in progress on the buffer.  It
+ * also returns false if the work is already done.
+ */
+static bool
+ConditionalStartBufferIO(BufferDesc *buf, bool forInput)
+{
+	uint32		buf_state;
+
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_BUFS);
+
+	if (!LWLockConditionalAcquire(BufferDescriptorGetIOLock(buf), LW_EXCLUSIVE))
+		return false;
+
+	buf_state = LockBufHdr(buf);
+
+	if ((buf_state & BM_IO_IN_PROGRESS) ||
+		(forInput ? (buf_state & BM_VALID) : !(buf_state & BM_DIRTY)))
+	{
+		UnlockBufHdr(buf, buf_state);
+		LWLockRelease(BufferDescriptorGetIOLock(buf));
+		return false;
+	}
+
+	buf_state |= BM_IO_IN_PROGRESS;
+	UnlockBufHdr(buf, buf_state);
+
+	InProgressBufs[NumInProgressBufs] = buf;
+	IsForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -4142,8 +4662,14 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	buf_state = LockBufHdr(buf);
 
@@ -4156,7 +4682,13 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	/* forget it, keeping the remaining entries in order */
+	NumInProgressBufs--;
+	for (; i < NumInProgressBufs; i++)
+	{
+		InProgressBufs[i] = InProgressBufs[i + 1];
+		IsForInput[i] = IsForInput[i + 1];
+	}
 
 	LWLockRelease(BufferDescriptorGetIOLock(buf));
 }
@@ -4173,10 +4705,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		/*
@@ -4189,7 +4720,7 @@ AbortBufferIO(void)
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (IsForInput[NumInProgressBufs - 1])
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -4261,7 +4792,7 @@ local_buffer_write_error_callback(void *arg)
 /*
  * RelFileNode qsort/bsearch comparator; see RelFileNodeEquals.
  */
-static int
+int
 rnode_comparator(const void *p1, const void *p2)
 {
 	RelFileNode n1 = *(const RelFileNode *) p1;
@@ -22,6 +22,12 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * Maximum number of clock sweep positions a backend claims at once; see
+ * ClockSweepTick().
+ */
+#define CLOCK_SWEEP_BATCH	16
+
 
 /*
  * The shared freelist control information.
@@ -63,6 +69,13 @@ typedef struct
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * The clock sweep positions this backend has claimed but not yet visited:
+ * sweepBatchLeft buffers starting at sweepBatchNext.
+ */
+static uint32 sweepBatchNext = 0;
+static uint32 sweepBatchLeft = 0;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -104,67 +117,96 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
 
 /*
- * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ * ClockSweepClaimBatch - Helper routine for ClockSweepTick()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Atomically move the clock hand ahead by a batch of buffers, and remember
+ * the buffers passed over as ours to visit.  With many backends allocating
+ * buffers at once, moving the hand one buffer at a time makes its cache line
+ * bounce between all of them; claiming a batch of adjacent buffers divides
+ * that traffic by the batch size, and the descriptors we then visit are
+ * adjacent in memory too.  If several processes do this, buffers can be
+ * visited somewhat out of apparent order, but each position is still visited
+ * once per pass of the hand.
  */
-static inline uint32
-ClockSweepTick(void)
+static void
+ClockSweepClaimBatch(void)
 {
-	uint32		victim;
+	uint32		batch;
+	uint32		start;
+	uint32		end;
+	uint32		firstwrap;
+
+	/* keep batches small relative to the buffer pool */
+	batch = Max(Min(CLOCK_SWEEP_BATCH, NBuffers / 64), 1);
+
+	start = pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, batch);
+	end = start + batch;
+
+	/* always wrap what we look up in BufferDescriptors */
+	sweepBatchNext = start % NBuffers;
+	sweepBatchLeft = batch;
+
+	/* the first position at or after start that begins a new pass */
+	firstwrap = Max((start + NBuffers - 1) / NBuffers, 1) * NBuffers;
 
 	/*
-	 * Atomically move hand ahead one buffer - if there's several processes
-	 * doing this, this can lead to buffers being returned slightly out of
-	 * apparent order.
+	 * If our batch contains the start of a new pass, we're the one that
+	 * just caused a wraparound: force completePasses to be incremented
+	 * while holding the spinlock. We need the spinlock so
+	 * StrategySyncStart() can return a consistent value consisting of
+	 * nextVictimBuffer and completePasses.
 	 */
-	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
-
-	if (victim >= NBuffers)
+	if (firstwrap < end)
 	{
-		uint32		originalVictim = victim;
+		uint32		expected;
+		uint32		wrapped;
+		bool		success = false;
 
-		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		expected = end;
 
-		/*
-		 * If we're the one that just caused a wraparound, force
-		 * completePasses to be incremented while holding the spinlock. We
-		 * need the spinlock so StrategySyncStart() can return a consistent
-		 * value consisting of nextVictimBuffer and completePasses.
-		 */
-		if (victim == 0)
+		while (!success)
 		{
-			uint32		expected;
-			uint32		wrapped;
-			bool		success = false;
+			/*
+			 * Acquire the spinlock while increasing completePasses. That
+			 * allows other readers to read nextVictimBuffer and
+			 * completePasses in a consistent manner which is required for
+			 * StrategySyncStart().  In theory delaying the increment
+			 * could lead to an overflow of nextVictimBuffers, but that's
+			 * highly unlikely and wouldn't be particularly harmful.
+			 */
+			SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-			expected = originalVictim + 1;
+			wrapped = expected % NBuffers;
 
-			while (!success)
-			{
-				/*
-				 * Acquire the spinlock while increasing completePasses. That
-				 * allows other readers to read nextVictimBuffer and
-				 * completePasses in a consistent manner which is required for
-				 * StrategySyncStart().  In theory delaying the increment
-				 * could lead to an overflow of nextVictimBuffers, but that's
-				 * highly unlikely and wouldn't be particularly harmful.
-				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-
-				wrapped = expected % NBuffers;
-
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
-														 &expected, wrapped);
-				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
-			}
+			success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+													 &expected, wrapped);
+			if (success)
+				StrategyControl->completePasses++;
+			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 		}
 	}
+}
+
+/*
+ * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ *
+ * Move the clock hand one buffer ahead of its current position and return the
+ * id of the buffer now under the hand.  The hand positions come out of the
+ * batch this backend has claimed, claiming a new one when that runs out.
+ */
+static inline uint32
+ClockSweepTick(void)
+{
+	uint32		victim;
+
+	if (sweepBatchLeft == 0)
+		ClockSweepClaimBatch();
+
+	victim = sweepBatchNext;
+	if (++sweepBatchNext >= NBuffers)
+		sweepBatchNext = 0;
+	sweepBatchLeft--;
+
 	return victim;
 }
 
@@ -587,6 +629,19 @@ GetAccessStrategy(BufferAccessStrategyType btype)
 	return strategy;
 }
 
+/*
+ * GetAccessStrategyRingSize -- number of buffers in a strategy's ring
+ *
+ * Returns 0 for the default strategy, which uses all of shared buffers.
+ */
+int
+GetAccessStrategyRingSize(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return 0;
+	return strategy->ring_size;
+}
+
 /*
  * FreeAccessStrategy -- release a BufferAccessStrategy object
  *
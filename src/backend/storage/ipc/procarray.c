@@ -172,6 +172,7 @@ static int	KnownAssignedXidsGetAndSetXmin(TransactionId *xarray,
 static TransactionId KnownAssignedXidsGetOldestXmin(void);
 static void KnownAssignedXidsDisplay(int trace_level);
 static void KnownAssignedXidsReset(void);
+static bool GetSnapshotDataReuse(Snapshot snapshot);
 static inline void ProcArrayEndTransactionInternal(PGPROC *proc,
 												   PGXACT *pgxact, TransactionId latestXid);
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
@@ -249,6 +250,8 @@ CreateSharedProcArray(void)
 		procArray->lastOverflowedXid = InvalidTransactionId;
 		procArray->replication_slot_xmin = InvalidTransactionId;
 		procArray->replication_slot_catalog_xmin = InvalidTransactionId;
+		/* 0 marks snapshots that must not be reused */
+		ShmemVariableCache->xactCompletionCount = 1;
 	}
 
 	allProcs = ProcGlobal->allProcs;
@@ -352,6 +355,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* Same with xactCompletionCount */
+		ShmemVariableCache->xactCompletionCount++;
 	}
 	else
 	{
@@ -467,6 +473,9 @@ ProcArrayEndTransactionInternal(PGPROC *proc, PGXACT *pgxact,
 	if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
+
+	/* Same with xactCompletionCount */
+	ShmemVariableCache->xactCompletionCount++;
 }
 
 /*
@@ -619,6 +628,15 @@ ProcArrayClearTransaction(PGPROC *proc)
 	/* Clear the subtransaction-XID cache too */
 	pgxact->nxids = 0;
 	pgxact->overflowed = false;
+
+	/*
+	 * Our snapshots don't include our own XIDs, so they would not count the
+	 * prepared transaction as running.  Bump xactCompletionCount, although
+	 * the transaction hasn't completed, so that we don't reuse them.
+	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	ShmemVariableCache->xactCompletionCount++;
+	LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -876,6 +894,8 @@ ProcArrayApplyRecoveryInfo(RunningTransactions running)
 
 	Assert(TransactionIdIsNormal(ShmemVariableCache->latestCompletedXid));
 
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 
 	/* ShmemVariableCache->nextFullXid must be beyond any observed xid. */
@@ -953,6 +973,9 @@ ProcArrayApplyXidAssignment(TransactionId topxid,
 	if (TransactionIdPrecedes(procArray->lastOverflowedXid, max_xid))
 		procArray->lastOverflowedXid = max_xid;
 
+	/* snapshots no longer list the subxids, and may be overflowed */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -1513,6 +1536,7 @@ GetSnapshotData(Snapshot snapshot)
 	bool		suboverflowed = false;
 	TransactionId replication_slot_xmin = InvalidTransactionId;
 	TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
+	uint64		curXactCompletionCount;
 
 	Assert(snapshot != NULL);
 
@@ -1554,6 +1578,12 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	LWLockAcquire(ProcArrayLock, LW_SHARED);
 
+	if (GetSnapshotDataReuse(snapshot))
+	{
+		LWLockRelease(ProcArrayLock);
+		return snapshot;
+	}
+
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = ShmemVariableCache->latestCompletedXid;
 	Assert(TransactionIdIsNormal(xmax));
@@ -1704,6 +1734,7 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	replication_slot_xmin = procArray->replication_slot_xmin;
 	replication_slot_catalog_xmin = procArray->replication_slot_catalog_xmin;
+	curXactCompletionCount = ShmemVariableCache->xactCompletionCount;
 
 	if (!TransactionIdIsValid(MyPgXact->xmin))
 		MyPgXact->xmin = TransactionXmin = xmin;
@@ -1765,22 +1796,70 @@ GetSnapshotData(Snapshot snapshot)
 		 */
 		snapshot->lsn = InvalidXLogRecPtr;
 		snapshot->whenTaken = 0;
+		snapshot->snapXactCompletionCount = curXactCompletionCount;
 	}
 	else
 	{
 		/*
 		 * Capture the current time and WAL stream location in case this
 		 * snapshot becomes old enough to need to fall back on the special
-		 * "old snapshot" logic.
+		 * "old snapshot" logic.  Such snapshots are not reused.
 		 */
 		snapshot->lsn = GetXLogInsertRecPtr();
 		snapshot->whenTaken = GetSnapshotCurrentTimestamp();
 		MaintainOldSnapshotTimeMapping(snapshot->whenTaken, xmin);
+		snapshot->snapXactCompletionCount = 0;
 	}
 
 	return snapshot;
 }
 
+/*
+ * Helper function for GetSnapshotData() that checks if the snapshot it was
+ * handed can be returned as it is, without scanning the procarray.  The
+ * caller must hold ProcArrayLock.
+ *
+ * The set of XIDs considered running by GetSnapshotData() cannot change while
+ * ProcArrayLock is held (see transam/README), and xactCompletionCount is
+ * incremented whenever a transaction with an XID finishes, while holding
+ * ProcArrayLock exclusively.  XIDs assigned meanwhile are >= xmax, so they
+ * don't matter either.  Hence if xactCompletionCount is still the value it
+ * had when the snapshot was built, building it again would give the same
+ * xmin, xmax, xip and subxip.  Lazy VACUUM and logical decoding, whose
+ * backends are skipped, never hold an XID while they are flagged.
+ *
+ * The snapshot's xmin is then safe to install as our MyPgXact->xmin: no row
+ * visible to the snapshot can have been removed, as that would require the
+ * set of running transactions to change.  RecentGlobalXmin and
+ * RecentGlobalDataXmin are left alone; their values from when we last built
+ * a snapshot are possibly older than necessary, but still correct.
+ *
+ * Snapshots subject to old_snapshot_threshold are always built afresh, as
+ * they need a current LSN and timestamp.
+ */
+static bool
+GetSnapshotDataReuse(Snapshot snapshot)
+{
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (snapshot->snapXactCompletionCount == 0 ||
+		snapshot->snapXactCompletionCount != ShmemVariableCache->xactCompletionCount)
+		return false;
+
+	if (!TransactionIdIsValid(MyPgXact->xmin))
+		MyPgXact->xmin = TransactionXmin = snapshot->xmin;
+
+	RecentXmin = snapshot->xmin;
+	Assert(TransactionIdPrecedesOrEquals(TransactionXmin, RecentXmin));
+
+	snapshot->curcid = GetCurrentCommandId(false);
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+
+	return true;
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyPgXact->xmin
  *
@@ -3211,6 +3290,9 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	/* Same with xactCompletionCount */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3392,6 +3474,9 @@ ExpireTreeKnownAssignedTransactionIds(TransactionId xid, int nsubxids,
 							  max_xid))
 		ShmemVariableCache->latestCompletedXid = max_xid;
 
+	/* ... and xactCompletionCount */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3404,6 +3489,7 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -3416,6 +3502,7 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -59,6 +59,7 @@
 #include "access/transam.h"
 #include "catalog/namespace.h"
 #include "executor/executor.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
@@ -1142,6 +1143,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	CachedPlan *plan = NULL;
 	List	   *qlist;
 	bool		customplan;
+	ListCell   *lc;
 
 	/* Assert caller is doing things in a sane order */
 	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
@@ -1188,6 +1190,9 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			}
 			/* Update generic_cost whenever we make a new generic plan */
 			plansource->generic_cost = cached_plan_cost(plan, false);
+			/* Have JIT watch whether compiling it pays off (see jit.c) */
+			foreach(lc, plan->stmt_list)
+				jit_register_plan(lfirst_node(PlannedStmt, lc));
 
 			/*
 			 * If, based on the now-known value of generic_cost, we'd not have
@@ -1274,7 +1279,13 @@ ReleaseCachedPlan(CachedPlan *plan, bool useResOwner)
 
 		/* One-shot plans do not own their context, so we can't free them */
 		if (!plan->is_oneshot)
+		{
+			ListCell   *lc;
+
+			foreach(lc, plan->stmt_list)
+				jit_forget_plan(lfirst_node(PlannedStmt, lc));
 			MemoryContextDelete(plan->context);
+		}
 	}
 }
 
@@ -28,12 +28,14 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/parallelredo.h"
 #include "access/rmgr.h"
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/storage.h"
@@ -44,6 +46,9 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "common/string.h"
+#include "executor/nodeHashjoin.h"
+#include "executor/nodeNestloop.h"
+#include "executor/nodeSeqscan.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -63,6 +68,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/ioworker.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
@@ -98,7 +104,9 @@
 #include "utils/tzparser.h"
 #include "utils/varlena.h"
 #include "utils/xml.h"
+#include "lero/calibration.h"
 #include "lero/lero_extension.h"
+#include "lero/router.h"
 
 #ifndef PG_KRB_SRVTAB
 #define PG_KRB_SRVTAB ""
@@ -199,6 +207,7 @@ static bool check_max_wal_senders(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
+static bool check_numa_interleave_buffers(bool *newval, void **extra, GucSource source);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
@@ -1101,6 +1110,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel-aware hashed aggregation plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_hashagg,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and run-time partition pruning."),
@@ -1294,6 +1313,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Prefetches blocks referenced in the WAL during recovery."),
+			gettext_noop("Looks ahead in the WAL to find blocks that are not in the buffer pool yet.")
+		},
+		&recovery_prefetch,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_checkpoints", PGC_SIGHUP, LOGGING_WHAT,
 			gettext_noop("Logs each checkpoint."),
@@ -1956,6 +1985,50 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"seqscan_batch_mode", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Allows sequential scans to process a page of tuples at a time."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&seqscan_batch_mode,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"hashjoin_bloom_filter", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Allows hash joins to filter their outer scan with a Bloom filter of the inner join keys."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&hashjoin_bloom_filter,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"adaptive_nestloop", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Allows nested loops to switch to hashing their inner side when the outer side is much larger than estimated."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&adaptive_nestloop,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"jit_skip_unprofitable", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Stops JIT compiling reused generic plans when compilation takes longer than it saves."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&jit_skip_unprofitable,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit_debugging_support", PGC_SU_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Register JIT compiled function with debugger."),
@@ -2032,6 +2105,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"numa_interleave_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Interleaves the shared buffer pool across NUMA nodes."),
+			NULL
+		},
+		&numa_interleave_buffers,
+		false,
+		check_numa_interleave_buffers, NULL, NULL
+	},
+
 	{
 		{"wal_receiver_create_temp_slot", PGC_SIGHUP, REPLICATION_STANDBY,
 			gettext_noop("Sets whether a WAL receiver should create a temporary replication slot if no permanent slot is configured."),
@@ -2061,6 +2144,26 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
     },
 
+	{
+		{"lero_cost_calibration", PGC_SUSET, UNGROUPED,
+			gettext_noop("Collects per-node timings to calibrate the cost constants."),
+			NULL
+		},
+		&lero_cost_calibration,
+		false,
+		NULL, NULL, NULL
+    },
+
+	{
+		{"lero_use_calibrated_costs", PGC_USERSET, UNGROUPED,
+			gettext_noop("Plans with the calibrated cost constants when available."),
+			NULL
+		},
+		&lero_use_calibrated_costs,
+		false,
+		NULL, NULL, NULL
+    },
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, false, NULL, NULL, NULL
@@ -2127,6 +2230,17 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"join_sample_rows", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of rows sampled per relation to "
+						 "correct uncertain join size estimates."),
+			gettext_noop("Zero disables sampling."),
+			GUC_EXPLAIN
+		},
+		&join_sample_rows,
+		0, 0, 100000,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2732,6 +2846,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks used for concurrent WAL insertion."),
+			gettext_noop("-1 sets it based on the number of CPUs.")
+		},
+		&wal_insert_locks,
+		-1, -1, MAX_XLOGINSERT_LOCKS,
+		check_wal_insert_locks, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -2765,6 +2889,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_redo_workers", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of background workers that replay WAL during recovery."),
+			NULL
+		},
+		&parallel_redo_workers,
+		0, 0, MAX_PARALLEL_REDO_WORKERS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_wal_senders", PGC_POSTMASTER, REPLICATION_SENDING,
 			gettext_noop("Sets the maximum number of simultaneously running WAL sender processes."),
@@ -2814,11 +2948,11 @@ static struct config_int ConfigureNamesInt[] =
 		{"commit_delay", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Sets the delay in microseconds between transaction commit and "
 						 "flushing WAL to disk."),
-			NULL
+			gettext_noop("-1 chooses the delay based on how long WAL flushes take.")
 			/* we have no microseconds designation, so can't supply units here */
 		},
 		&CommitDelay,
-		0, 0, 100000,
+		0, -1, 100000,
 		NULL, NULL, NULL
 	},
 
@@ -2973,6 +3107,31 @@ static struct config_int ConfigureNamesInt[] =
 		check_maintenance_io_concurrency, NULL, NULL
 	},
 
+	{
+		{"io_combine_limit",
+			PGC_USERSET,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Limit on the size of data reads and writes with a single system call."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&io_combine_limit,
+		16, 1, MAX_IO_COMBINE_LIMIT,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"io_workers",
+			PGC_POSTMASTER,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Number of background processes that read prefetched blocks into shared buffers."),
+			NULL
+		},
+		&io_workers,
+		0, 0, MAX_IO_WORKERS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"backend_flush_after", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -3412,6 +3571,19 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
     },
 
+	{
+		{"lero_connect_timeout", PGC_USERSET, UNGROUPED,
+			gettext_noop("Sets the maximum time to wait while connecting to a Lero server."),
+			gettext_noop("A server that does not accept the connection in time is "
+						 "taken off the ring like one that refuses it. "
+						 "A value of 0 waits indefinitely."),
+			GUC_UNIT_MS
+		},
+		&lero_connect_timeout,
+		1000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, 0, 0, 0, NULL, NULL, NULL
@@ -3692,6 +3864,17 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"lero_calibration_sample_rate", PGC_SUSET, UNGROUPED,
+			gettext_noop("Fraction of queries to collect cost calibration samples from."),
+			gettext_noop("Use a value between 0.0 (never sample) and 1.0 (sample all "
+						 "queries).  Only used while lero_cost_calibration is on.")
+		},
+		&lero_calibration_sample_rate,
+		0.1, 0.0, 1.0,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, 0.0, 0.0, 0.0, NULL, NULL, NULL
@@ -4469,7 +4652,7 @@ static struct config_string ConfigureNamesString[] =
 		},
 		&lero_joinest_fname,
 		"",
-		check_cluster_name, NULL, NULL
+		check_cluster_name, assign_lero_joinest_fname, NULL
     },
 
 	{
@@ -4483,6 +4666,18 @@ static struct config_string ConfigureNamesString[] =
 		check_cluster_name, NULL, NULL
     },	
 
+	{
+		{"lero_servers", PGC_USERSET, UNGROUPED,
+				gettext_noop("Sets the list of Lero servers as host:port pairs."),
+				gettext_noop("Queries are routed over the servers by consistent hashing. "
+							 "If empty, lero_server_host and lero_server_port are used."),
+				GUC_LIST_INPUT
+		},
+		&lero_servers,
+		"",
+		NULL, NULL, NULL
+    },
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, NULL, NULL, NULL, NULL
@@ -11657,6 +11852,19 @@ check_maintenance_io_concurrency(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_numa_interleave_buffers(bool *newval, void **extra, GucSource source)
+{
+#ifndef __linux__
+	if (*newval)
+	{
+		GUC_check_errdetail("numa_interleave_buffers is only supported on Linux.");
+		return false;
+	}
+#endif
+	return true;
+}
+
 static void
 assign_pgstat_temp_directory(const char *newval, void *extra)
 {
@@ -22,6 +22,7 @@
 #include "access/tableam.h"
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
+#include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
@@ -63,6 +64,12 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/* blocks read ahead of a sequential scan, see heapreadpage() */
+	int			rs_nrabufs;		/* number of pinned buffers in rs_rabufs */
+	int			rs_ranext;		/* index of the next one to return */
+	BlockNumber rs_rablock;		/* block # of rs_rabufs[rs_ranext] */
+	Buffer		rs_rabufs[MAX_IO_COMBINE_LIMIT];
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
@@ -121,6 +128,8 @@ extern void heap_endscan(TableScanDesc scan);
 extern HeapTuple heap_getnext(TableScanDesc scan, ScanDirection direction);
 extern bool heap_getnextslot(TableScanDesc sscan,
 							 ScanDirection direction, struct TupleTableSlot *slot);
+extern int	heap_getnextbatch(TableScanDesc sscan, HeapTupleData *tuples,
+							  int maxtuples);
 
 extern bool heap_fetch(Relation relation, Snapshot snapshot,
 					   HeapTuple tuple, Buffer *userbuf);
@@ -805,6 +805,16 @@ extern HeapTuple heap_modify_tuple_by_cols(HeapTuple tuple,
 										   bool *replIsnull);
 extern void heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 							  Datum *values, bool *isnull);
+extern int	heap_fixed_prefix_natts(TupleDesc tupleDesc);
+extern void heap_deform_fixed_prefix(TupleDesc tupleDesc, char *tp, int natts,
+									 Datum *values, bool *isnull);
+extern void heap_deform_column_batch(TupleDesc tupleDesc, HeapTupleData *tuples,
+									 const uint16 *selection, int nselected,
+									 int attnum, Datum *values, bool *isnull);
+extern void heap_deform_prefix_batch(TupleDesc tupleDesc, HeapTupleData *tuples,
+									 const uint16 *selection, int nselected,
+									 int ncolumns, const AttrNumber *attnums,
+									 Datum **values, bool **isnull);
 extern void heap_freetuple(HeapTuple htup);
 extern MinimalTuple heap_form_minimal_tuple(TupleDesc tupleDescriptor,
 											Datum *values, bool *isnull);
@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallelredo.h
+ *	  Replay of WAL records by background workers during recovery.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ * src/include/access/parallelredo.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARALLELREDO_H
+#define PARALLELREDO_H
+
+#include "access/xlogreader.h"
+
+/* GUC options */
+extern int	parallel_redo_workers;
+
+/* upper limit for parallel_redo_workers */
+#define MAX_PARALLEL_REDO_WORKERS 32
+
+extern Size ParallelRedoShmemSize(void);
+extern void ParallelRedoShmemInit(void);
+
+extern void ParallelRedoStart(void);
+extern bool ParallelRedoDispatch(XLogReaderState *record);
+extern XLogRecPtr ParallelRedoWaitForWorkers(void);
+extern void ParallelRedoMinRecoveryPointChanged(void);
+extern void ParallelRedoEnd(void);
+
+extern void ParallelRedoWorkerMain(Datum main_arg);
+
+#endif							/* PARALLELREDO_H */
@@ -196,6 +196,13 @@ typedef struct VariableCacheData
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
 
+	/*
+	 * Number of top-level transactions with XIDs completed since startup;
+	 * incremented whenever the contents of a snapshot built by
+	 * GetSnapshotData() might change.  See GetSnapshotDataReuse().
+	 */
+	uint64		xactCompletionCount;
+
 	/*
 	 * These fields are protected by XactTruncationLock
 	 */
@@ -83,6 +83,10 @@ typedef struct TupleDescData
 	int32		tdtypmod;		/* typmod for tuple type */
 	int			tdrefcount;		/* reference count, or -1 if not counting */
 	TupleConstr *constr;		/* constraints, or NULL if none */
+	int16		tdfixedprefix;	/* # of leading fixed-width attributes, or -1
+								 * if not computed yet */
+	int16		tdfixedwords;	/* # of leading by-value attributes stored as
+								 * consecutive aligned Datums */
 	/* attrs[N] is the description of Attribute Number N+1 */
 	FormData_pg_attribute attrs[FLEXIBLE_ARRAY_MEMBER];
 }			TupleDescData;
@@ -206,6 +206,17 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * Hint that the cache line containing the given address is about to be
+ * read.  Useful where the address of the next few lookups is known ahead of
+ * time, to overlap their cache misses with other work.
+ */
+#if __GNUC__ >= 3
+#define pg_prefetch_mem(addr)	__builtin_prefetch(addr)
+#else
+#define pg_prefetch_mem(addr)	((void) 0)
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
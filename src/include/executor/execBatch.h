@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batch-at-a-time qual evaluation for scan nodes.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "access/htup.h"
+#include "fmgr.h"
+#include "nodes/execnodes.h"
+
+/*
+ * A qual clause of the form "column op constant" that is evaluated over a
+ * whole batch at once.
+ */
+typedef struct BatchPredicate
+{
+	int			column;			/* index into ScanBatch's column arrays */
+	bool		constfirst;		/* constant is the operator's left input */
+	bool		constisnull;
+	Datum		constvalue;
+	FmgrInfo	flinfo;
+	FunctionCallInfo fcinfo;
+} BatchPredicate;
+
+/*
+ * State of a scan that fetches its tuples a batch at a time.
+ *
+ * tuples[] holds the current batch as fetched from the table, and
+ * selection[] the indexes of the tuples still qualifying after the batch
+ * predicates ran.  The columns read by the predicates are deformed into
+ * columnar arrays, values[c][i] and isnull[c][i] for column c of tuple i.
+ */
+typedef struct ScanBatch
+{
+	int			maxtuples;		/* capacity of the arrays below */
+
+	/* the current batch */
+	int			ntuples;
+	HeapTupleData *tuples;
+	int			nselected;
+	uint16	   *selection;
+	int			next;			/* next entry of selection[] to return */
+
+	/* the part of the qual evaluated over whole batches */
+	int			npredicates;
+	BatchPredicate *predicates;
+
+	/* columns read by the predicates */
+	int			ncolumns;
+	AttrNumber *attnums;
+	bool	   *deformed;		/* column deformed for the current batch? */
+	Datum	  **values;
+	bool	  **isnull;
+} ScanBatch;
+
+extern ScanBatch *ExecInitScanBatch(List *qual, int maxtuples,
+									List **residual);
+extern void ExecScanBatchQual(ScanBatch *batch, TupleDesc tupdesc,
+							  ExprContext *econtext);
+extern void ExecResetScanBatch(ScanBatch *batch);
+
+#endif							/* EXECBATCH_H */
@@ -271,6 +271,12 @@ extern ProjectionInfo *ExecBuildProjectionInfo(List *targetList,
 											   TupleTableSlot *slot,
 											   PlanState *parent,
 											   TupleDesc inputDesc);
+extern ProjectionInfo *ExecBuildFilteredProjectionInfo(List *qual,
+													   List *targetList,
+													   ExprContext *econtext,
+													   TupleTableSlot *slot,
+													   PlanState *parent,
+													   TupleDesc inputDesc);
 extern ExprState *ExecPrepareExpr(Expr *node, EState *estate);
 extern ExprState *ExecPrepareQual(List *qual, EState *estate);
 extern ExprState *ExecPrepareCheck(List *qual, EState *estate);
@@ -360,6 +366,42 @@ ExecProject(ProjectionInfo *projInfo)
 }
 #endif
 
+/*
+ * ExecProjectIfQual
+ *
+ * Evaluates projection info built by ExecBuildFilteredProjectionInfo.  If
+ * the input tuple satisfies the qual, projects it into the result slot and
+ * returns true; otherwise returns false, leaving the result slot empty.
+ */
+#ifndef FRONTEND
+static inline bool
+ExecProjectIfQual(ProjectionInfo *projInfo)
+{
+	ExprContext *econtext = projInfo->pi_exprContext;
+	ExprState  *state = &projInfo->pi_state;
+	TupleTableSlot *slot = state->resultslot;
+	Datum		ret;
+	bool		isnull;
+
+	Assert(projInfo->pi_hasqual);
+
+	ExecClearTuple(slot);
+
+	ret = ExecEvalExprSwitchContext(state, econtext, &isnull);
+
+	/* EEOP_QUAL should never return NULL */
+	Assert(!isnull);
+
+	if (!DatumGetBool(ret))
+		return false;
+
+	slot->tts_flags &= ~TTS_FLAG_EMPTY;
+	slot->tts_nvalid = slot->tts_tupleDescriptor->natts;
+
+	return true;
+}
+#endif
+
 /*
  * ExecQual - evaluate a qual prepared with ExecInitQual (possibly via
  * ExecPrepareQual).  Returns true if qual is satisfied, else false.
@@ -437,6 +479,7 @@ extern TupleTableSlot *ExecScan(ScanState *node, ExecScanAccessMtd accessMtd,
 								ExecScanRecheckMtd recheckMtd);
 extern void ExecAssignScanProjectionInfo(ScanState *node);
 extern void ExecAssignScanProjectionInfoWithVarno(ScanState *node, Index varno);
+extern void ExecAssignScanProjectionInfoQual(ScanState *node, List *qual);
 extern void ExecScanReScan(ScanState *node);
 
 /*
@@ -530,6 +573,9 @@ extern void ExecAssignProjectionInfo(PlanState *planstate,
 									 TupleDesc inputDesc);
 extern void ExecConditionalAssignProjectionInfo(PlanState *planstate,
 												TupleDesc inputDesc, Index varno);
+extern void ExecConditionalAssignProjectionInfoQual(PlanState *planstate,
+													TupleDesc inputDesc,
+													Index varno, List *qual);
 extern void ExecFreeExprContext(PlanState *planstate);
 extern void ExecAssignScanType(ScanState *scanstate, TupleDesc tupDesc);
 extern void ExecCreateScanSlotFromOuterPlan(EState *estate,
@@ -281,6 +281,21 @@ typedef struct ParallelHashJoinState
 #define PHJ_GROW_BUCKETS_REINSERTING	2
 #define PHJ_GROW_BUCKETS_PHASE(n)		((n) % 3)	/* circular phases */
 
+/*
+ * Each bucket of a private (non-parallel) hash table has a 16-bit tag, kept
+ * in a separate array that is a quarter of the size of the bucket pointers.
+ * Each tuple in the bucket sets one bit, chosen by HJ_BUCKET_TAG(hashvalue).
+ * A probe whose bit is clear can skip the bucket without following a single
+ * pointer, which is the common case for outer tuples without a match.  The
+ * bit is chosen from a multiplicative mix of the whole hash value, since
+ * the low bits are the same for all tuples of a bucket.
+ */
+#define HJ_BUCKET_TAG(hashvalue) \
+	((uint16) (1 << (((uint32) (hashvalue) * 0x9E3779B1U) >> 28)))
+
+/* Memory needed per bucket of a private hash table: pointer and tag */
+#define HJ_BUCKET_SIZE	(sizeof(HashJoinTuple) + sizeof(uint16))
+
 typedef struct HashJoinTableData
 {
 	int			nbuckets;		/* # buckets in the in-memory hash table */
@@ -299,6 +314,9 @@ typedef struct HashJoinTableData
 		dsa_pointer_atomic *shared;
 	}			buckets;
 
+	/* bucket_tags[i] summarizes the hash values in private bucket i */
+	uint16	   *bucket_tags;
+
 	bool		keepNulls;		/* true to store unmatchable NULL tuples */
 
 	bool		skewEnabled;	/* are we using skew optimization? */
@@ -16,6 +16,8 @@
 
 #include "nodes/execnodes.h"
 
+extern PGDLLIMPORT bool adaptive_nestloop;
+
 extern NestLoopState *ExecInitNestLoop(NestLoop *node, EState *estate, int eflags);
 extern void ExecEndNestLoop(NestLoopState *node);
 extern void ExecReScanNestLoop(NestLoopState *node);
@@ -17,6 +17,9 @@
 #include "access/parallel.h"
 #include "nodes/execnodes.h"
 
+/* GUC parameter */
+extern PGDLLIMPORT bool seqscan_batch_mode;
+
 extern SeqScanState *ExecInitSeqScan(SeqScan *node, EState *estate, int eflags);
 extern void ExecEndSeqScan(SeqScanState *node);
 extern void ExecReScanSeqScan(SeqScanState *node);
@@ -28,5 +28,8 @@ extern TupleQueueReader *CreateTupleQueueReader(shm_mq_handle *handle);
 extern void DestroyTupleQueueReader(TupleQueueReader *reader);
 extern HeapTuple TupleQueueReaderNext(TupleQueueReader *reader,
 									  bool nowait, bool *done);
+extern bool TupleQueueReaderNextNoCopy(TupleQueueReader *reader,
+									   bool nowait, bool *done,
+									   HeapTuple tuple);
 
 #endif							/* TQUEUE_H */
@@ -89,6 +89,7 @@ extern bool jit_tuple_deforming;
 extern double jit_above_cost;
 extern double jit_inline_above_cost;
 extern double jit_optimize_above_cost;
+extern bool jit_skip_unprofitable;
 
 
 extern void jit_reset_after_error(void);
@@ -101,5 +102,15 @@ extern void jit_release_context(JitContext *context);
 extern bool jit_compile_expr(struct ExprState *state);
 extern void InstrJitAgg(JitInstrumentation *dst, JitInstrumentation *add);
 
+/* JIT statistics of plans executed repeatedly */
+struct PlannedStmt;
+extern void jit_register_plan(const struct PlannedStmt *stmt);
+extern void jit_forget_plan(const struct PlannedStmt *stmt);
+extern int	jit_plan_flags(const struct PlannedStmt *stmt, bool *tracked);
+extern void jit_report_plan(const struct PlannedStmt *stmt,
+							JitContext *context,
+							JitInstrumentation *worker_instr,
+							double total_time);
+
 
 #endif							/* JIT_H */
@@ -0,0 +1,46 @@
+#include "postgres.h"
+#include "executor/execdesc.h"
+
+#ifndef LERO_CALIBRATION
+#define LERO_CALIBRATION
+
+// cost constants fitted by calibration, in the order of the feature vector
+#define CALIB_SEQ_PAGE 0
+#define CALIB_RANDOM_PAGE 1
+#define CALIB_CPU_TUPLE 2
+#define CALIB_CPU_INDEX_TUPLE 3
+#define CALIB_CPU_OPERATOR 4
+#define CALIB_NUM_CONSTANTS 5
+
+// refit the constants every time this many new samples were collected
+#define CALIB_REFIT_SAMPLES 1000
+
+extern bool lero_cost_calibration;
+
+extern bool lero_use_calibrated_costs;
+
+extern double lero_calibration_sample_rate;
+
+typedef struct CalibratedCosts {
+	double seq_page_cost;
+
+	double random_page_cost;
+
+	double cpu_tuple_cost;
+
+	double cpu_index_tuple_cost;
+
+	double cpu_operator_cost;
+} CalibratedCosts;
+
+extern Size LeroCalibrationShmemSize(void);
+
+extern void LeroCalibrationShmemInit(void);
+
+extern int lero_calibration_instrument_options(void);
+
+extern void lero_calibration_collect(QueryDesc *queryDesc);
+
+extern bool lero_get_calibrated_costs(CalibratedCosts *costs);
+
+#endif
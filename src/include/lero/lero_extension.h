@@ -13,8 +13,14 @@ extern bool enable_lero_verbose;
 
 extern int lero_server_port;
 
+extern int lero_connect_timeout;
+
 extern char *lero_server_host;
 
+extern char *lero_joinest_fname;
+
+extern void assign_lero_joinest_fname(const char *newval, void *extra);
+
 typedef struct LeroPlan {
 	double *card;
 
@@ -0,0 +1,17 @@
+#include "postgres.h"
+
+#ifndef LERO_ROUTER
+#define LERO_ROUTER
+
+// number of points every endpoint owns on the hash ring
+#define LERO_RING_VNODES 64
+
+// how long a dead endpoint stays off the ring before it is tried again
+#define LERO_DEAD_RETRY_MS 10000
+
+extern char *lero_servers;
+
+extern int
+connect_to_lero_server(uint32 route_hash);
+
+#endif
@@ -31,13 +31,16 @@ extern char*
 concat_str(char* a, char *b);
 
 extern char*
-send_and_receive_msg(int conn_fd, char* json_str);
+send_and_receive_msg(int conn_fd, char* json_str, size_t *len);
 
 char*
 get_query_unique_id(const char *queryString);
 
+extern uint32
+get_query_fingerprint(Query *parse, const char *queryString);
+
 extern yyjson_doc*
-parse_json_str(const char* json);
+parse_json_str(char* json, size_t len);
 
 extern yyjson_mut_val*
 double_list_to_json_arr(double l[], int n, yyjson_mut_doc *json_doc);
@@ -333,6 +333,8 @@ typedef struct ProjectionInfo
 	ExprState	pi_state;
 	/* expression context in which to evaluate expression */
 	ExprContext *pi_exprContext;
+	/* does pi_state check a qual first?  see ExecProjectIfQual */
+	bool		pi_hasqual;
 } ProjectionInfo;
 
 /* ----------------
@@ -596,10 +598,14 @@ typedef struct EState
 	 * es_jit_worker_instr is the combined, on demand allocated,
 	 * instrumentation from all workers. The leader's instrumentation is kept
 	 * separate, and is combined on demand by ExplainPrintJITSummary().
+	 *
+	 * es_jit_starttime is when execution started, if the plan's JIT
+	 * statistics are tracked (see jit_plan_flags); else it is zero.
 	 */
 	int			es_jit_flags;
 	struct JitContext *es_jit;
 	struct JitInstrumentation *es_jit_worker_instr;
+	instr_time	es_jit_starttime;
 } EState;
 
 
@@ -1339,12 +1345,21 @@ typedef struct ScanState
 
 /* ----------------
  *	 SeqScanState information
+ *
+ *		batch is set if the scan fetches a heap page at a time and
+ *		evaluates the simple part of its qual over the whole page; see
+ *		execBatch.c.  ps.qual then holds only the remaining clauses.
+ *
+ *		filter is set if a hash join above the scan asked it to drop the
+ *		tuples that cannot have a join partner; see HashJoinFilter.
  * ----------------
  */
 typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	struct ScanBatch *batch;	/* batch mode state, or NULL */
+	struct HashJoinFilter *filter;	/* pushed down by a hash join, or NULL */
 } SeqScanState;
 
 /* ----------------
@@ -1852,6 +1867,11 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *		Hash			   state for switching to a hash of the inner side
+ *						   once the outer side turns out to be large, or
+ *						   NULL if the join can't switch (see nodeNestloop.c)
+ *		HashBuilds		   number of times the inner side was hashed
+ *		HashOverflows	   and how often it didn't fit in hash_mem
  * ----------------
  */
 typedef struct NestLoopState
@@ -1860,6 +1880,9 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+	struct NestLoopHashState *nl_Hash;
+	long		nl_HashBuilds;
+	long		nl_HashOverflows;
 } NestLoopState;
 
 /* ----------------
@@ -1959,6 +1982,13 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	/* outer tuples fetched ahead by the batched probe, see nodeHashjoin.c */
+	int			hj_OuterBatchSize;	/* 0 if not probing in batches */
+	int			hj_OuterBatchCount; /* # of tuples in the current batch */
+	int			hj_OuterBatchNext;	/* next tuple of the batch to return */
+	TupleTableSlot **hj_OuterBatchSlots;
+	uint32	   *hj_OuterBatchHashValues;
+	int		   *hj_OuterBatchBuckets;	/* bucket to probe, or -1 if none */
 } HashJoinState;
 
 
@@ -2211,9 +2241,15 @@ typedef struct AggState
 	AggStatePerHash perhash;	/* array of per-hashtable data */
 	AggStatePerGroup *hash_pergroup;	/* grouping set indexed array of
 										 * per-group pointers */
+	TupleTableSlot **hash_chunk_slots;	/* input tuples read ahead to
+										 * prefetch their hash buckets */
+	uint32	   *hash_chunk_hashes;	/* and their hash values */
+	struct ParallelHashAggState *hash_shared;	/* shared partitions of a
+												 * parallel-aware HashAgg */
+	struct SharedTuplestoreAccessor **hash_shared_sts;	/* and our accessors */
 
 	/* support for evaluation of agg input expressions: */
-#define FIELDNO_AGGSTATE_ALL_PERGROUPS 53
+#define FIELDNO_AGGSTATE_ALL_PERGROUPS 57
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
@@ -2336,6 +2372,7 @@ typedef struct GatherState
 	int64		tuples_needed;	/* tuple bound, see ExecSetTupleBound */
 	/* these fields are set up once: */
 	TupleTableSlot *funnel_slot;
+	HeapTupleData funnel_tuple; /* worker's tuple, still in its queue */
 	struct ParallelExecutorInfo *pei;
 	/* all remaining fields are reinitialized during a rescan: */
 	int			nworkers_launched;	/* original number of workers */
@@ -2399,6 +2436,31 @@ typedef struct SharedHashInfo
 	HashInstrumentation hinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedHashInfo;
 
+/* ----------------
+ *	 HashJoinFilter information
+ *
+ *		A Bloom filter over the hash values of a hash join's inner tuples,
+ *		which the join pushes down into a sequential scan directly below it
+ *		on the outer side.  The scan computes the join's hash value for each
+ *		of its tuples from keys, and drops the tuple if the filter says no
+ *		inner tuple has that hash value; see nodeHash.c.  The filter is only
+ *		checked while active, i.e. between the end of the hash table build
+ *		and the destruction of the hash table, and as long as it rejects
+ *		enough tuples to pay for itself.
+ * ----------------
+ */
+typedef struct HashJoinFilter
+{
+	bool		active;			/* should the scan check the filter? */
+	struct bloom_filter *bloom; /* hash values of the inner tuples */
+	int			nkeys;
+	ExprState **keys;			/* outer join keys, over the scan tuple */
+	FmgrInfo   *hashfunctions;	/* the hash table's outer hash functions */
+	Oid		   *collations;		/* and its collations */
+	uint64		nchecked;		/* tuples checked since the build */
+	uint64		nrejected;		/* and how many of them were dropped */
+} HashJoinFilter;
+
 /* ----------------
  *	 HashState information
  * ----------------
@@ -2426,6 +2488,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Bloom filter to fill while building the hash table, or NULL */
+	struct HashJoinFilter *filter;
 } HashState;
 
 /* ----------------
@@ -357,6 +357,12 @@ struct PlannerInfo
 	Relids		curOuterRels;	/* outer rels above current node */
 	List	   *curOuterParams; /* not-yet-assigned NestLoopParams */
 
+	/* estimates supplied by estimator plugins, see estcache.c */
+	struct HTAB *estimate_cache;
+
+	/* base relation samples taken by joinsample.c */
+	List	   *join_samples;
+
 	/* optional private data for join_search_hook, e.g., GEQO */
 	void	   *join_search_private;
 
@@ -64,12 +64,25 @@ extern PGDLLIMPORT bool enable_partitionwise_join;
 extern PGDLLIMPORT bool enable_partitionwise_aggregate;
 extern PGDLLIMPORT bool enable_parallel_append;
 extern PGDLLIMPORT bool enable_parallel_hash;
+extern PGDLLIMPORT bool enable_parallel_hashagg;
 extern PGDLLIMPORT bool enable_partition_pruning;
 extern PGDLLIMPORT int constraint_exclusion;
 
-/** Lero Extension */
-extern char* lero_joinest_fname;
-/** ==== Lero Extension ==== */
+/*
+ * Hook for plugins to supply the row count estimate of a join relation.  The
+ * inputs are to be taken as outer_rows and inner_rows in size, which are less
+ * than the rels' row counts for parameterized paths.
+ */
+typedef bool (*join_size_estimate_hook_type) (PlannerInfo *root,
+											  RelOptInfo *joinrel,
+											  RelOptInfo *outer_rel,
+											  RelOptInfo *inner_rel,
+											  double outer_rows,
+											  double inner_rows,
+											  SpecialJoinInfo *sjinfo,
+											  List *restrictlist,
+											  double *nrows);
+extern PGDLLIMPORT join_size_estimate_hook_type join_size_estimate_hook;
 
 extern double index_pages_fetched(double tuples_fetched, BlockNumber pages,
 								  double index_pages, PlannerInfo *root);
@@ -206,5 +219,6 @@ extern void set_foreign_size_estimates(PlannerInfo *root, RelOptInfo *rel);
 extern PathTarget *set_pathtarget_cost_width(PlannerInfo *root, PathTarget *target);
 extern double compute_bitmap_pages(PlannerInfo *root, RelOptInfo *baserel,
 								   Path *bitmapqual, int loop_count, Cost *cost, double *tuple);
+extern double get_parallel_divisor(Path *path);
 
 #endif							/* COST_H */
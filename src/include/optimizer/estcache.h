@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * estcache.h
+ *	  prototypes for estcache.c.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/optimizer/estcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef ESTCACHE_H
+#define ESTCACHE_H
+
+#include "nodes/pathnodes.h"
+
+/* Kinds of estimates kept in the cache */
+typedef enum EstimateKind
+{
+	EST_JOINREL_ROWS,			/* row count of a join relation */
+	EST_CLAUSELIST_SELEC		/* selectivity of a clause list */
+} EstimateKind;
+
+extern bool estimate_cache_lookup(PlannerInfo *root, EstimateKind kind,
+								  Relids relids, int varRelid,
+								  JoinType jointype,
+								  double outer_rows, double inner_rows,
+								  List *clauses, double *value);
+extern void estimate_cache_store(PlannerInfo *root, EstimateKind kind,
+								 Relids relids, int varRelid,
+								 JoinType jointype,
+								 double outer_rows, double inner_rows,
+								 List *clauses, double value);
+
+#endif							/* ESTCACHE_H */
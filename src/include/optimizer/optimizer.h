@@ -53,6 +53,15 @@ struct HeapTupleData;
 
 /* in path/clausesel.c: */
 
+/* Hook for plugins to supply the selectivity of a clause list */
+typedef bool (*clauselist_selectivity_hook_type) (PlannerInfo *root,
+												  List *clauses,
+												  int varRelid,
+												  JoinType jointype,
+												  SpecialJoinInfo *sjinfo,
+												  Selectivity *selec);
+extern PGDLLIMPORT clauselist_selectivity_hook_type clauselist_selectivity_hook;
+
 extern Selectivity clause_selectivity(PlannerInfo *root,
 									  Node *clause,
 									  int varRelid,
@@ -69,6 +78,11 @@ extern Selectivity clauselist_selectivity(PlannerInfo *root,
 										  int varRelid,
 										  JoinType jointype,
 										  SpecialJoinInfo *sjinfo);
+extern Selectivity standard_clauselist_selectivity(PlannerInfo *root,
+												   List *clauses,
+												   int varRelid,
+												   JoinType jointype,
+												   SpecialJoinInfo *sjinfo);
 
 /* in path/costsize.c: */
 
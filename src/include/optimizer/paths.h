@@ -109,6 +109,20 @@ extern bool have_dangerous_phv(PlannerInfo *root,
 							   Relids outer_relids, Relids inner_params);
 extern void mark_dummy_rel(RelOptInfo *rel);
 
+/*
+ * joinsample.c
+ *	  routines to estimate join sizes by sampling
+ */
+extern PGDLLIMPORT int join_sample_rows;
+
+extern bool estimate_join_size_by_sampling(PlannerInfo *root,
+										   RelOptInfo *joinrel,
+										   RelOptInfo *outer_rel,
+										   RelOptInfo *inner_rel,
+										   SpecialJoinInfo *sjinfo,
+										   List *restrictlist,
+										   double *nrows);
+
 /*
  * equivclass.c
  *	  routines for managing EquivalenceClasses
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * ioworker.h
+ *	  Exports from postmaster/ioworker.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/ioworker.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef IOWORKER_H
+#define IOWORKER_H
+
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+#include "utils/relcache.h"
+
+/* GUC options */
+extern int	io_workers;
+
+/* upper limit for io_workers */
+#define MAX_IO_WORKERS 32
+
+extern void IoWorkersRegister(void);
+extern void IoWorkerMain(Datum main_arg);
+
+extern Size IoWorkerShmemSize(void);
+extern void IoWorkerShmemInit(void);
+
+extern bool IoWorkerPrefetch(Relation reln, ForkNumber forknum,
+							 BlockNumber blocknum);
+extern void IoWorkerForgetRelations(const RelFileNode *rnodes, int nnodes,
+									bool sorted);
+extern void IoWorkerForgetDatabase(Oid dbid);
+
+#endif							/* IOWORKER_H */
@@ -71,6 +71,7 @@ extern double bgwriter_lru_multiplier;
 extern bool track_io_timing;
 extern int	effective_io_concurrency;
 extern int	maintenance_io_concurrency;
+extern int	io_combine_limit;
 
 extern int	checkpoint_flush_after;
 extern int	backend_flush_after;
@@ -78,6 +79,7 @@ extern int	bgwriter_flush_after;
 
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
+extern bool numa_interleave_buffers;
 
 /* in localbuf.c */
 extern PGDLLIMPORT int NLocBuffer;
@@ -87,6 +89,9 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /* upper limit for effective_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
+/* upper limit for io_combine_limit */
+#define MAX_IO_COMBINE_LIMIT 32
+
 /* special block number for ReadBuffer() */
 #define P_NEW	InvalidBlockNumber	/* grow the file to get a new page */
 
@@ -183,6 +188,11 @@ extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 										ForkNumber forkNum, BlockNumber blockNum,
 										ReadBufferMode mode, BufferAccessStrategy strategy);
+extern int	ReadBufferRange(Relation reln, ForkNumber forkNum,
+							BlockNumber blockNum, int nblocks,
+							BufferAccessStrategy strategy, Buffer *buffers);
+extern void LoadSharedBuffer(RelFileNode rnode, char relpersistence,
+							 ForkNumber forkNum, BlockNumber blockNum);
 extern void ReleaseBuffer(Buffer buffer);
 extern void UnlockReleaseBuffer(Buffer buffer);
 extern void MarkBufferDirty(Buffer buffer);
@@ -207,6 +217,7 @@ extern void DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber *forkNum
 								   int nforks, BlockNumber *firstDelBlock);
 extern void DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes);
 extern void DropDatabaseBuffers(Oid dbid);
+extern int	rnode_comparator(const void *p1, const void *p2);
 
 #define RelationGetNumberOfBlocks(reln) \
 	RelationGetNumberOfBlocksInFork(reln, MAIN_FORKNUM)
@@ -242,6 +253,7 @@ extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
+extern int	GetAccessStrategyRingSize(BufferAccessStrategy strategy);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
 
 
@@ -0,0 +1,50 @@
+# Snapshot reuse
+#
+# GetSnapshotData() hands out the previous snapshot again if no transaction
+# completed since it was built.  Check that a read-committed session sees
+# the effects of other sessions' commits, of subtransaction aborts, and of
+# PREPARE TRANSACTION, whether they happen in another session or in its own.
+
+setup
+{
+    CREATE TABLE snap_reuse (a int);
+    INSERT INTO snap_reuse VALUES (0);
+}
+
+teardown
+{
+    DROP TABLE snap_reuse;
+}
+
+session "s1"
+step "s1_begin"			{ BEGIN; }
+step "s1_select"		{ SELECT a FROM snap_reuse ORDER BY a; }
+step "s1_insert"		{ INSERT INTO snap_reuse VALUES (1); }
+step "s1_savepoint"		{ SAVEPOINT sp; }
+step "s1_insert_sub"	{ INSERT INTO snap_reuse VALUES (11); }
+step "s1_rollback_to"	{ ROLLBACK TO SAVEPOINT sp; }
+step "s1_prepare"		{ PREPARE TRANSACTION 'snap_reuse_s1'; }
+step "s1_commit"		{ COMMIT; }
+
+session "s2"
+step "s2_begin"			{ BEGIN; }
+step "s2_insert"		{ INSERT INTO snap_reuse VALUES (2); }
+step "s2_savepoint"		{ SAVEPOINT sp; }
+step "s2_insert_sub"	{ INSERT INTO snap_reuse VALUES (22); }
+step "s2_rollback_to"	{ ROLLBACK TO SAVEPOINT sp; }
+step "s2_prepare"		{ PREPARE TRANSACTION 'snap_reuse_s2'; }
+step "s2_commit"		{ COMMIT; }
+step "s2_commit_prepared"		{ COMMIT PREPARED 'snap_reuse_s2'; }
+step "s2_commit_prepared_s1"	{ COMMIT PREPARED 'snap_reuse_s1'; }
+
+# another session's commit, between transactions and within one
+permutation "s1_select" "s1_select" "s2_begin" "s2_insert" "s1_select" "s2_commit" "s1_select"
+permutation "s1_begin" "s1_select" "s2_begin" "s2_insert" "s2_commit" "s1_select" "s1_commit"
+
+# subtransaction aborts, in another session and in our own
+permutation "s2_begin" "s2_insert" "s2_savepoint" "s2_insert_sub" "s1_select" "s2_rollback_to" "s1_select" "s2_commit" "s1_select"
+permutation "s1_begin" "s1_insert" "s1_savepoint" "s1_insert_sub" "s1_select" "s1_rollback_to" "s1_select" "s1_commit" "s1_select"
+
+# PREPARE TRANSACTION, in another session and in our own
+permutation "s2_begin" "s2_insert" "s1_select" "s2_prepare" "s1_select" "s2_commit_prepared" "s1_select"
+permutation "s1_begin" "s1_insert" "s1_select" "s1_prepare" "s1_select" "s2_commit_prepared_s1" "s1_select"
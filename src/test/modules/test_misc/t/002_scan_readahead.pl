@@ -0,0 +1,91 @@
+# Sequential scans of tables larger than their buffer ring
+#
+# A scan of a table larger than a quarter of shared buffers goes through a
+# small ring of buffers, and reads the blocks following the one it needs
+# ahead of time.  Check that such scans return the right rows, and that they
+# stay within their ring instead of evicting other tables' buffers.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_buffers = 4MB
+max_connections = 10
+max_wal_senders = 0
+max_worker_processes = 0
+autovacuum = off
+io_combine_limit = 16
+));
+$node->start;
+
+# About 1100 blocks, more than a quarter of the 512 shared buffers.  Set the
+# hint bits and checkpoint now, so that the scans below don't dirty buffers,
+# which would make the ring give them up.
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE big AS
+  SELECT g, repeat('x', 50) AS t FROM generate_series(1, 100000) g;
+VACUUM FREEZE big;
+CHECKPOINT;
+));
+
+is( $node->safe_psql('postgres', 'SELECT count(*), sum(g) FROM big'),
+	'100000|5000050000',
+	'scan of a table larger than the ring');
+
+is( $node->safe_psql(
+		'postgres', qq(
+SET io_combine_limit = 1;
+SELECT count(*), sum(g) FROM big;
+)),
+	'100000|5000050000',
+	'scan of a table larger than the ring without read-ahead');
+
+# Scans that stop early release the blocks they read ahead.
+is( $node->safe_psql(
+		'postgres', qq(
+SELECT count(*) FROM (SELECT g FROM big LIMIT 30000) s;
+SELECT count(*) FROM (SELECT g FROM big LIMIT 1) s;
+SELECT count(*), sum(g) FROM big WHERE g % 1000 = 0;
+)),
+	"30000\n1\n100|5050000",
+	'scans stopping early');
+
+# A cursor that moves backward reads one block at a time.
+is( $node->safe_psql(
+		'postgres', qq(
+BEGIN;
+DECLARE c SCROLL CURSOR FOR SELECT g FROM big;
+MOVE FORWARD 50000 IN c;
+FETCH BACKWARD 1 FROM c;
+MOVE BACKWARD 20000 IN c;
+FETCH FORWARD 1 FROM c;
+COMMIT;
+)),
+	"49999\n30000",
+	'scrollable cursor over a table larger than the ring');
+
+# A small table cached before the scans stays cached.
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE small AS SELECT g FROM generate_series(1, 1000) g;
+VACUUM small;
+SELECT count(*) FROM small;
+SELECT count(*) FROM small;
+));
+$node->safe_psql('postgres', 'SELECT count(*) FROM big');
+$node->safe_psql('postgres', 'SELECT count(*) FROM big');
+my $explain = $node->safe_psql('postgres',
+	'EXPLAIN (ANALYZE, BUFFERS, COSTS OFF, TIMING OFF, SUMMARY OFF) SELECT count(*) FROM small'
+);
+like($explain, qr/Buffers: shared hit=\d+/,
+	'small table read from shared buffers');
+unlike($explain, qr/read=/,
+	'scans of the larger table did not evict the small table');
+
+$node->stop;
@@ -0,0 +1,97 @@
+# Relations dropped or truncated while I/O workers read their blocks
+#
+# Bitmap heap scans queue prefetch requests for I/O workers.  Dropping or
+# truncating the relation, or dropping its database, right afterwards must
+# cancel the requests still queued and wait for the reads under way, so that
+# no buffer of the old relation is loaded after its buffers were dropped.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_buffers = 1MB
+io_workers = 4
+max_worker_processes = 8
+effective_io_concurrency = 64
+autovacuum = off
+));
+$node->start;
+
+$node->poll_query_until('postgres',
+	"SELECT count(*) = 4 FROM pg_stat_activity WHERE backend_type = 'io worker'"
+) or die "Timed out while waiting for I/O workers to start";
+
+# About 1500 blocks, much more than fit in shared buffers.  Each value of b
+# is found on a different block every hundred rows, so a bitmap heap scan
+# for one value prefetches most blocks of the table.
+my $create = qq(
+CREATE TABLE t AS
+  SELECT g AS a, g % 100 AS b, repeat('x', 100) AS c
+  FROM generate_series(1, 100000) g;
+CREATE INDEX t_b ON t (b);
+VACUUM ANALYZE t;
+);
+my $scan = qq(
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+SELECT count(*), sum(a) FROM t WHERE b = 42;
+);
+
+# Drop the table right after scanning it, over and over.
+my $result = '';
+for my $i (1 .. 5)
+{
+	$node->safe_psql('postgres', $create);
+	$result .= $node->safe_psql('postgres', $scan . 'DROP TABLE t;') . "\n";
+}
+is($result, "1000|49992000\n" x 5, 'relation dropped after a prefetching scan');
+
+# Truncate it in the transaction that scanned it, and load it again.
+$node->safe_psql('postgres', $create);
+$result = '';
+for my $i (1 .. 5)
+{
+	$result .= $node->safe_psql(
+		'postgres', qq(
+BEGIN;
+$scan
+TRUNCATE t;
+COMMIT;
+INSERT INTO t
+  SELECT g, g % 100, repeat('x', 100) FROM generate_series(1, 100000) g;
+)) . "\n";
+}
+is($result, "1000|49992000\n" x 5, 'relation truncated after a prefetching scan');
+is($node->safe_psql('postgres', $scan), '1000|49992000',
+	'truncated relation reloaded');
+
+# Truncation of the relation's tail by VACUUM.
+$node->safe_psql(
+	'postgres', qq(
+DELETE FROM t WHERE a > 50000;
+$scan
+VACUUM t;
+));
+is($node->safe_psql('postgres', $scan), '500|12496000',
+	'relation truncated by VACUUM after a prefetching scan');
+
+# Drop the database of a relation that was just scanned.
+$node->safe_psql('postgres', 'CREATE DATABASE iodb');
+$node->safe_psql('iodb', $create . $scan);
+$node->safe_psql('postgres', 'DROP DATABASE iodb');
+
+# The server is still in working order, and no worker failed.
+$node->safe_psql('postgres', 'CHECKPOINT');
+is($node->safe_psql('postgres', $scan), '500|12496000',
+	'scan after dropping a database');
+unlike(
+	slurp_file($node->logfile),
+	qr/ERROR|PANIC|terminated by signal/,
+	'no errors in the server log');
+
+$node->stop;
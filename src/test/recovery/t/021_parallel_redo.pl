@@ -0,0 +1,158 @@
+# Test replay of WAL with parallel redo workers
+#
+# Crash recovery, a standby that doesn't allow queries, and a hot standby
+# all replay with parallel_redo_workers set, across relation truncations.
+# The standby is then restarted after a crash and promoted.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq(
+parallel_redo_workers = 4
+shared_buffers = 1MB
+));
+$node_master->start;
+
+$node_master->safe_psql('postgres', 'CREATE TABLE prt (a int, b text)');
+$node_master->safe_psql('postgres', 'CREATE INDEX prt_a ON prt (a)');
+$node_master->safe_psql('postgres', 'CREATE TABLE prt_trunc (a int)');
+$node_master->safe_psql('postgres', 'CHECKPOINT');
+
+# Generate WAL in a pattern that relies on the relation sizes the startup
+# process tracks: inserts, a VACUUM that truncates the heap, inserts that
+# extend it again, and a TRUNCATE that switches to a new relfilenode.
+sub generate_wal
+{
+	my ($node, $start) = @_;
+
+	$node->safe_psql(
+		'postgres', qq(
+INSERT INTO prt SELECT g, repeat('x', 100)
+  FROM generate_series($start, $start + 9999) g;
+DELETE FROM prt WHERE a >= $start + 5000;
+VACUUM prt;
+INSERT INTO prt SELECT g, repeat('y', 100)
+  FROM generate_series($start + 5000, $start + 7999) g;
+UPDATE prt SET b = 'z' WHERE a % 10 = 0 AND a >= $start;
+INSERT INTO prt_trunc SELECT generate_series(1, 5000);
+TRUNCATE prt_trunc;
+INSERT INTO prt_trunc SELECT generate_series(1, 1000);
+));
+	return;
+}
+
+# Check the contents of the tables, through the index as well.
+sub check_contents
+{
+	my ($node, $expected, $test_name) = @_;
+
+	my $result = $node->safe_psql(
+		'postgres', qq(
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt WHERE a > 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+	is($result, $expected, $test_name);
+	return;
+}
+
+# Crash recovery
+generate_wal($node_master, 1);
+my $expected = $node_master->safe_psql(
+	'postgres', qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+$node_master->stop('immediate');
+$node_master->start;
+check_contents($node_master, $expected, 'crash recovery');
+
+# A standby that doesn't allow queries hands out all supported records, and
+# a hot standby only full-page images.
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf', 'hot_standby = off');
+$node_standby->start;
+
+my $node_hot = get_new_node('hot_standby');
+$node_hot->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_hot->start;
+
+generate_wal($node_master, 100001);
+$expected = $node_master->safe_psql(
+	'postgres', qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+$node_master->wait_for_catchup($node_hot, 'replay',
+	$node_master->lsn('insert'));
+check_contents($node_hot, $expected, 'hot standby');
+
+# Crash the standby after its workers wrote out pages, which advances
+# minRecoveryPoint, and generate more WAL while it's down.
+$node_standby->stop('immediate');
+generate_wal($node_master, 200001);
+$expected = $node_master->safe_psql(
+	'postgres', qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+$node_standby->start;
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+# Promote the standby, and check that it replayed everything.
+$node_standby->promote;
+$node_standby->poll_query_until('postgres', 'SELECT NOT pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+check_contents($node_standby, $expected, 'promoted standby');
+
+# The promoted standby accepts writes, and replays them after a crash.
+generate_wal($node_standby, 300001);
+$expected = $node_standby->safe_psql(
+	'postgres', qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+$node_standby->stop('immediate');
+$node_standby->start;
+check_contents($node_standby, $expected, 'crash recovery after promotion');
+
+# The standby with hot standby on still matches the master.
+$expected = $node_master->safe_psql(
+	'postgres', qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM prt;
+SELECT count(*), sum(a) FROM prt;
+SELECT count(*), sum(a) FROM prt_trunc;
+));
+$node_master->wait_for_catchup($node_hot, 'replay',
+	$node_master->lsn('insert'));
+check_contents($node_hot, $expected, 'hot standby after more WAL');
+
+foreach my $node ($node_master, $node_standby, $node_hot)
+{
+	unlike(
+		slurp_file($node->logfile),
+		qr/parallel redo worker \d+ exited before replaying/,
+		'no parallel redo worker exited early on ' . $node->name);
+}
@@ -0,0 +1,155 @@
+# Test replay of WAL with recovery_prefetch enabled
+#
+# The prefetcher reads WAL ahead of replay with a reader of its own.  Check
+# that replay gives the same results when it reads up to the end of WAL in
+# crash recovery, when it has to wait for WAL to be streamed, when segments
+# are only restored from the archive as replay gets to them, and when the
+# setting is switched off and on again in the middle of replay.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# Without full-page images, most records reference blocks that replay will
+# have to read, and with small shared buffers, they are not cached.
+my $prefetch_conf = qq(
+recovery_prefetch = on
+maintenance_io_concurrency = 10
+shared_buffers = 1MB
+full_page_writes = off
+);
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1, has_archiving => 1);
+$node_master->append_conf('postgresql.conf', $prefetch_conf);
+$node_master->start;
+
+$node_master->safe_psql(
+	'postgres', qq(
+CREATE TABLE pft (a int, b text);
+CREATE INDEX pft_a ON pft (a);
+CREATE TABLE pft_trunc (a int);
+CHECKPOINT;
+));
+
+# Generate WAL that touches many blocks of the heap and the index, including
+# records referencing relations that are dropped or truncated later on.
+sub generate_wal
+{
+	my ($node, $start) = @_;
+
+	$node->safe_psql(
+		'postgres', qq(
+INSERT INTO pft SELECT g, repeat('x', 100)
+  FROM generate_series($start, $start + 19999) g;
+UPDATE pft SET b = 'z' WHERE a % 7 = 0 AND a >= $start;
+DELETE FROM pft WHERE a % 5 = 0 AND a >= $start;
+VACUUM pft;
+INSERT INTO pft_trunc SELECT generate_series(1, 5000);
+TRUNCATE pft_trunc;
+INSERT INTO pft_trunc SELECT generate_series(1, 1000);
+CREATE TABLE pft_dropped AS SELECT generate_series(1, 5000) AS a;
+UPDATE pft_dropped SET a = a + 1;
+DROP TABLE pft_dropped;
+));
+	return;
+}
+
+my $contents_query = qq(
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM pft;
+SELECT count(*), sum(a) FROM pft_trunc;
+);
+
+# Check the contents of the tables, through the index as well.
+sub check_contents
+{
+	my ($node, $expected, $test_name) = @_;
+
+	my $result = $node->safe_psql(
+		'postgres', qq(
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(a), count(*) FILTER (WHERE b = 'z') FROM pft WHERE a > 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+SELECT count(*), sum(a) FROM pft_trunc;
+));
+	is($result, $expected, $test_name);
+	return;
+}
+
+# Crash recovery reads up to the end of WAL, where the prefetcher's reader
+# fails and has to wait for replay to catch up with it.
+generate_wal($node_master, 1);
+my $expected = $node_master->safe_psql('postgres', $contents_query);
+$node_master->stop('immediate');
+$node_master->start;
+check_contents($node_master, $expected, 'crash recovery');
+
+# A streaming standby, whose prefetcher may only read the WAL flushed by the
+# walreceiver, and a standby that restores segments from the archive, whose
+# prefetcher can't open the segments that weren't restored yet.
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf', $prefetch_conf);
+$node_standby->start;
+
+my $node_archive = get_new_node('archive_standby');
+$node_archive->init_from_backup($node_master, $backup_name,
+	has_restoring => 1);
+$node_archive->append_conf('postgresql.conf', $prefetch_conf);
+$node_archive->start;
+
+generate_wal($node_master, 100001);
+$node_master->safe_psql('postgres', 'SELECT pg_switch_wal()');
+generate_wal($node_master, 200001);
+$node_master->safe_psql('postgres', 'SELECT pg_switch_wal()');
+my $until_lsn = $node_master->lsn('insert');
+$expected = $node_master->safe_psql('postgres', $contents_query);
+
+$node_master->wait_for_catchup($node_standby, 'replay', $until_lsn);
+check_contents($node_standby, $expected, 'streaming standby');
+
+$node_archive->poll_query_until('postgres',
+	"SELECT '$until_lsn'::pg_lsn <= pg_last_wal_replay_lsn()")
+  or die "Timed out while waiting for the archive standby to catch up";
+check_contents($node_archive, $expected, 'standby restoring from archive');
+
+# Switch prefetching off and on again while the standby replays.
+$node_standby->append_conf('postgresql.conf', 'recovery_prefetch = off');
+$node_standby->reload;
+generate_wal($node_master, 300001);
+$node_standby->append_conf('postgresql.conf', 'recovery_prefetch = on');
+$node_standby->reload;
+generate_wal($node_master, 400001);
+$expected = $node_master->safe_psql('postgres', $contents_query);
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+check_contents($node_standby, $expected,
+	'standby with prefetching switched off and on');
+
+# Crash the standby and restart it, so that it replays from its last
+# restartpoint, then promote it.
+$node_standby->stop('immediate');
+generate_wal($node_master, 500001);
+$expected = $node_master->safe_psql('postgres', $contents_query);
+$node_standby->start;
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+$node_standby->promote;
+$node_standby->poll_query_until('postgres', 'SELECT NOT pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+check_contents($node_standby, $expected, 'promoted standby');
+
+# Crash recovery on the new timeline.
+generate_wal($node_standby, 600001);
+$expected = $node_standby->safe_psql('postgres', $contents_query);
+$node_standby->stop('immediate');
+$node_standby->start;
+check_contents($node_standby, $expected,
+	'crash recovery after promotion');
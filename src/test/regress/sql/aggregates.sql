@@ -1210,3 +1210,44 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+--
+-- Hash aggregation into a hash table large enough to be filled a chunk of
+-- input tuples at a time, both interpreted and JIT compiled.
+--
+
+set enable_sort = false;
+set work_mem = '64MB';
+set max_parallel_workers_per_gather = 0;
+
+create table agg_data_200k as
+select g from generate_series(0, 199999) g;
+analyze agg_data_200k;
+
+explain (costs off)
+select g%80000 as c1, sum(g) as c2, count(*) as c3
+  from agg_data_200k group by g%80000;
+
+-- groups below 40000 get three input rows, the others two
+select count(*) as groups,
+       count(*) filter (where c3 <> case when c1 < 40000 then 3 else 2 end or
+                              c2 <> case when c1 < 40000 then 3 * c1 + 240000
+                                         else 2 * c1 + 80000 end) as wrong
+  from (select g%80000 as c1, sum(g) as c2, count(*) as c3
+          from agg_data_200k group by g%80000) s;
+
+set jit_above_cost = 0;
+
+select count(*) as groups,
+       count(*) filter (where c3 <> case when c1 < 40000 then 3 else 2 end or
+                              c2 <> case when c1 < 40000 then 3 * c1 + 240000
+                                         else 2 * c1 + 80000 end) as wrong
+  from (select g%80000 as c1, sum(g) as c2, count(*) as c3
+          from agg_data_200k group by g%80000) s;
+
+set jit_above_cost to default;
+set max_parallel_workers_per_gather to default;
+set work_mem to default;
+set enable_sort to default;
+
+drop table agg_data_200k;
@@ -2003,6 +2003,38 @@ where f.c = 1;
 
 rollback;
 
+--
+-- join_sample_rows measures the selectivity of correlated join clauses
+--
+create table jsample1 as
+  select g % 100 as a, g % 100 as b from generate_series(1, 1000) g;
+create table jsample2 as
+  select g % 100 as a, g % 100 as b from generate_series(1, 1000) g;
+analyze jsample1;
+analyze jsample2;
+create function join_rows_estimate(query text) returns float8
+language plpgsql as
+$$
+declare
+  plan json;
+begin
+  execute 'explain (format json) ' || query into plan;
+  return (plan->0->'Plan'->>'Plan Rows')::float8;
+end
+$$;
+-- the clauses are assumed to be independent
+select join_rows_estimate('select * from jsample1 s1 join jsample2 s2
+                           on s1.a = s2.a and s1.b = s2.b');
+-- the samples cover the whole tables, so the estimate is exact
+set join_sample_rows = 2000;
+select join_rows_estimate('select * from jsample1 s1 join jsample2 s2
+                           on s1.a = s2.a and s1.b = s2.b');
+select count(*) from jsample1 s1 join jsample2 s2
+  on s1.a = s2.a and s1.b = s2.b;
+reset join_sample_rows;
+drop function join_rows_estimate(text);
+drop table jsample1, jsample2;
+
 --
 -- test planner's ability to mark joins as unique
 --
@@ -2171,3 +2203,40 @@ where exists (select 1 from j3
       and t1.unique1 < 1;
 
 drop table j3;
+
+--
+-- A nested loop whose outer side turns out much larger than estimated
+-- switches to a hash table of its inner side
+--
+create function nl_outer_rows(n int) returns setof int
+language plpgsql rows 10 as
+$$ begin return query select generate_series(1, n); end $$;
+create table nl_inner as select g as k, g * 10 as v from generate_series(1, 200) g;
+analyze nl_inner;
+begin;
+set local enable_hashjoin = off;
+set local enable_mergejoin = off;
+set local enable_material = off;
+set local adaptive_nestloop = on;
+explain (analyze, costs off, summary off, timing off)
+select count(*), count(i.k), sum(i.v)
+from nl_outer_rows(3000) o left join nl_inner i on i.k = o % 250;
+select count(*), count(i.k), sum(i.v)
+from nl_outer_rows(3000) o left join nl_inner i on i.k = o % 250;
+set local adaptive_nestloop = off;
+select count(*), count(i.k), sum(i.v)
+from nl_outer_rows(3000) o left join nl_inner i on i.k = o % 250;
+set local adaptive_nestloop = on;
+-- the outer rows are counted per scan, so none of these scans switches
+explain (analyze, costs off, summary off, timing off)
+select x, (select count(i.k)
+           from nl_outer_rows(600 + x) o left join nl_inner i on i.k = o % 250)
+from generate_series(1, 3) x;
+-- an inner side calling a volatile function is rescanned every time
+explain (analyze, costs off, summary off, timing off)
+select count(*), count(s.k)
+from nl_outer_rows(3000) o
+  left join (select * from nl_inner i where random() >= 0) s on s.k = o % 250;
+rollback;
+drop table nl_inner;
+drop function nl_outer_rows(int);
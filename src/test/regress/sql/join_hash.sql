@@ -538,3 +538,72 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+--
+-- Bloom filter of the inner join keys, pushed down by a hash join into
+-- the sequential scan on its outer side
+--
+begin;
+set local hashjoin_bloom_filter = on;
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+set local max_parallel_workers_per_gather = 0;
+create function explain_hash_filter(query text) returns setof text
+language plpgsql as
+$$
+declare ln text;
+begin
+    for ln in
+        execute 'explain (analyze, costs off, summary off, timing off) ' || query
+    loop
+        ln := regexp_replace(ln, 'Memory Usage: \S*', 'Memory Usage: xxx');
+        return next ln;
+    end loop;
+end;
+$$;
+create table hjbloom_outer as
+  select g as id, g % 1000 as k from generate_series(1, 10000) g;
+create table hjbloom_inner as
+  select g as k from generate_series(1, 50) g;
+analyze hjbloom_outer;
+analyze hjbloom_inner;
+-- only the outer rows with a match get past the scan
+select * from explain_hash_filter(
+  'select count(*) from hjbloom_outer o join hjbloom_inner i using (k)');
+select count(*) from hjbloom_outer o join hjbloom_inner i using (k);
+-- the filter is rebuilt along with the hash table on each rescan
+select * from explain_hash_filter(
+  'select (select count(*) from hjbloom_outer o join hjbloom_inner i using (k)
+           where i.k <= x)
+   from generate_series(10, 30, 10) x');
+select x, (select count(*) from hjbloom_outer o join hjbloom_inner i using (k)
+           where i.k <= x)
+from generate_series(10, 30, 10) x;
+set local hashjoin_bloom_filter = off;
+select * from explain_hash_filter(
+  'select count(*) from hjbloom_outer o join hjbloom_inner i using (k)');
+rollback;
+
+--
+-- Batched probing of a hash table too large for the CPU caches, where the
+-- bucket tags drop most outer tuples without a match before they are probed
+--
+begin;
+set local work_mem = '64MB';
+set local max_parallel_workers_per_gather = 0;
+create table hjprobe_outer as
+  select g as k from generate_series(1, 200000) g;
+create table hjprobe_inner as
+  select g * 2 as k from generate_series(1, 150000) g;
+analyze hjprobe_outer;
+analyze hjprobe_inner;
+explain (costs off)
+  select count(*) from hjprobe_outer o join hjprobe_inner i using (k);
+select count(*) from hjprobe_outer o join hjprobe_inner i using (k);
+select count(*), count(i.k)
+  from hjprobe_outer o left join hjprobe_inner i using (k);
+select count(*) from hjprobe_outer o
+  where exists (select 1 from hjprobe_inner i where i.k = o.k);
+select count(*) from hjprobe_outer o
+  where not exists (select 1 from hjprobe_inner i where i.k = o.k);
+rollback;
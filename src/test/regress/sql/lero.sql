@@ -0,0 +1,94 @@
+--
+-- Lero integration
+--
+
+-- Messages go to the server owning the query's fingerprint on the ring.  One
+-- that refuses connections is taken off the ring and the next one is tried.
+SET lero_servers = '127.0.0.1:1, 127.0.0.1:1';
+SET enable_lero = on;
+SELECT 1;
+-- Dead servers stay off the ring for a while, so they aren't tried again.
+SELECT 1;
+RESET enable_lero;
+RESET lero_servers;
+
+-- Cost-model calibration fits the cost constants to the timings of scans, and
+-- lero_use_calibrated_costs plans with them.
+CREATE TABLE lero_calib_wide (a int, pad text);
+INSERT INTO lero_calib_wide
+  SELECT g, rpad(md5(g::text), 1500, md5(g::text)) FROM generate_series(1, 500) g;
+CREATE TABLE lero_calib_narrow (a int);
+INSERT INTO lero_calib_narrow SELECT generate_series(1, 20000);
+CREATE INDEX lero_calib_narrow_a ON lero_calib_narrow (a);
+ANALYZE lero_calib_wide, lero_calib_narrow;
+CREATE FUNCTION lero_plan_cost(query text) RETURNS float8 LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+  RETURN (plan->0->'Plan'->>'Total Cost')::float8;
+END
+$$;
+SELECT lero_plan_cost('SELECT * FROM lero_calib_narrow WHERE a > 100')
+  AS default_cost \gset
+SET lero_cost_calibration = on;
+SET lero_calibration_sample_rate = 1;
+-- enough samples for a fit
+DO $$
+BEGIN
+  FOR i IN 1..400 LOOP
+    PERFORM count(*) FROM lero_calib_wide WHERE a > i;
+    PERFORM count(*) FROM lero_calib_narrow WHERE a > i;
+    PERFORM * FROM lero_calib_narrow WHERE a = i;
+  END LOOP;
+END
+$$;
+RESET lero_cost_calibration;
+RESET lero_calibration_sample_rate;
+SET lero_use_calibrated_costs = on;
+SELECT lero_plan_cost('SELECT * FROM lero_calib_narrow WHERE a > 100') <> :default_cost
+  AS costs_changed;
+RESET lero_use_calibrated_costs;
+SELECT lero_plan_cost('SELECT * FROM lero_calib_narrow WHERE a > 100') = :default_cost
+  AS costs_restored;
+DROP FUNCTION lero_plan_cost(text);
+DROP TABLE lero_calib_wide, lero_calib_narrow;
+
+-- Join size estimates read from lero_joinest_fname through the estimator
+-- hook.  Each distinct estimate takes the next line of the file.
+CREATE TABLE lero_est_a (x int);
+CREATE TABLE lero_est_b (x int, y int);
+CREATE TABLE lero_est_c (y int);
+DO $$
+BEGIN
+  EXECUTE format('COPY (SELECT unnest(ARRAY[111, 222, 333, 444, 555, 666])) TO %L',
+                 current_setting('data_directory') || '/lero_joinest.tmp');
+END
+$$;
+CREATE FUNCTION lero_plan_rows(query text) RETURNS float8 LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+  RETURN (plan->0->'Plan'->>'Plan Rows')::float8;
+END
+$$;
+SET lero_joinest_fname = 'lero_joinest.tmp';
+SELECT lero_plan_rows('SELECT * FROM lero_est_a a JOIN lero_est_b b ON a.x = b.x');
+-- setting the same file again continues where it left off
+SET lero_joinest_fname = 'lero_joinest.tmp';
+SELECT lero_plan_rows('SELECT * FROM lero_est_a a JOIN lero_est_b b ON a.x = b.x');
+-- {a,b}, {b,c} and then {a,b,c}, which is only estimated once
+SELECT lero_plan_rows('SELECT * FROM lero_est_a a JOIN lero_est_b b ON a.x = b.x
+                       JOIN lero_est_c c ON b.y = c.y');
+-- join sampling doesn't second-guess the estimator
+INSERT INTO lero_est_a SELECT generate_series(1, 100);
+INSERT INTO lero_est_b SELECT g, g FROM generate_series(1, 100) g;
+SET join_sample_rows = 1000;
+SELECT lero_plan_rows('SELECT * FROM lero_est_a a JOIN lero_est_b b ON a.x = b.x');
+RESET join_sample_rows;
+RESET lero_joinest_fname;
+DROP FUNCTION lero_plan_rows(text);
+DROP TABLE lero_est_a, lero_est_b, lero_est_c;
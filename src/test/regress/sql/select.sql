@@ -262,3 +262,115 @@ create table list_parted_tbl1 partition of list_parted_tbl
   for values in (1) partition by list(b);
 explain (costs off) select * from list_parted_tbl;
 drop table list_parted_tbl;
+
+--
+-- Sequential scans in batch mode, which run simple clauses over a whole
+-- page of tuples at once, must give the same results as tuple-at-a-time
+-- scans: with batch predicates, residual clauses, projections and rescans
+--
+create temp table batch_scan_tbl as
+  select g as a, g % 10 as b,
+         case when g % 7 = 0 then null else g % 100 end as c,
+         repeat('x', g % 5) as t
+  from generate_series(1, 3000) g;
+SET seqscan_batch_mode = on;
+SELECT count(*), sum(a), sum(c), max(t) FROM batch_scan_tbl
+  WHERE b = 3 AND c > 50 AND a % 3 = 0;
+EXPLAIN (analyze, costs off, summary off, timing off)
+SELECT count(*), sum(a), sum(c), max(t) FROM batch_scan_tbl
+  WHERE b = 3 AND c > 50 AND a % 3 = 0;
+SELECT count(*) FROM batch_scan_tbl WHERE 5 > b AND t = 'xx';
+SELECT a, c * 2 AS c2, t || '!' AS t FROM batch_scan_tbl
+  WHERE b = 7 AND a < 100 ORDER BY a;
+SELECT x, (SELECT count(*) FROM batch_scan_tbl WHERE b = 3 AND a > x) AS n
+  FROM generate_series(0, 3000, 1000) x;
+SELECT x, (SELECT a FROM batch_scan_tbl WHERE b = x AND c > 20 LIMIT 1) AS first_a
+  FROM generate_series(0, 9, 3) x;
+SET seqscan_batch_mode = off;
+SELECT count(*), sum(a), sum(c), max(t) FROM batch_scan_tbl
+  WHERE b = 3 AND c > 50 AND a % 3 = 0;
+EXPLAIN (analyze, costs off, summary off, timing off)
+SELECT count(*), sum(a), sum(c), max(t) FROM batch_scan_tbl
+  WHERE b = 3 AND c > 50 AND a % 3 = 0;
+SELECT count(*) FROM batch_scan_tbl WHERE 5 > b AND t = 'xx';
+SELECT a, c * 2 AS c2, t || '!' AS t FROM batch_scan_tbl
+  WHERE b = 7 AND a < 100 ORDER BY a;
+SELECT x, (SELECT count(*) FROM batch_scan_tbl WHERE b = 3 AND a > x) AS n
+  FROM generate_series(0, 3000, 1000) x;
+SELECT x, (SELECT a FROM batch_scan_tbl WHERE b = x AND c > 20 LIMIT 1) AS first_a
+  FROM generate_series(0, 9, 3) x;
+RESET seqscan_batch_mode;
+drop table batch_scan_tbl;
+
+-- Deforming of the fixed-width leading columns of a wide table, for rows
+-- with and without nulls, one row at a time and a page at a time
+create temp table fixed_prefix_tbl
+  (a int8, b int8, c int4, d int2, e float8, f bool, t text, h int4);
+insert into fixed_prefix_tbl
+  select g, g * 1000, case when g % 10 = 0 then null else g % 100 end,
+         g % 5, g / 4.0, g % 3 = 0,
+         case when g % 7 = 0 then null else repeat('y', g % 4) end, g % 13
+  from generate_series(1, 1000) g;
+SET seqscan_batch_mode = on;
+SELECT count(*), sum(a), sum(b), sum(c), sum(d), sum(e),
+       count(*) FILTER (WHERE f) AS f, count(t), sum(h)
+  FROM fixed_prefix_tbl;
+SELECT count(*), sum(a), sum(c), sum(e) FROM fixed_prefix_tbl
+  WHERE b > 100000 AND d = 3 AND c < 50;
+SELECT a, c, t, h FROM fixed_prefix_tbl
+  WHERE d = 0 AND a < 60 AND h > 2 ORDER BY a;
+SET seqscan_batch_mode = off;
+SELECT count(*), sum(a), sum(b), sum(c), sum(d), sum(e),
+       count(*) FILTER (WHERE f) AS f, count(t), sum(h)
+  FROM fixed_prefix_tbl;
+SELECT count(*), sum(a), sum(c), sum(e) FROM fixed_prefix_tbl
+  WHERE b > 100000 AND d = 3 AND c < 50;
+SELECT a, c, t, h FROM fixed_prefix_tbl
+  WHERE d = 0 AND a < 60 AND h > 2 ORDER BY a;
+RESET seqscan_batch_mode;
+drop table fixed_prefix_tbl;
+
+--
+-- Scans whose qual is checked by their JIT-compiled projection.  The qual
+-- is built into the projection whenever JIT compilation of expressions is
+-- planned, even if no JIT provider can be loaded
+--
+begin;
+set local jit = on;
+set local jit_above_cost = 0;
+set local seqscan_batch_mode = off;
+explain (analyze, costs off, summary off, timing off)
+select unique1 + 1 as u, stringu1 from onek where unique1 % 100 = 0 and ten = 0;
+select unique1 + 1 as u, stringu1 from onek where unique1 % 100 = 0 and ten = 0
+order by u;
+set local seqscan_batch_mode = on;
+explain (analyze, costs off, summary off, timing off)
+select unique1 + 1 as u, stringu1 from onek where unique1 % 100 = 0 and ten = 0;
+select unique1 + 1 as u, stringu1 from onek where unique1 % 100 = 0 and ten = 0
+order by u;
+set local enable_seqscan = off;
+set local enable_bitmapscan = off;
+explain (analyze, costs off, summary off, timing off)
+select unique1 * 2 as d, stringu1 from onek where unique1 < 50 and ten = 3;
+select unique1 * 2 as d, stringu1 from onek where unique1 < 50 and ten = 3
+order by d;
+rollback;
+
+-- A cached generic plan executed over and over with JIT compilation planned.
+-- If compiling takes longer than running it, it stops being compiled after a
+-- few executions, which must not change its results
+begin;
+set local jit = on;
+set local jit_above_cost = 0;
+set local jit_skip_unprofitable = on;
+set local plan_cache_mode = force_generic_plan;
+prepare jit_repeat(int) as
+  select count(*), sum(unique1) from onek where ten = $1;
+execute jit_repeat(1);
+execute jit_repeat(2);
+execute jit_repeat(3);
+execute jit_repeat(4);
+execute jit_repeat(5);
+execute jit_repeat(1);
+deallocate jit_repeat;
+rollback;
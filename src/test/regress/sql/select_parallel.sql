@@ -94,6 +94,28 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test parallel-aware finalization of hashed aggregation: the partial groups
+-- are routed to shared partitions, which the participants then claim and
+-- aggregate; the small work_mem makes the claimed partitions spill again
+create table hashagg_par as
+  select g, g % 40000 as k from generate_series(0, 199999) g;
+analyze hashagg_par;
+set enable_parallel_hashagg = on;
+set enable_sort = off;
+set work_mem = '64kB';
+set parallel_tuple_cost = 0.01;
+explain (costs off)
+	select k, count(*), sum(g) from hashagg_par group by k;
+-- every group gets five rows
+select count(*) as groups,
+       count(*) filter (where c <> 5 or s <> 5 * k + 400000) as wrong
+  from (select k, count(*) as c, sum(g) as s from hashagg_par group by k) ss;
+set parallel_tuple_cost = 0;
+reset work_mem;
+reset enable_sort;
+reset enable_parallel_hashagg;
+drop table hashagg_par;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)